@@ -2,6 +2,7 @@ TEMPLATE = app
 
 CONFIG += console
 CONFIG += c++17
+CONFIG += thread
 CONFIG -= app_bundle
 CONFIG -= qt
 
@@ -14,8 +15,6 @@ QMAKE_CXXFLAGS_RELEASE *= -Ofast
 
 INCLUDEPATH *= json/include rapidjson/include
 
-LIBS *= -lboost_timer
-
 linux {
     version = $$system(git describe --tags --always --dirty)
     build_timestamp = $$system(date -u '+%FT%T')
@@ -42,9 +41,36 @@ message(CONFIG: $$CONFIG)
 
 SOURCES += \
     main.cpp \
-    jsonWrapper.cpp
+    jsonWrapper.cpp \
+    jsonPlan.cpp \
+    jsonError.cpp \
+    jsonThreadPool.cpp \
+    jsonIncremental.cpp \
+    jsonDecodeCache.cpp \
+    jsonSimd.cpp \
+    jsonLines.cpp \
+    benchmarkHarness.cpp \
+    benchmarkWorkload.cpp \
+    benchmarkCounters.cpp \
+    benchmarkAlloc.cpp
 
 HEADERS += \
     getmember.h \
     getvalue.h \
-    jsonWrapper.h
+    jsonWrapper.h \
+    jsonPlan.h \
+    jsonSaxDecoder.h \
+    jsonIncremental.h \
+    jsonDecodeCache.h \
+    jsonSimd.h \
+    jsonError.h \
+    jsonThreadPool.h \
+    jsonFreeList.h \
+    jsonBind.h \
+    jsonView.h \
+    jsonKey.h \
+    jsonCursor.h \
+    benchmarkHarness.h \
+    benchmarkWorkload.h \
+    benchmarkCounters.h \
+    benchmarkAlloc.h
@@ -0,0 +1,169 @@
+//============================================================================
+// Name        : benchmarkAlloc.cpp
+// Description : Counts the heap calls of the benchmark by interposing
+//               glibc's malloc family, and the copies within the allocators
+//               of the parser handles
+//============================================================================
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "benchmarkAlloc.h"
+#include "jsonWrapper.h"
+
+// the copies the parser handles' allocators made within their memory, at BenchmarkAllocStart
+static thread_local uint64_t startAllocatorCopies;
+
+// AddressSanitizer brings its own malloc
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#include <malloc.h>
+
+// glibc's own implementation behind its malloc, calloc, ...
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+    void  __libc_free(void* ptr);
+    void* __libc_memalign(size_t alignment, size_t size);
+}
+
+// plain data only: a constructor or destructor would itself need the heap
+struct ThreadAllocCounters {
+    uint64_t	allocations;
+    uint64_t	bytes;
+    uint64_t	reallocCopies;
+    int64_t		liveBytes;		// usable sizes, so that free knows what it gives back
+    int64_t		startBytes;		// live at BenchmarkAllocStart
+    int64_t		peakBytes;
+};
+
+static thread_local ThreadAllocCounters threadCounters;
+
+static void CountAllocation(void* ptr, size_t size) {
+    if (ptr == NULL)
+        return;
+
+    threadCounters.allocations++;
+    threadCounters.bytes += size;
+    threadCounters.liveBytes += (int64_t)malloc_usable_size(ptr);
+
+    if (threadCounters.liveBytes > threadCounters.peakBytes)
+        threadCounters.peakBytes = threadCounters.liveBytes;
+}
+
+// (blocks of other threads freed here may take liveBytes below zero, that's fine for a peak)
+static void CountFree(void* ptr) {
+    if (ptr != NULL)
+        threadCounters.liveBytes -= (int64_t)malloc_usable_size(ptr);
+}
+
+extern "C" {
+
+    void* malloc(size_t size) {
+        void* ptr = __libc_malloc(size);
+
+        CountAllocation(ptr, size);
+        return ptr;
+    }
+
+    void* calloc(size_t count, size_t size) {
+        void* ptr = __libc_calloc(count, size);
+
+        CountAllocation(ptr, count * size);
+        return ptr;
+    }
+
+    void* realloc(void* ptr, size_t size) {
+        if (ptr == NULL)
+            return malloc(size);
+
+        size_t oldSize = malloc_usable_size(ptr);
+        void* newPtr = __libc_realloc(ptr, size);
+
+        // NULL: ptr was freed (size 0) or is left as it is (out of memory)
+        if (newPtr == NULL) {
+            if (size == 0)
+                threadCounters.liveBytes -= (int64_t)oldSize;
+            return NULL;
+        }
+
+        if (newPtr != ptr)
+            threadCounters.reallocCopies++;
+
+        threadCounters.liveBytes += (int64_t)malloc_usable_size(newPtr) - (int64_t)oldSize;
+
+        if (threadCounters.liveBytes > threadCounters.peakBytes)
+            threadCounters.peakBytes = threadCounters.liveBytes;
+
+        return newPtr;
+    }
+
+    void free(void* ptr) {
+        CountFree(ptr);
+        __libc_free(ptr);
+    }
+
+    void* memalign(size_t alignment, size_t size) {
+        void* ptr = __libc_memalign(alignment, size);
+
+        CountAllocation(ptr, size);
+        return ptr;
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size) {
+        return memalign(alignment, size);
+    }
+
+    int posix_memalign(void** pPtr, size_t alignment, size_t size) {
+        // a power of 2 and a multiple of sizeof(void*)
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment % sizeof(void*) != 0)
+            return EINVAL;
+
+        void* ptr = memalign(alignment, size);
+
+        if (ptr == NULL && size != 0)
+            return ENOMEM;
+
+        *pPtr = ptr;
+        return 0;
+    }
+
+}
+
+bool BenchmarkAllocAvailable() {
+    return true;
+}
+
+void BenchmarkAllocStart() {
+    threadCounters.allocations = 0;
+    threadCounters.bytes = 0;
+    threadCounters.reallocCopies = 0;
+    startAllocatorCopies = JSON_getThreadReallocCopies();
+    threadCounters.startBytes = threadCounters.liveBytes;
+    threadCounters.peakBytes = threadCounters.liveBytes;
+}
+
+void BenchmarkAllocStop(BenchmarkAllocStats& stats) {
+    stats.allocations = threadCounters.allocations;
+    stats.bytes = threadCounters.bytes;
+    stats.reallocCopies = threadCounters.reallocCopies + JSON_getThreadReallocCopies() - startAllocatorCopies;
+    stats.peakBytes = threadCounters.peakBytes - threadCounters.startBytes;
+}
+
+#else
+
+bool BenchmarkAllocAvailable() {
+    return false;
+}
+
+void BenchmarkAllocStart() {
+    startAllocatorCopies = JSON_getThreadReallocCopies();
+}
+
+void BenchmarkAllocStop(BenchmarkAllocStats& stats) {
+    memset(&stats, 0, sizeof(stats));
+    stats.reallocCopies = JSON_getThreadReallocCopies() - startAllocatorCopies;
+}
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * benchmarkAlloc.h
+ *
+ * Heap accounting of the benchmark: malloc, calloc, realloc and free (and so
+ * operator new/delete, rapidjson's CrtAllocator, the chunks of a
+ * MemoryPoolAllocator or of the parser's arena and nlohmann's std::allocator)
+ * are counted per thread. The benchmark binary interposes the malloc family of
+ * glibc for that, elsewhere (and under AddressSanitizer) the accounting is
+ * unavailable.
+ *
+ * Copies inside an allocator don't reach realloc. Those of the parser handles'
+ * allocators (the arena, or MyAllocator_New, growing a block by a new one and
+ * memcpy) are counted by the wrapper (JSON_getThreadReallocCopies) and added to
+ * reallocCopies. A MemoryPoolAllocator of rapidjson (the Original, Template,
+ * Overload, ... and Binding variants) moves blocks within its chunks uncounted,
+ * wrapping it would change the type of every rapidjson::Value the variants use;
+ * nlohmann's containers grow by allocating anew, which shows in allocations.
+ */
+
+#ifndef BENCHMARKALLOC_H_
+#define BENCHMARKALLOC_H_
+
+#include <stdint.h>
+
+struct BenchmarkAllocStats {
+    uint64_t	allocations;	// malloc, calloc, realloc of NULL, ...
+    uint64_t	bytes;			// requested by them
+    uint64_t	reallocCopies;	// realloc calls that had to move the block, and blocks the parser handles' allocators moved
+    int64_t		peakBytes;		// most bytes live at a time, on top of those live at BenchmarkAllocStart
+};
+
+// false if the heap isn't counted
+bool BenchmarkAllocAvailable();
+
+// counts the heap calls of the calling thread from now on
+void BenchmarkAllocStart();
+
+// the calls since BenchmarkAllocStart
+void BenchmarkAllocStop(BenchmarkAllocStats& stats);
+
+#endif /* BENCHMARKALLOC_H_ */
@@ -0,0 +1,152 @@
+//============================================================================
+// Name        : benchmarkCounters.cpp
+// Description : Hardware performance counters by perf_event_open
+//============================================================================
+
+#include <cerrno>
+#include <cstring>
+
+#include "benchmarkCounters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const char* const kCounterNames[COUNTER_COUNT] = {
+    "cycles",
+    "instructions",
+    "l1dMisses",
+    "llcMisses",
+    "branchMisses",
+    "dtlbMisses"
+};
+
+BenchmarkCounters::BenchmarkCounters() {
+    for (int counterIdx = 0; counterIdx < COUNTER_COUNT; counterIdx++)
+        fds[counterIdx] = -1;
+}
+
+BenchmarkCounters::~BenchmarkCounters() {
+#if defined(__linux__)
+    for (int counterIdx = 0; counterIdx < COUNTER_COUNT; counterIdx++) {
+        if (fds[counterIdx] >= 0)
+            close(fds[counterIdx]);
+    }
+#endif
+}
+
+const char* BenchmarkCounters::Name(BenchmarkCounter counter) {
+    return kCounterNames[counter];
+}
+
+bool BenchmarkCounters::AnyAvailable() const {
+    for (int counterIdx = 0; counterIdx < COUNTER_COUNT; counterIdx++) {
+        if (fds[counterIdx] >= 0)
+            return true;
+    }
+
+    return false;
+}
+
+#if defined(__linux__)
+
+// a read miss of a cache
+static uint64_t CacheMiss(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+bool BenchmarkCounters::Open() {
+    static const struct {
+        uint32_t	type;
+        uint64_t	config;
+    } events[COUNTER_COUNT] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, CacheMiss(PERF_COUNT_HW_CACHE_L1D)},
+        {PERF_TYPE_HW_CACHE, CacheMiss(PERF_COUNT_HW_CACHE_LL)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE, CacheMiss(PERF_COUNT_HW_CACHE_DTLB)}
+    };
+
+    int lastError = 0;
+
+    for (int counterIdx = 0; counterIdx < COUNTER_COUNT; counterIdx++) {
+        struct perf_event_attr attr;
+
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[counterIdx].type;
+        attr.config = events[counterIdx].config;
+        attr.disabled = 1;
+        // user space only, that's allowed up to perf_event_paranoid 2
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // this thread, any CPU
+        int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+
+        if (fd < 0)
+            lastError = errno;
+
+        fds[counterIdx] = fd;
+    }
+
+    if (AnyAvailable())
+        return true;
+
+    reason = std::string("perf_event_open: ") + strerror(lastError);
+    return false;
+}
+
+void BenchmarkCounters::Start() {
+    for (int counterIdx = 0; counterIdx < COUNTER_COUNT; counterIdx++) {
+        if (fds[counterIdx] >= 0) {
+            ioctl(fds[counterIdx], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fds[counterIdx], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void BenchmarkCounters::Stop(uint64_t (&counts)[COUNTER_COUNT]) {
+    for (int counterIdx = 0; counterIdx < COUNTER_COUNT; counterIdx++) {
+        if (fds[counterIdx] >= 0)
+            ioctl(fds[counterIdx], PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    for (int counterIdx = 0; counterIdx < COUNTER_COUNT; counterIdx++) {
+        // value, time enabled, time running
+        uint64_t values[3];
+
+        counts[counterIdx] = 0;
+
+        if (fds[counterIdx] < 0 || read(fds[counterIdx], values, sizeof(values)) != sizeof(values))
+            continue;
+
+        // multiplexed: scale up to the whole time the counter was enabled
+        if (values[2] != 0 && values[2] < values[1])
+            counts[counterIdx] = (uint64_t)((double)values[0] * values[1] / values[2]);
+        else
+            counts[counterIdx] = values[0];
+    }
+}
+
+#else
+
+bool BenchmarkCounters::Open() {
+    reason = "no perf_event_open on this system";
+    return false;
+}
+
+void BenchmarkCounters::Start() {
+}
+
+void BenchmarkCounters::Stop(uint64_t (&counts)[COUNTER_COUNT]) {
+    for (int counterIdx = 0; counterIdx < COUNTER_COUNT; counterIdx++)
+        counts[counterIdx] = 0;
+}
+
+#endif
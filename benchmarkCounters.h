@@ -0,0 +1,67 @@
+/*
+ * benchmarkCounters.h
+ *
+ * Hardware performance counters (Linux perf_event_open) read around the timed
+ * samples of a benchmark variant: cycles, instructions, L1 data and last level
+ * cache misses, branch misses and dTLB misses.
+ *
+ * The counters count the calling thread in user space only. Counters the
+ * machine doesn't have or doesn't grant (containers, virtual machines,
+ * kernel.perf_event_paranoid) are left out, without any counter the harness
+ * just reports time. If the PMU runs more counters than it has registers,
+ * the kernel multiplexes them and the counts are scaled to the full time.
+ */
+
+#ifndef BENCHMARKCOUNTERS_H_
+#define BENCHMARKCOUNTERS_H_
+
+#include <stdint.h>
+#include <string>
+
+enum BenchmarkCounter {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_L1D_MISSES,
+    COUNTER_LLC_MISSES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_DTLB_MISSES,
+    COUNTER_COUNT
+};
+
+class BenchmarkCounters {
+  public:
+    BenchmarkCounters();
+    ~BenchmarkCounters();
+
+    BenchmarkCounters(const BenchmarkCounters&) = delete;
+    BenchmarkCounters& operator=(const BenchmarkCounters&) = delete;
+
+    // opens what the machine offers, false (see Unavailable) if that's nothing
+    bool Open();
+
+    bool Available(BenchmarkCounter counter) const {
+        return fds[counter] >= 0;
+    }
+
+    bool AnyAvailable() const;
+
+    // why Open found no counter at all
+    const std::string& Unavailable() const {
+        return reason;
+    }
+
+    // "cycles", "instructions", ... also the keys of the JSON result
+    static const char* Name(BenchmarkCounter counter);
+
+    // counts from zero
+    void Start();
+
+    // counts since Start, 0 for unavailable counters
+    void Stop(uint64_t (&counts)[COUNTER_COUNT]);
+
+  private:
+    int			fds[COUNTER_COUNT];
+    std::string	reason;
+};
+
+#endif /* BENCHMARKCOUNTERS_H_ */
@@ -0,0 +1,508 @@
+//============================================================================
+// Name        : benchmarkHarness.cpp
+// Description : Warm-up, repeated samples, statistics and baseline comparison
+//               of the benchmark variants
+//============================================================================
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "benchmarkHarness.h"
+
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+// 100 samples of 10000 messages: a million messages per variant, like the old fixed loop
+static const size_t kDefaultSamples = 100;
+static const size_t kDefaultWarmup = 5;
+static const size_t kDefaultMessagesPerSample = 10000;
+static const double kDefaultThresholdPercent = 5.0;
+
+static void PrintUsage(const char* program, const char* extraUsage) {
+    std::cerr << "usage: " << program << " [--samples N] [--warmup N] [--messages N] [--filter TEXT]" << std::endl
+              << "       [--format text|json|csv] [--out FILE] [--compare BASELINE.json] [--threshold PERCENT]" << std::endl
+              << "       [--counters on|off]" << std::endl;
+
+    if (extraUsage)
+        std::cerr << extraUsage << std::endl;
+}
+
+static const char* const kCounterTitles[COUNTER_COUNT] = {
+    "cycles",
+    "instructions",
+    "L1D misses",
+    "LLC misses",
+    "branch misses",
+    "dTLB misses"
+};
+
+// instructions per cycle, false if one of them isn't counted
+static bool Ipc(const BenchmarkResult& result, double& ipc) {
+    if (!result.counted[COUNTER_CYCLES] || !result.counted[COUNTER_INSTRUCTIONS] || result.perMessage[COUNTER_CYCLES] <= 0)
+        return false;
+
+    ipc = result.perMessage[COUNTER_INSTRUCTIONS] / result.perMessage[COUNTER_CYCLES];
+    return true;
+}
+
+// a count option, at least 1
+static bool ParseCount(const char* text, size_t& count) {
+    char* pEnd;
+    unsigned long long value = strtoull(text, &pEnd, 10);
+
+    if (*text == 0 || *pEnd != 0 || value == 0)
+        return false;
+
+    count = (size_t)value;
+    return true;
+}
+
+BenchmarkHarness::BenchmarkHarness() : sampleCount(kDefaultSamples), warmupCount(kDefaultWarmup), messagesPerSample(kDefaultMessagesPerSample),
+    format(FORMAT_TEXT), thresholdPercent(kDefaultThresholdPercent), countersEnabled(true) {
+}
+
+bool BenchmarkHarness::ParseOptions(int argc, char** argv, const std::function<bool(const char*, const char*)>& extraOption,
+                                    const char* extraUsage) {
+
+    for (int argIdx = 1; argIdx < argc; argIdx++) {
+        const char* option = argv[argIdx];
+
+        // every option takes a value
+        if (argIdx + 1 >= argc) {
+            PrintUsage(argv[0], extraUsage);
+            return false;
+        }
+
+        const char* value = argv[++argIdx];
+        bool valid = true;
+
+        if (strcmp(option, "--samples") == 0)
+            valid = ParseCount(value, sampleCount);
+        else if (strcmp(option, "--warmup") == 0) {
+            // no warm-up at all is fine
+            warmupCount = 0;
+            valid = strcmp(value, "0") == 0 || ParseCount(value, warmupCount);
+        } else if (strcmp(option, "--messages") == 0)
+            valid = ParseCount(value, messagesPerSample);
+        else if (strcmp(option, "--filter") == 0)
+            filter = value;
+        else if (strcmp(option, "--format") == 0) {
+            if (strcmp(value, "text") == 0)
+                format = FORMAT_TEXT;
+            else if (strcmp(value, "json") == 0)
+                format = FORMAT_JSON;
+            else if (strcmp(value, "csv") == 0)
+                format = FORMAT_CSV;
+            else
+                valid = false;
+        } else if (strcmp(option, "--out") == 0)
+            outFile = value;
+        else if (strcmp(option, "--compare") == 0)
+            baselineFile = value;
+        else if (strcmp(option, "--threshold") == 0) {
+            char* pEnd;
+            thresholdPercent = strtod(value, &pEnd);
+            valid = *value != 0 && *pEnd == 0 && thresholdPercent >= 0;
+        } else if (strcmp(option, "--counters") == 0) {
+            countersEnabled = strcmp(value, "on") == 0;
+            valid = countersEnabled || strcmp(value, "off") == 0;
+        } else
+            valid = extraOption && extraOption(option, value);
+
+        if (!valid) {
+            std::cerr << "invalid option " << option << " " << value << std::endl;
+            PrintUsage(argv[0], extraUsage);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void BenchmarkHarness::Register(const BenchmarkVariant& variant) {
+    variants.push_back(variant);
+}
+
+std::ostream& BenchmarkHarness::Log() const {
+    // JSON or CSV on stdout have to stay parsable
+    if (format == FORMAT_TEXT || !outFile.empty())
+        return std::cout;
+
+    return std::cerr;
+}
+
+BenchmarkResult BenchmarkHarness::Measure(const BenchmarkVariant& variant) {
+    std::vector<double> samples;
+    size_t messages = variant.messagesPerSample ? variant.messagesPerSample : messagesPerSample;
+
+    samples.reserve(sampleCount);
+
+    if (variant.setUp)
+        variant.setUp();
+
+    for (size_t sampleIdx = 0; sampleIdx < warmupCount; sampleIdx++)
+        variant.run(messages);
+
+    uint64_t counts[COUNTER_COUNT];
+    BenchmarkAllocStats allocs;
+
+    // (samples is reserved, so the harness itself doesn't allocate in between)
+    BenchmarkAllocStart();
+    counters.Start();
+
+    for (size_t sampleIdx = 0; sampleIdx < sampleCount; sampleIdx++) {
+        auto start = std::chrono::steady_clock::now();
+
+        variant.run(messages);
+
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+        samples.push_back(elapsed.count() / messages);
+    }
+
+    counters.Stop(counts);
+    BenchmarkAllocStop(allocs);
+
+    if (variant.tearDown)
+        variant.tearDown();
+
+    BenchmarkResult result;
+
+    result.name = variant.name;
+    result.samples = samples.size();
+
+    double sum = 0;
+    for (double sample : samples)
+        sum += sample;
+
+    result.meanNs = sum / samples.size();
+
+    double squares = 0;
+    for (double sample : samples)
+        squares += (sample - result.meanNs) * (sample - result.meanNs);
+
+    result.stddevNs = samples.size() > 1 ? std::sqrt(squares / (samples.size() - 1)) : 0;
+
+    std::sort(samples.begin(), samples.end());
+
+    size_t middle = samples.size() / 2;
+    result.medianNs = samples.size() % 2 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2;
+
+    // nearest rank
+    size_t p99Rank = (size_t)std::ceil(0.99 * samples.size());
+    result.p99Ns = samples[std::max<size_t>(p99Rank, 1) - 1];
+
+    result.messagesPerSec = 1e9 / result.medianNs;
+    result.mbPerSec = variant.bytesPerMessage * result.messagesPerSec / 1e6;
+
+    for (int counterIdx = 0; counterIdx < COUNTER_COUNT; counterIdx++) {
+        result.counted[counterIdx] = counters.Available((BenchmarkCounter)counterIdx);
+        result.perMessage[counterIdx] = (double)counts[counterIdx] / (sampleCount * messages);
+    }
+
+    result.allocCounted = BenchmarkAllocAvailable();
+    result.allocationsPerMessage = (double)allocs.allocations / (sampleCount * messages);
+    result.allocatedBytesPerMessage = (double)allocs.bytes / (sampleCount * messages);
+    result.reallocCopiesPerMessage = (double)allocs.reallocCopies / (sampleCount * messages);
+    result.peakBytes = allocs.peakBytes;
+    result.allocationBudget = variant.allocationBudget;
+    // without warm-up the first messages may still be filling the caches and arenas
+    result.overBudget = result.allocCounted && warmupCount > 0 && variant.allocationBudget >= 0
+                        && result.allocationsPerMessage > variant.allocationBudget;
+
+    return result;
+}
+
+void BenchmarkHarness::Write(std::ostream& out, Format outFormat) const {
+
+    switch (outFormat) {
+    case FORMAT_TEXT:
+        out << std::left << std::setw(24) << "variant" << std::right
+            << std::setw(12) << "median ns" << std::setw(12) << "p99 ns" << std::setw(12) << "mean ns" << std::setw(12) << "stddev ns"
+            << std::setw(14) << "messages/s" << std::setw(10) << "MB/s" << std::endl;
+
+        for (auto& result : results) {
+            out << std::left << std::setw(24) << result.name << std::right << std::fixed << std::setprecision(1)
+                << std::setw(12) << result.medianNs << std::setw(12) << result.p99Ns << std::setw(12) << result.meanNs
+                << std::setw(12) << result.stddevNs << std::setprecision(0) << std::setw(14) << result.messagesPerSec
+                << std::setprecision(1) << std::setw(10) << result.mbPerSec << std::endl;
+        }
+
+        if (counters.AnyAvailable()) {
+            out << std::endl << std::left << std::setw(24) << "per message" << std::right;
+
+            for (int counterIdx = 0; counterIdx < COUNTER_COUNT; counterIdx++)
+                out << std::setw(14) << kCounterTitles[counterIdx];
+
+            out << std::setw(8) << "IPC" << std::endl;
+
+            for (auto& result : results) {
+                out << std::left << std::setw(24) << result.name << std::right << std::fixed << std::setprecision(1);
+
+                for (int counterIdx = 0; counterIdx < COUNTER_COUNT; counterIdx++) {
+                    if (result.counted[counterIdx])
+                        out << std::setw(14) << result.perMessage[counterIdx];
+                    else
+                        out << std::setw(14) << "-";
+                }
+
+                double ipc;
+                if (Ipc(result, ipc))
+                    out << std::setprecision(2) << std::setw(8) << ipc << std::endl;
+                else
+                    out << std::setw(8) << "-" << std::endl;
+            }
+        }
+
+        if (BenchmarkAllocAvailable()) {
+            out << std::endl << std::left << std::setw(24) << "heap per message" << std::right
+                << std::setw(14) << "allocations" << std::setw(14) << "bytes" << std::setw(16) << "realloc copies"
+                << std::setw(14) << "peak bytes" << std::setw(10) << "budget" << std::endl;
+
+            for (auto& result : results) {
+                out << std::left << std::setw(24) << result.name << std::right << std::fixed << std::setprecision(2)
+                    << std::setw(14) << result.allocationsPerMessage << std::setprecision(1) << std::setw(14)
+                    << result.allocatedBytesPerMessage << std::setprecision(2) << std::setw(16) << result.reallocCopiesPerMessage
+                    << std::setw(14) << result.peakBytes;
+
+                if (result.allocationBudget < 0)
+                    out << std::setw(10) << "-" << std::endl;
+                else
+                    out << std::setprecision(0) << std::setw(10) << result.allocationBudget << (result.overBudget ? "  OVER" : "") << std::endl;
+            }
+        }
+
+        out.unsetf(std::ios::floatfield);
+        break;
+
+    case FORMAT_JSON: {
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+        writer.StartObject();
+        writer.Key("samples");
+        writer.Uint64(sampleCount);
+        writer.Key("warmup");
+        writer.Uint64(warmupCount);
+        writer.Key("messagesPerSample");
+        writer.Uint64(messagesPerSample);
+        writer.Key("variants");
+        writer.StartArray();
+
+        for (auto& result : results) {
+            writer.StartObject();
+            writer.Key("name");
+            writer.String(result.name.c_str(), (rapidjson::SizeType)result.name.size());
+            writer.Key("medianNs");
+            writer.Double(result.medianNs);
+            writer.Key("p99Ns");
+            writer.Double(result.p99Ns);
+            writer.Key("meanNs");
+            writer.Double(result.meanNs);
+            writer.Key("stddevNs");
+            writer.Double(result.stddevNs);
+            writer.Key("messagesPerSec");
+            writer.Double(result.messagesPerSec);
+            writer.Key("mbPerSec");
+            writer.Double(result.mbPerSec);
+
+            // per message, only the counters there are
+            for (int counterIdx = 0; counterIdx < COUNTER_COUNT; counterIdx++) {
+                if (result.counted[counterIdx]) {
+                    writer.Key(BenchmarkCounters::Name((BenchmarkCounter)counterIdx));
+                    writer.Double(result.perMessage[counterIdx]);
+                }
+            }
+
+            double ipc;
+            if (Ipc(result, ipc)) {
+                writer.Key("ipc");
+                writer.Double(ipc);
+            }
+
+            if (result.allocCounted) {
+                writer.Key("allocations");
+                writer.Double(result.allocationsPerMessage);
+                writer.Key("allocatedBytes");
+                writer.Double(result.allocatedBytesPerMessage);
+                writer.Key("reallocCopies");
+                writer.Double(result.reallocCopiesPerMessage);
+                writer.Key("peakBytes");
+                writer.Int64(result.peakBytes);
+            }
+
+            if (result.allocationBudget >= 0) {
+                writer.Key("allocationBudget");
+                writer.Double(result.allocationBudget);
+                writer.Key("overBudget");
+                writer.Bool(result.overBudget);
+            }
+
+            writer.EndObject();
+        }
+
+        writer.EndArray();
+        writer.EndObject();
+
+        out << buffer.GetString() << std::endl;
+    }
+    break;
+
+    case FORMAT_CSV:
+        out << "name,median_ns,p99_ns,mean_ns,stddev_ns,messages_per_s,mb_per_s";
+
+        for (int counterIdx = 0; counterIdx < COUNTER_COUNT; counterIdx++)
+            out << "," << BenchmarkCounters::Name((BenchmarkCounter)counterIdx);
+
+        out << ",ipc,allocations,allocated_bytes,realloc_copies,peak_bytes,allocation_budget,over_budget" << std::endl;
+
+        // unavailable counters and heap figures stay empty
+        for (auto& result : results) {
+            out << result.name << "," << result.medianNs << "," << result.p99Ns << "," << result.meanNs << ","
+                << result.stddevNs << "," << result.messagesPerSec << "," << result.mbPerSec;
+
+            for (int counterIdx = 0; counterIdx < COUNTER_COUNT; counterIdx++) {
+                out << ",";
+                if (result.counted[counterIdx])
+                    out << result.perMessage[counterIdx];
+            }
+
+            double ipc;
+            out << ",";
+            if (Ipc(result, ipc))
+                out << ipc;
+
+            if (result.allocCounted)
+                out << "," << result.allocationsPerMessage << "," << result.allocatedBytesPerMessage << ","
+                    << result.reallocCopiesPerMessage << "," << result.peakBytes;
+            else
+                out << ",,,,";
+
+            out << ",";
+            if (result.allocationBudget >= 0)
+                out << result.allocationBudget << "," << (result.overBudget ? 1 : 0);
+            else
+                out << ",";
+
+            out << std::endl;
+        }
+        break;
+    }
+}
+
+bool BenchmarkHarness::Compare(const std::string& baselineFile, size_t& regressions) const {
+    std::ifstream in(baselineFile);
+
+    if (!in) {
+        std::cerr << "baseline " << baselineFile << " can't be opened" << std::endl;
+        return false;
+    }
+
+    std::stringstream text;
+    text << in.rdbuf();
+
+    std::string json = text.str();
+    rapidjson::Document baseline;
+
+    if (baseline.Parse(json.c_str()).HasParseError() || !baseline.IsObject() || !baseline.HasMember("variants")
+            || !baseline["variants"].IsArray()) {
+        std::cerr << "baseline " << baselineFile << " is no result of --format json" << std::endl;
+        return false;
+    }
+
+    const rapidjson::Value& baseVariants = baseline["variants"];
+    std::ostream& log = Log();
+
+    regressions = 0;
+
+    log << "compared with " << baselineFile << " (threshold " << thresholdPercent << "%):" << std::endl;
+
+    for (auto& result : results) {
+        const rapidjson::Value* pBase = NULL;
+
+        for (rapidjson::SizeType baseIdx = 0; baseIdx < baseVariants.Size(); baseIdx++) {
+            const rapidjson::Value& baseVariant = baseVariants[baseIdx];
+
+            if (baseVariant.IsObject() && baseVariant.HasMember("name") && baseVariant["name"].IsString()
+                    && result.name == baseVariant["name"].GetString() && baseVariant.HasMember("medianNs")
+                    && baseVariant["medianNs"].IsNumber()) {
+                pBase = &baseVariant;
+                break;
+            }
+        }
+
+        log << std::left << std::setw(24) << result.name << std::right;
+
+        if (pBase == NULL) {
+            log << "  not in baseline" << std::endl;
+            continue;
+        }
+
+        double baseMedian = (*pBase)["medianNs"].GetDouble();
+        double changePercent = baseMedian > 0 ? (result.medianNs - baseMedian) * 100 / baseMedian : 0;
+        bool regressed = changePercent > thresholdPercent;
+
+        if (regressed)
+            regressions++;
+
+        log << std::fixed << std::setprecision(1) << std::setw(12) << baseMedian << " ns -> " << std::setw(10) << result.medianNs
+            << " ns " << std::showpos << std::setw(8) << changePercent << "%" << std::noshowpos
+            << (regressed ? "  REGRESSED" : "") << std::endl;
+        log.unsetf(std::ios::floatfield);
+    }
+
+    return true;
+}
+
+size_t BenchmarkHarness::Run() {
+    results.clear();
+
+    if (countersEnabled && !counters.AnyAvailable() && !counters.Open())
+        Log() << "hardware counters unavailable (" << counters.Unavailable() << "), time only" << std::endl;
+
+    for (auto& variant : variants) {
+        if (!filter.empty() && variant.name.find(filter) == std::string::npos)
+            continue;
+
+        results.push_back(Measure(variant));
+    }
+
+    if (outFile.empty())
+        Write(std::cout, format);
+    else {
+        std::ofstream out(outFile);
+
+        if (!out)
+            std::cerr << "results can't be written to " << outFile << std::endl;
+        else
+            Write(out, format);
+
+        // the table is there for the reader anyway
+        if (format != FORMAT_TEXT)
+            Write(std::cout, FORMAT_TEXT);
+    }
+
+    size_t overBudget = 0;
+
+    for (auto& result : results) {
+        if (result.overBudget) {
+            Log() << result.name << " allocates " << result.allocationsPerMessage << " times per message, its budget is "
+                  << result.allocationBudget << std::endl;
+            overBudget++;
+        }
+    }
+
+    size_t regressions = 0;
+
+    if (!baselineFile.empty() && !Compare(baselineFile, regressions))
+        return 1 + overBudget; // a comparison that can't be made fails, too
+
+    return regressions + overBudget;
+}
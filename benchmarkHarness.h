@@ -0,0 +1,126 @@
+/*
+ * benchmarkHarness.h
+ *
+ * Runs the registered variants of the benchmark one after the other: some
+ * warm-up samples first, then a number of timed samples of a fixed count of
+ * messages each. A sample yields the mean time per message of its messages
+ * (a clock read per message would cost more than some of the variants), the
+ * statistics are taken over the samples: median and p99 ns per message, mean,
+ * standard deviation, messages/s and MB/s of JSON text.
+ *
+ * The results are printed as text, JSON or CSV. A JSON result stored earlier
+ * serves as baseline: --compare lists the change of every variant's median
+ * and fails the run if one got slower than --threshold percent.
+ *
+ * Where the machine grants them, hardware counters (see BenchmarkCounters)
+ * are read around the timed samples and reported per message, too.
+ *
+ * So are the heap calls of the timed samples (see benchmarkAlloc.h):
+ * allocations and bytes per message, the peak of the live bytes and the
+ * reallocations that moved their block. A variant may set an allocation
+ * budget, running over it after warm-up fails the run like a regression does
+ * (not checked with --warmup 0).
+ */
+
+#ifndef BENCHMARKHARNESS_H_
+#define BENCHMARKHARNESS_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmarkAlloc.h"
+#include "benchmarkCounters.h"
+
+struct BenchmarkVariant {
+    std::string					name;
+    size_t						bytesPerMessage;	// size of the JSON text, for MB/s
+    std::function<void()>		setUp;				// optional, not timed
+    std::function<void(size_t)>	run;				// handles the given count of messages
+    std::function<void()>		tearDown;			// optional, not timed (checks and reports the result)
+    size_t						messagesPerSample = 0;	// 0: --messages, less for large documents
+    double						allocationBudget = -1;	// allocations per message after warm-up, negative: no budget
+};
+
+struct BenchmarkResult {
+    std::string		name;
+    size_t			samples;
+    double			medianNs;	// per message
+    double			p99Ns;
+    double			meanNs;
+    double			stddevNs;
+    double			messagesPerSec;	// at the median
+    double			mbPerSec;
+    bool			counted[COUNTER_COUNT];		// false if the counter isn't available
+    double			perMessage[COUNTER_COUNT];	// counts of the calling thread per message
+    bool			allocCounted;				// false if the heap isn't counted
+    double			allocationsPerMessage;		// heap calls of the calling thread
+    double			allocatedBytesPerMessage;
+    double			reallocCopiesPerMessage;
+    int64_t			peakBytes;					// over all timed samples
+    double			allocationBudget;			// of the variant
+    bool			overBudget;
+};
+
+class BenchmarkHarness {
+  public:
+    enum Format {
+        FORMAT_TEXT,
+        FORMAT_JSON,
+        FORMAT_CSV
+    };
+
+    BenchmarkHarness();
+
+    // --samples N --warmup N --messages N --filter TEXT --format text|json|csv --out FILE
+    // --compare FILE --threshold PERCENT --counters on|off, any other option (with its value) is handed to extraOption,
+    // false (after printing the usage) if that rejects it, too
+    bool ParseOptions(int argc, char** argv,
+                      const std::function<bool(const char* option, const char* value)>& extraOption = nullptr,
+                      const char* extraUsage = NULL);
+
+    void Register(const BenchmarkVariant& variant);
+
+    // runs all variants (or those whose name contains the filter), writes the results and compares
+    // them with the baseline, returns the number of regressed variants (0 without --compare) plus
+    // the number of variants over their allocation budget
+    size_t Run();
+
+    size_t MessagesPerSample() const {
+        return messagesPerSample;
+    }
+
+    // where the variants report (the checks of their tearDown), stays clear of the results on stdout
+    std::ostream& Log() const;
+
+    const std::vector<BenchmarkResult>& Results() const {
+        return results;
+    }
+
+  private:
+    BenchmarkResult Measure(const BenchmarkVariant& variant);
+
+    void Write(std::ostream& out, Format outFormat) const;
+
+    // false if the baseline can't be read
+    bool Compare(const std::string& baselineFile, size_t& regressions) const;
+
+    std::vector<BenchmarkVariant>	variants;
+    std::vector<BenchmarkResult>	results;
+
+    size_t			sampleCount;
+    size_t			warmupCount;
+    size_t			messagesPerSample;
+    std::string		filter;
+    Format			format;
+    std::string		outFile;
+    std::string		baselineFile;
+    double			thresholdPercent;
+    bool			countersEnabled;
+    BenchmarkCounters	counters;
+};
+
+#endif /* BENCHMARKHARNESS_H_ */
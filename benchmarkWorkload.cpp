@@ -0,0 +1,266 @@
+//============================================================================
+// Name        : benchmarkWorkload.cpp
+// Description : Synthetic documents of configurable size and shape
+//============================================================================
+
+#include <cstddef>
+#include <cstring>
+#include <random>
+
+#include "benchmarkWorkload.h"
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/prettywriter.h"
+
+// same profile, same document
+static const uint32_t kWorkloadSeed = 20180330u;
+
+// binary size of a string field including its terminating 0
+static const uint32_t kWorkloadStringSize = 16;
+
+static const char* const kKeyNames[] = {"short", "normal", "extended"};
+
+std::string WorkloadLabel(const WorkloadProfile& profile) {
+    return "entries=" + std::to_string(profile.entryCount)
+           + "/width=" + std::to_string(profile.width)
+           + "/depth=" + std::to_string(profile.depth)
+           + "/keys=" + kKeyNames[profile.keys]
+           + "/unknown=" + std::to_string(profile.unknownPercent)
+           + "/strings=" + std::to_string(profile.stringPercent)
+           + "/doubles=" + std::to_string(profile.doublePercent)
+           + (profile.pretty ? "/pretty" : "");
+}
+
+bool WorkloadParseKeys(const char* text, WorkloadKeys& keys) {
+    for (uint32_t keysIdx = 0; keysIdx < sizeof(kKeyNames) / sizeof(kKeyNames[0]); keysIdx++) {
+        if (strcmp(text, kKeyNames[keysIdx]) == 0) {
+            keys = (WorkloadKeys)keysIdx;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// the key of field fieldIdx (unknown fields get their own prefix, so they never clash)
+static std::string FieldKey(WorkloadKeys keys, uint32_t fieldIdx, bool unknown) {
+    std::string key;
+
+    switch (keys) {
+    case WORKLOAD_KEYS_SHORT:
+        // a .. z, then a0 .. z9, then a00 ...
+        key.push_back(unknown ? 'X' : (char)('a' + fieldIdx % 26));
+        if (fieldIdx >= 26 || unknown)
+            key.append(std::to_string(unknown ? fieldIdx : fieldIdx / 26 - 1));
+        break;
+
+    case WORKLOAD_KEYS_NORMAL:
+        key = (unknown ? "extra" : "field") + std::to_string(fieldIdx);
+        break;
+
+    case WORKLOAD_KEYS_EXTENDED:
+        key = (unknown ? "unregisteredExtension" : "configurationParameter") + std::to_string(fieldIdx) + "Value";
+        break;
+    }
+
+    return key;
+}
+
+static uint32_t AlignTo(uint32_t offset, uint32_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+// field types and layout of the object at level (0 is the entry itself), returns its binary size
+static uint32_t LayoutObject(const WorkloadProfile& profile, uint32_t level, std::mt19937& random, Workload& workload) {
+    WorkloadObject object;
+
+    object.name = level == 0 ? "entries" : "nested" + std::to_string(level);
+
+    std::uniform_int_distribution<uint32_t> percent(0, 99);
+    uint32_t offset = 0;
+
+    for (uint32_t fieldIdx = 0; fieldIdx < profile.width; fieldIdx++) {
+        WorkloadMember member;
+        uint32_t share = percent(random);
+
+        member.name = FieldKey(profile.keys, fieldIdx, false);
+
+        if (share < profile.stringPercent) {
+            member.dataType = JSON_STRING;
+            member.size = kWorkloadStringSize;
+            member.offset = offset;
+        } else if (share < profile.stringPercent + profile.doublePercent) {
+            member.dataType = JSON_DOUBLE;
+            member.size = sizeof(double);
+            member.offset = AlignTo(offset, sizeof(double));
+        } else {
+            member.dataType = JSON_INT;
+            member.size = sizeof(int32_t);
+            member.offset = AlignTo(offset, sizeof(int32_t));
+        }
+
+        offset = member.offset + member.size;
+        object.members.push_back(member);
+    }
+
+    if (level < profile.depth) {
+        WorkloadMember member;
+
+        member.name = "nested" + std::to_string(level + 1);
+        member.dataType = JSON_OBJECT;
+        member.offset = AlignTo(offset, sizeof(double));
+        member.size = LayoutObject(profile, level + 1, random, workload);
+
+        offset = member.offset + member.size;
+        object.members.push_back(member);
+    }
+
+    workload.objects.push_back(object);
+
+    return AlignTo(offset, sizeof(double));
+}
+
+// an object of the layout at level, with the unknown members spread among the known ones
+template<typename Writer>
+static void WriteObject(const Workload& workload, uint32_t level, std::mt19937& random, Writer& writer) {
+    const WorkloadProfile& profile = workload.profile;
+
+    // the objects are laid out innermost first
+    const WorkloadObject& object = workload.objects[profile.depth - level];
+
+    uint32_t unknownCount = (profile.width * profile.unknownPercent + 99) / 100;
+    uint32_t unknownEvery = unknownCount ? (uint32_t)object.members.size() / unknownCount + 1 : 0;
+    uint32_t unknownIdx = 0;
+
+    std::uniform_int_distribution<int32_t> ints(-1000000, 1000000);
+    std::uniform_real_distribution<double> doubles(-1000.0, 1000.0);
+    std::uniform_int_distribution<uint32_t> stringLengths(4, kWorkloadStringSize - 4);
+    std::uniform_int_distribution<int> letters('a', 'z');
+
+    char string[kWorkloadStringSize];
+
+    writer.StartObject();
+
+    for (uint32_t memberIdx = 0; memberIdx < object.members.size(); memberIdx++) {
+        const WorkloadMember& member = object.members[memberIdx];
+
+        if (unknownIdx < unknownCount && memberIdx % unknownEvery == 0) {
+            std::string key = FieldKey(profile.keys, unknownIdx++, true);
+
+            writer.Key(key.c_str(), (rapidjson::SizeType)key.size());
+            writer.Int(ints(random));
+        }
+
+        writer.Key(member.name.c_str(), (rapidjson::SizeType)member.name.size());
+
+        switch (member.dataType) {
+        case JSON_STRING: {
+            uint32_t length = stringLengths(random);
+
+            for (uint32_t charIdx = 0; charIdx < length; charIdx++)
+                string[charIdx] = (char)letters(random);
+
+            writer.String(string, length);
+        }
+        break;
+
+        case JSON_DOUBLE:
+            writer.Double(doubles(random));
+            break;
+
+        case JSON_OBJECT:
+            WriteObject(workload, level + 1, random, writer);
+            break;
+
+        default:
+            writer.Int(ints(random));
+            break;
+        }
+    }
+
+    // whatever is left goes last
+    while (unknownIdx < unknownCount) {
+        std::string key = FieldKey(profile.keys, unknownIdx++, true);
+
+        writer.Key(key.c_str(), (rapidjson::SizeType)key.size());
+        writer.Int(ints(random));
+    }
+
+    writer.EndObject();
+}
+
+template<typename Writer>
+static void WriteDocument(const Workload& workload, std::mt19937& random, Writer& writer) {
+    writer.StartObject();
+    writer.Key("version");
+    writer.Int(1);
+    writer.Key("entries");
+    writer.StartArray();
+
+    for (uint32_t entryIdx = 0; entryIdx < workload.profile.entryCount; entryIdx++)
+        WriteObject(workload, 0, random, writer);
+
+    writer.EndArray();
+    writer.EndObject();
+}
+
+void WorkloadGenerate(const WorkloadProfile& profile, Workload& workload) {
+    std::mt19937 random(kWorkloadSeed);
+
+    workload.profile = profile;
+    workload.objects.clear();
+
+    // 1. the layout: the entry and its nested objects, then the root
+    workload.entrySize = LayoutObject(profile, 0, random, workload);
+
+    WorkloadObject root;
+    root.name = "";
+    root.members.push_back(WorkloadMember{"version", JSON_INT, offsetof(WorkloadRoot, version), sizeof(int32_t)});
+    // the element count is the int right before the array
+    root.members.push_back(WorkloadMember{"entries", JSON_OBJECTARRAY, sizeof(WorkloadRoot), workload.entrySize});
+    workload.objects.push_back(root);
+
+    workload.binSize = sizeof(WorkloadRoot) + profile.entryCount * workload.entrySize;
+
+    // 2. the text
+    rapidjson::StringBuffer buffer;
+
+    if (profile.pretty) {
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        WriteDocument(workload, random, writer);
+    } else {
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        WriteDocument(workload, random, writer);
+    }
+
+    workload.text.assign(buffer.GetString(), buffer.GetSize());
+}
+
+ParserHandle WorkloadNewParser(const Workload& workload) {
+    ParserHandle jsonParserHandle = JSON_parserNew();
+
+    if (jsonParserHandle == NULL)
+        return NULL;
+
+    for (auto& object : workload.objects) {
+        InterpreterObjectHandle objHandle = JSON_parserNewObject(jsonParserHandle, object.name.c_str());
+
+        if (objHandle == NULL) {
+            JSON_parserDelete(jsonParserHandle);
+            return NULL;
+        }
+
+        for (auto& member : object.members)
+            JSON_parserObjectAddMember(objHandle, member.name.c_str(), member.dataType, member.offset, member.size);
+    }
+
+    return jsonParserHandle;
+}
+
+void WorkloadResetBin(const Workload& workload, unsigned char* binBuffer) {
+    WorkloadRoot* pRoot = (WorkloadRoot*)binBuffer;
+
+    pRoot->version = 0;
+    pRoot->entryCount = (int32_t)workload.profile.entryCount;  // Set usable element count
+}
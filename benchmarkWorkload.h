@@ -0,0 +1,85 @@
+/*
+ * benchmarkWorkload.h
+ *
+ * Synthetic documents for the benchmark, a generalization of json_ipcfg and
+ * its short and extended variants:
+ *
+ *   {"version":1,"entries":[{<field>,...,"nested1":{<field>,...,"nested2":{...}}},...]}
+ *
+ * A profile sets the number of entries, the fields per object (width), how deep
+ * objects nest within an entry, the length of the keys, the share of string and
+ * double fields (the rest are ints) and how many members the interpreter doesn't
+ * know, and whether the text is pretty-printed. Values and field types come from
+ * a fixed seed, the same profile always yields the same document.
+ *
+ * Along with the text a workload describes the binary layout of the document
+ * (a WorkloadRoot with the entries behind it) and registers it with a parser.
+ */
+
+#ifndef BENCHMARKWORKLOAD_H_
+#define BENCHMARKWORKLOAD_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "jsonWrapper.h"
+
+enum WorkloadKeys {
+    WORKLOAD_KEYS_SHORT,		// 1-3 characters, like json_ipcfg_short
+    WORKLOAD_KEYS_NORMAL,		// about 8 characters, like json_ipcfg
+    WORKLOAD_KEYS_EXTENDED		// about 24 characters, like json_ipcfg_extended
+};
+
+struct WorkloadProfile {
+    uint32_t		entryCount;		// elements of the "entries" array
+    uint32_t		width;			// fields of every object
+    uint32_t		depth;			// objects nested within an entry
+    WorkloadKeys	keys;
+    uint32_t		unknownPercent;	// members the interpreter doesn't describe, in percent of width
+    uint32_t		stringPercent;	// share of the fields
+    uint32_t		doublePercent;
+    bool			pretty;			// indented, a member per line
+};
+
+// "entries=1000/width=8/depth=2/keys=short/unknown=10/strings=20/doubles=20[/pretty]", the name of a grid point
+std::string WorkloadLabel(const WorkloadProfile& profile);
+
+// "short", "normal" or "extended", false for anything else
+bool WorkloadParseKeys(const char* text, WorkloadKeys& keys);
+
+// the start of the binary buffer, the entries follow right behind
+struct WorkloadRoot {
+    int32_t		version;
+    int32_t		entryCount;		// the usable element count before JSON_TextToBin, the used one after it
+};
+
+struct WorkloadMember {
+    std::string		name;
+    JsonDataType	dataType;
+    uint32_t		offset;
+    uint32_t		size;
+};
+
+struct WorkloadObject {
+    std::string					name;	// "" for the root
+    std::vector<WorkloadMember>	members;
+};
+
+struct Workload {
+    WorkloadProfile				profile;
+    std::string					text;
+    std::vector<WorkloadObject>	objects;		// nested ones first, the root last
+    uint32_t					entrySize;		// of an element of "entries" in the binary buffer
+    uint32_t					binSize;		// WorkloadRoot and all entries
+};
+
+void WorkloadGenerate(const WorkloadProfile& profile, Workload& workload);
+
+// a parser with the layout of the workload registered, NULL on failure
+ParserHandle WorkloadNewParser(const Workload& workload);
+
+// prepare a binary buffer (binSize bytes) for the next JSON_TextToBin
+void WorkloadResetBin(const Workload& workload, unsigned char* binBuffer);
+
+#endif /* BENCHMARKWORKLOAD_H_ */
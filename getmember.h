@@ -1,20 +1,27 @@
-template <typename T> bool GetMember(const rapidjson::Value &jval, const char *name, T &val) {
+#include "jsonKey.h"
+#include "jsonView.h"
+
+template <typename T> bool GetMember(const rapidjson::Value &jval, const JsonKey &name, T &val) {
     std::cout << "GetMember has no specialization for this reference type" << std::endl;
     return false;
 }
 
-template <typename T> bool GetMember(const rapidjson::Value &jval, const char *name, T *val) {
+template <typename T> bool GetMember(const rapidjson::Value &jval, const JsonKey &name, T *val) {
     std::cout << "GetMember has no specialization for this pointer type" << std::endl;
     return false;
 }
 
-template <typename T> bool GetMember(const rapidjson::Value &jval, const char *name, T *val, rapidjson::SizeType cnt, rapidjson::SizeType &n) {
-    std::cout << "GetMember has no specialization for this array type" << std::endl;
-    return false;
+template <typename T> bool GetMember(const rapidjson::Value &jval, const JsonKey &name, JsonArrayView<T> &val, rapidjson::SizeType cnt) {
+    const rapidjson::Value::ConstMemberIterator it = JSON_findMember(jval, name);
+
+    if(it == jval.MemberEnd() || !it->value.IsArray())
+        return false;
+
+    return val.Assign(it->value, cnt);
 }
 
-template<> bool GetMember<int>(const rapidjson::Value &jval, const char *name, int &val) {
-    const rapidjson::Value::ConstMemberIterator it = jval.FindMember(name);
+template<> bool GetMember<int>(const rapidjson::Value &jval, const JsonKey &name, int &val) {
+    const rapidjson::Value::ConstMemberIterator it = JSON_findMember(jval, name);
 
     if(it == jval.MemberEnd() || !it->value.IsInt())
         return false;
@@ -24,8 +31,8 @@ template<> bool GetMember<int>(const rapidjson::Value &jval, const char *name, i
     return true;
 }
 
-template<> bool GetMember<int>(const rapidjson::Value &jval, const char *name, int *val) {
-    const rapidjson::Value::ConstMemberIterator it = jval.FindMember(name);
+template<> bool GetMember<int>(const rapidjson::Value &jval, const JsonKey &name, int *val) {
+    const rapidjson::Value::ConstMemberIterator it = JSON_findMember(jval, name);
 
     if(it == jval.MemberEnd() || !it->value.IsInt())
         return false;
@@ -35,8 +42,8 @@ template<> bool GetMember<int>(const rapidjson::Value &jval, const char *name, i
     return true;
 }
 
-template<> bool GetMember<bool>(const rapidjson::Value &jval, const char *name, bool &val) {
-    const rapidjson::Value::ConstMemberIterator it = jval.FindMember(name);
+template<> bool GetMember<bool>(const rapidjson::Value &jval, const JsonKey &name, bool &val) {
+    const rapidjson::Value::ConstMemberIterator it = JSON_findMember(jval, name);
 
     if(it == jval.MemberEnd() || !it->value.IsBool())
         return false;
@@ -46,8 +53,8 @@ template<> bool GetMember<bool>(const rapidjson::Value &jval, const char *name,
     return true;
 }
 
-template<> bool GetMember<bool>(const rapidjson::Value &jval, const char *name, bool *val) {
-    const rapidjson::Value::ConstMemberIterator it = jval.FindMember(name);
+template<> bool GetMember<bool>(const rapidjson::Value &jval, const JsonKey &name, bool *val) {
+    const rapidjson::Value::ConstMemberIterator it = JSON_findMember(jval, name);
 
     if(it == jval.MemberEnd() || !it->value.IsBool())
         return false;
@@ -57,30 +64,13 @@ template<> bool GetMember<bool>(const rapidjson::Value &jval, const char *name,
     return true;
 }
 
-template<> bool GetMember<rapidjson::Value>(const rapidjson::Value &jval, const char *name, rapidjson::Value &val) {
-    const rapidjson::Value::ConstMemberIterator it = jval.FindMember(name);
+template<> bool GetMember<JsonObjectView>(const rapidjson::Value &jval, const JsonKey &name, JsonObjectView &val) {
+    const rapidjson::Value::ConstMemberIterator it = JSON_findMember(jval, name);
 
     if(it == jval.MemberEnd() || !it->value.IsObject())
         return false;
 
-    val = const_cast<rapidjson::Value&>(it->value);
-
-    return true;
-}
-
-template<> bool GetMember<rapidjson::Value>(const rapidjson::Value &jval, const char *name, rapidjson::Value *val, const rapidjson::SizeType cnt, rapidjson::SizeType &n) {
-    const rapidjson::Value::ConstMemberIterator it = jval.FindMember(name);
-
-    if(it == jval.MemberEnd() || !it->value.IsArray())
-        return false;
-
-    n = 0;
-    rapidjson::SizeType i = 0;
-
-    for(rapidjson::Value::ConstValueIterator itv = it->value.Begin(); itv != it->value.End() && i < cnt; ++itv, ++i, ++n) {
-        *val++ = const_cast<rapidjson::Value&>(*itv);
-    }
+    val = JsonObjectView(&it->value);
 
     return true;
 }
-
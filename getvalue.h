@@ -1,7 +1,17 @@
-bool GetValue(const rapidjson::Value &jval, const char *name, int &val) {
-    const rapidjson::Value::ConstMemberIterator it = jval.FindMember(name);
+#include "jsonKey.h"
+#include "jsonCursor.h"
+#include "jsonView.h"
 
-    if(it == jval.MemberEnd() || !it->value.IsInt())
+// members looked up one after the other in the order the producer sent them:
+//   JsonValueCursor cursor(document);
+//   GetValue(cursor, JSON_KEY("schemaVersion"), ...);
+//   GetValue(cursor, JSON_KEY("dhcp"), ...);
+typedef JsonMemberCursor<const rapidjson::Value> JsonValueCursor;
+
+bool GetValue(JsonValueCursor &cursor, const JsonKey &name, int &val) {
+    const rapidjson::Value::ConstMemberIterator it = cursor.Find(name);
+
+    if(it == cursor.End() || !it->value.IsInt())
         return false;
 
     val = it->value.GetInt();
@@ -9,10 +19,10 @@ bool GetValue(const rapidjson::Value &jval, const char *name, int &val) {
     return true;
 }
 
-bool GetValue(const rapidjson::Value &jval, const char *name, int *val) {
-    const rapidjson::Value::ConstMemberIterator it = jval.FindMember(name);
+bool GetValue(JsonValueCursor &cursor, const JsonKey &name, int *val) {
+    const rapidjson::Value::ConstMemberIterator it = cursor.Find(name);
 
-    if(it == jval.MemberEnd() || !it->value.IsInt())
+    if(it == cursor.End() || !it->value.IsInt())
         return false;
 
     *val = it->value.GetInt();
@@ -20,10 +30,10 @@ bool GetValue(const rapidjson::Value &jval, const char *name, int *val) {
     return true;
 }
 
-bool GetValue(const rapidjson::Value &jval, const char *name, bool &val) {
-    const rapidjson::Value::ConstMemberIterator it = jval.FindMember(name);
+bool GetValue(JsonValueCursor &cursor, const JsonKey &name, bool &val) {
+    const rapidjson::Value::ConstMemberIterator it = cursor.Find(name);
 
-    if(it == jval.MemberEnd() || !it->value.IsBool())
+    if(it == cursor.End() || !it->value.IsBool())
         return false;
 
     val = it->value.GetBool();
@@ -31,10 +41,10 @@ bool GetValue(const rapidjson::Value &jval, const char *name, bool &val) {
     return true;
 }
 
-bool GetValue(const rapidjson::Value &jval, const char *name, bool *val) {
-    const rapidjson::Value::ConstMemberIterator it = jval.FindMember(name);
+bool GetValue(JsonValueCursor &cursor, const JsonKey &name, bool *val) {
+    const rapidjson::Value::ConstMemberIterator it = cursor.Find(name);
 
-    if(it == jval.MemberEnd() || !it->value.IsBool())
+    if(it == cursor.End() || !it->value.IsBool())
         return false;
 
     *val = it->value.GetBool();
@@ -42,29 +52,59 @@ bool GetValue(const rapidjson::Value &jval, const char *name, bool *val) {
     return true;
 }
 
-bool GetValue(const rapidjson::Value &jval, const char *name, rapidjson::Value &val) {
-    const rapidjson::Value::ConstMemberIterator it = jval.FindMember(name);
+bool GetValue(JsonValueCursor &cursor, const JsonKey &name, JsonObjectView &val) {
+    const rapidjson::Value::ConstMemberIterator it = cursor.Find(name);
 
-    if(it == jval.MemberEnd() || !it->value.IsObject())
+    if(it == cursor.End() || !it->value.IsObject())
         return false;
 
-    val = const_cast<rapidjson::Value&>(it->value);
+    val = JsonObjectView(&it->value);
 
     return true;
 }
 
-bool GetValue(const rapidjson::Value &jval, const char *name, rapidjson::Value *val, const rapidjson::SizeType cnt, rapidjson::SizeType &n) {
-    const rapidjson::Value::ConstMemberIterator it = jval.FindMember(name);
+template <typename T> bool GetValue(JsonValueCursor &cursor, const JsonKey &name, JsonArrayView<T> &val, const rapidjson::SizeType cnt) {
+    const rapidjson::Value::ConstMemberIterator it = cursor.Find(name);
 
-    if(it == jval.MemberEnd() || !it->value.IsArray())
+    if(it == cursor.End() || !it->value.IsArray())
         return false;
 
-    n = 0;
-    rapidjson::SizeType i = 0;
+    return val.Assign(it->value, cnt);
+}
 
-    for(rapidjson::Value::ConstValueIterator itv = it->value.Begin(); itv != it->value.End() && i < cnt; ++itv, ++i, ++n) {
-        *val++ = const_cast<rapidjson::Value&>(*itv);
-    }
+// a single lookup
+bool GetValue(const rapidjson::Value &jval, const JsonKey &name, int &val) {
+    JsonValueCursor cursor(jval);
 
-    return true;
+    return GetValue(cursor, name, val);
+}
+
+bool GetValue(const rapidjson::Value &jval, const JsonKey &name, int *val) {
+    JsonValueCursor cursor(jval);
+
+    return GetValue(cursor, name, val);
+}
+
+bool GetValue(const rapidjson::Value &jval, const JsonKey &name, bool &val) {
+    JsonValueCursor cursor(jval);
+
+    return GetValue(cursor, name, val);
+}
+
+bool GetValue(const rapidjson::Value &jval, const JsonKey &name, bool *val) {
+    JsonValueCursor cursor(jval);
+
+    return GetValue(cursor, name, val);
+}
+
+bool GetValue(const rapidjson::Value &jval, const JsonKey &name, JsonObjectView &val) {
+    JsonValueCursor cursor(jval);
+
+    return GetValue(cursor, name, val);
+}
+
+template <typename T> bool GetValue(const rapidjson::Value &jval, const JsonKey &name, JsonArrayView<T> &val, const rapidjson::SizeType cnt) {
+    JsonValueCursor cursor(jval);
+
+    return GetValue(cursor, name, val, cnt);
 }
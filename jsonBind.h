@@ -0,0 +1,566 @@
+/*
+ * jsonBind.h
+ *
+ * Compile-time binding of a binary struct to JSON, the alternative to registering
+ * an interpreter at runtime (JSON_parserNewObject/JSON_parserObjectAddMember).
+ *
+ * A struct is described once by specializing JsonBinding:
+ *
+ *     template<> struct JsonBinding<Numbers> {
+ *         static constexpr auto fields = std::make_tuple(
+ *             JSON_bindField("addr", &Numbers::addr),
+ *             JSON_bindField("mask", &Numbers::mask));
+ *     };
+ *
+ * The kind of a field follows from its member type: int32_t (JSON_INT), uint32_t
+ * (JSON_UINT), double, bool, char[N] (string of at most N-1 characters), a struct
+ * with a JsonBinding of its own (object). JSON_bindArray binds a C array, its size
+ * is the bound and a count member receives the number of elements decoded.
+ *
+ * JsonBinder<T> decodes and encodes with code generated for T: the names are
+ * compared against compile-time constants, every type check is a single test of
+ * the value, nested structs and arrays are inlined. The return codes, the error
+ * records and the logging are those of JSON_TextToBin/JSON_BinToText.
+ */
+
+#ifndef JSONBIND_H_
+#define JSONBIND_H_
+
+#include <stdint.h>
+#include <cstring>
+#include <cmath>
+#include <tuple>
+#include <utility>
+
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/internal/itoa.h"
+#include "rapidjson/internal/dtoa.h"
+
+#include "jsonWrapper.h"
+#include "jsonError.h"
+
+template <typename Class>
+struct JsonBinding;
+
+template <typename Class, typename Type>
+struct JsonBindField {
+    const char*		name;
+    uint32_t		length;
+    Type Class::*	member;
+};
+
+template <typename Class, typename Element, size_t N, typename Count>
+struct JsonBindArray {
+    const char*		name;
+    uint32_t		length;
+    Element (Class::* member)[N];
+    Count Class::*	count;
+};
+
+template <typename Class, typename Type, size_t L>
+constexpr JsonBindField<Class, Type> JSON_bindField(const char (&name)[L], Type Class::* member) {
+    return {name, L - 1, member};
+}
+
+template <typename Class, typename Element, size_t N, typename Count, size_t L>
+constexpr JsonBindArray<Class, Element, N, Count> JSON_bindArray(const char (&name)[L], Element (Class::* member)[N], Count Class::* count) {
+    return {name, L - 1, member, count};
+}
+
+// names are written without escaping
+constexpr bool JSON_bindPlainName(const char* name, uint32_t length) {
+    for (uint32_t idx = 0; idx < length; idx++) {
+        if ((unsigned char)name[idx] < 0x20 || name[idx] == '"' || name[idx] == '\\')
+            return false;
+    }
+
+    return true;
+}
+
+constexpr bool JSON_bindSameName(const char* name1, uint32_t length1, const char* name2, uint32_t length2) {
+    if (length1 != length2)
+        return false;
+
+    for (uint32_t idx = 0; idx < length1; idx++) {
+        if (name1[idx] != name2[idx])
+            return false;
+    }
+
+    return true;
+}
+
+template <typename Class>
+class JsonBindObject;
+
+// decodes and encodes a value of a type, the primary template handles bound structs
+template <typename Type>
+struct JsonBindCodec {
+    static constexpr JsonDataType kType = JSON_OBJECT;
+
+    static uint32_t Decode(const rapidjson::Value& value, Type& dest, const char* name, int32_t index, uint32_t offset, JsonErrorSink& sink) {
+        if (!value.IsObject()) {
+            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_OBJECT, name, index, offset);
+            return 2; // wrong type
+        }
+
+        sink.Push(name);
+        if (index >= 0)
+            sink.PushIndex(index);
+
+        uint32_t returnCode = JsonBindObject<Type>::Decode(value, dest, sink);
+
+        if (index >= 0)
+            sink.Pop();
+        sink.Pop();
+
+        return returnCode;
+    }
+
+    static uint32_t Encode(const Type& src, rapidjson::StringBuffer& out, const char* name, int32_t index, JsonErrorSink& sink) {
+        sink.Push(name);
+        if (index >= 0)
+            sink.PushIndex(index);
+
+        uint32_t returnCode = JsonBindObject<Type>::Encode(src, out, sink);
+
+        if (index >= 0)
+            sink.Pop();
+        sink.Pop();
+
+        return returnCode;
+    }
+};
+
+template <>
+struct JsonBindCodec<int32_t> {
+    static constexpr JsonDataType kType = JSON_INT;
+
+    static uint32_t Decode(const rapidjson::Value& value, int32_t& dest, const char* name, int32_t index, uint32_t offset, JsonErrorSink& sink) {
+        if (!value.IsInt()) {
+            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_INT, name, index, offset);
+            return 2; // wrong type
+        }
+
+        dest = value.GetInt();
+        return 0;
+    }
+
+    static uint32_t Encode(int32_t src, rapidjson::StringBuffer& out, const char*, int32_t, JsonErrorSink&) {
+        char* pBegin = out.Push(11);
+        char* pEnd = rapidjson::internal::i32toa(src, pBegin);
+        out.Pop(11 - (pEnd - pBegin));
+        return 0;
+    }
+};
+
+template <>
+struct JsonBindCodec<uint32_t> {
+    static constexpr JsonDataType kType = JSON_UINT;
+
+    static uint32_t Decode(const rapidjson::Value& value, uint32_t& dest, const char* name, int32_t index, uint32_t offset, JsonErrorSink& sink) {
+        if (!value.IsUint()) {
+            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_UINT, name, index, offset);
+            return 2; // wrong type
+        }
+
+        dest = value.GetUint();
+        return 0;
+    }
+
+    static uint32_t Encode(uint32_t src, rapidjson::StringBuffer& out, const char*, int32_t, JsonErrorSink&) {
+        char* pBegin = out.Push(10);
+        char* pEnd = rapidjson::internal::u32toa(src, pBegin);
+        out.Pop(10 - (pEnd - pBegin));
+        return 0;
+    }
+};
+
+template <>
+struct JsonBindCodec<double> {
+    static constexpr JsonDataType kType = JSON_DOUBLE;
+
+    static uint32_t Decode(const rapidjson::Value& value, double& dest, const char* name, int32_t index, uint32_t offset, JsonErrorSink& sink) {
+        if (!value.IsDouble()) {
+            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_DOUBLE, name, index, offset);
+            return 2; // wrong type
+        }
+
+        dest = value.GetDouble();
+        return 0;
+    }
+
+    static uint32_t Encode(double src, rapidjson::StringBuffer& out, const char* name, int32_t index, JsonErrorSink& sink) {
+        // JSON has no NaN and no Infinity
+        if (!std::isfinite(src)) {
+            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_DOUBLE, name, index, JSON_ERROR_NO_OFFSET);
+            return 2; // wrong type
+        }
+
+        char* pBegin = out.Push(25);
+        char* pEnd = rapidjson::internal::dtoa(src, pBegin);
+        out.Pop(25 - (pEnd - pBegin));
+        return 0;
+    }
+};
+
+template <>
+struct JsonBindCodec<bool> {
+    static constexpr JsonDataType kType = JSON_BOOL;
+
+    static uint32_t Decode(const rapidjson::Value& value, bool& dest, const char* name, int32_t index, uint32_t offset, JsonErrorSink& sink) {
+        if (!value.IsBool()) {
+            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_BOOL, name, index, offset);
+            return 2; // wrong type
+        }
+
+        dest = value.GetBool();
+        return 0;
+    }
+
+    static uint32_t Encode(bool src, rapidjson::StringBuffer& out, const char*, int32_t, JsonErrorSink&) {
+        if (src)
+            memcpy(out.Push(4), "true", 4);
+        else
+            memcpy(out.Push(5), "false", 5);
+        return 0;
+    }
+};
+
+template <size_t N>
+struct JsonBindCodec<char[N]> {
+    static constexpr JsonDataType kType = JSON_STRING;
+
+    static uint32_t Decode(const rapidjson::Value& value, char (&dest)[N], const char* name, int32_t index, uint32_t offset, JsonErrorSink& sink) {
+        if (!value.IsString()) {
+            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_STRING, name, index, offset);
+            return 2; // wrong type
+        }
+
+        rapidjson::SizeType strLength = value.GetStringLength();
+        uint32_t returnCode = 0;
+
+        if (strLength > N - 1) {
+            sink.Report(3, JSON_ERROR_STRING_TRUNCATED, JSON_STRING, name, index, offset);
+            returnCode = 3; // string truncated
+
+            strLength = N - 1;
+        }
+
+        memcpy(dest, value.GetString(), strLength);
+        dest[strLength] = 0;
+
+        return returnCode;
+    }
+
+    static uint32_t Encode(const char (&src)[N], rapidjson::StringBuffer& out, const char*, int32_t, JsonErrorSink&) {
+        static const char hexDigits[] = "0123456789ABCDEF";
+
+        size_t length = strnlen(src, N);
+
+        // worst case every character is escaped as \u00XX, quotes included
+        out.Reserve(length * 6 + 2);
+
+        out.PutUnsafe('"');
+
+        for (size_t idx = 0; idx < length; idx++) {
+            unsigned char c = (unsigned char)src[idx];
+
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                out.PutUnsafe((char)c);
+                continue;
+            }
+
+            out.PutUnsafe('\\');
+
+            switch (c) {
+            case '"':  out.PutUnsafe('"');  break;
+            case '\\': out.PutUnsafe('\\'); break;
+            case '\b': out.PutUnsafe('b');  break;
+            case '\f': out.PutUnsafe('f');  break;
+            case '\n': out.PutUnsafe('n');  break;
+            case '\r': out.PutUnsafe('r');  break;
+            case '\t': out.PutUnsafe('t');  break;
+            default:
+                out.PutUnsafe('u');
+                out.PutUnsafe('0');
+                out.PutUnsafe('0');
+                out.PutUnsafe(hexDigits[c >> 4]);
+                out.PutUnsafe(hexDigits[c & 0xF]);
+                break;
+            }
+        }
+
+        out.PutUnsafe('"');
+        return 0;
+    }
+};
+
+// the fields of a bound struct, unrolled at compile time
+template <typename Class>
+class JsonBindObject {
+  public:
+    static uint32_t Decode(const rapidjson::Value& object, Class& bin, JsonErrorSink& sink) {
+        uint64_t seen = 0;
+        uint32_t returnCode = 0;
+
+        // every JSON member once, members that aren't bound are skipped
+        for (auto it = object.MemberBegin(); it != object.MemberEnd(); ++it) {
+            uint32_t memberCode = DecodeMember(it->name.GetString(), it->name.GetStringLength(), it->value, bin, seen,
+                                               sink.Offset(it->name.GetString() - 1), sink, Indices());
+
+            if (memberCode == 3)
+                returnCode = 3; // string truncated, go on with the next member
+            else if (memberCode != 0)
+                return memberCode;
+        }
+
+        if (seen != kAllFields) {
+            ReportMissing(__builtin_ctzll(~seen), sink, Indices());
+            return 1;
+        }
+
+        return returnCode;
+    }
+
+    static uint32_t Encode(const Class& bin, rapidjson::StringBuffer& out, JsonErrorSink& sink) {
+        out.Put('{');
+
+        uint32_t returnCode = EncodeMembers(bin, out, sink, Indices());
+
+        out.Put('}');
+
+        return returnCode;
+    }
+
+  private:
+    static constexpr auto& kFields = JsonBinding<Class>::fields;
+    static constexpr size_t kFieldCount = std::tuple_size<typename std::decay<decltype(JsonBinding<Class>::fields)>::type>::value;
+    static constexpr uint64_t kAllFields = kFieldCount == 64 ? ~(uint64_t)0 : ((uint64_t)1 << kFieldCount) - 1;
+
+    typedef std::make_index_sequence<kFieldCount> Indices;
+
+    template <size_t... I>
+    static constexpr bool PlainNames(std::index_sequence<I...>) {
+        return (JSON_bindPlainName(std::get<I>(kFields).name, std::get<I>(kFields).length) && ...);
+    }
+
+    template <size_t I, size_t... J>
+    static constexpr bool UniqueName(std::index_sequence<J...>) {
+        return (((J <= I) || !JSON_bindSameName(std::get<I>(kFields).name, std::get<I>(kFields).length,
+                                                std::get<J>(kFields).name, std::get<J>(kFields).length)) && ...);
+    }
+
+    template <size_t... I>
+    static constexpr bool UniqueNames(std::index_sequence<I...>) {
+        return (UniqueName<I>(Indices()) && ...);
+    }
+
+    static_assert(kFieldCount > 0 && kFieldCount <= 64, "JsonBinding: 1 to 64 fields per struct");
+    static_assert(PlainNames(Indices()), "JsonBinding: names must not need escaping");
+    static_assert(UniqueNames(Indices()), "JsonBinding: names must be unique");
+
+    template <typename Type>
+    static constexpr JsonDataType FieldType(const JsonBindField<Class, Type>&) {
+        return JsonBindCodec<Type>::kType;
+    }
+
+    // the array type of the same order in JsonDataType
+    template <typename Element, size_t N, typename Count>
+    static constexpr JsonDataType FieldType(const JsonBindArray<Class, Element, N, Count>&) {
+        return (JsonDataType)(JsonBindCodec<Element>::kType - JSON_STRING + JSON_STRINGARRAY);
+    }
+
+    template <typename Type>
+    static uint32_t DecodeField(const JsonBindField<Class, Type>& field, const rapidjson::Value& value, Class& bin, uint32_t offset, JsonErrorSink& sink) {
+        return JsonBindCodec<Type>::Decode(value, bin.*field.member, field.name, -1, offset, sink);
+    }
+
+    template <typename Element, size_t N, typename Count>
+    static uint32_t DecodeField(const JsonBindArray<Class, Element, N, Count>& field, const rapidjson::Value& value, Class& bin, uint32_t offset,
+                                JsonErrorSink& sink) {
+        if (!value.IsArray()) {
+            sink.Report(2, JSON_ERROR_WRONG_TYPE, FieldType(field), field.name, -1, offset);
+            return 2; // wrong type
+        }
+
+        rapidjson::SizeType jsonArraySize = value.Size();
+        rapidjson::SizeType arraySize = jsonArraySize;
+
+        // limit the arraysize to the maximum
+        if (arraySize > N) {
+            sink.Report(0, JSON_ERROR_ARRAY_CLIPPED, FieldType(field), field.name, -1, offset, N, jsonArraySize);
+            arraySize = N;
+        }
+
+        bin.*field.count = (Count)arraySize;
+
+        Element (&elements)[N] = bin.*field.member;
+        uint32_t returnCode = 0;
+
+        for (rapidjson::SizeType arrayIdx = 0; arrayIdx < arraySize; arrayIdx++) {
+            uint32_t elementCode = JsonBindCodec<Element>::Decode(value[arrayIdx], elements[arrayIdx], field.name, (int32_t)arrayIdx, offset, sink);
+
+            if (elementCode == 3)
+                returnCode = 3; // string truncated, go on
+            else if (elementCode != 0)
+                return elementCode;
+        }
+
+        return returnCode;
+    }
+
+    template <size_t I>
+    static bool DecodeIfNamed(const char* key, rapidjson::SizeType length, const rapidjson::Value& value, Class& bin, uint64_t& seen,
+                              uint32_t offset, JsonErrorSink& sink, uint32_t& returnCode) {
+        // the length is a constant, it rules out most fields without looking at the name
+        if (length != std::get<I>(kFields).length || memcmp(key, std::get<I>(kFields).name, length) != 0)
+            return false;
+
+        // the first occurrence of a name counts, a later one is skipped (as by JSON_TextToBin)
+        if (seen & ((uint64_t)1 << I))
+            return true;
+
+        seen |= (uint64_t)1 << I;
+        returnCode = DecodeField(std::get<I>(kFields), value, bin, offset, sink);
+        return true;
+    }
+
+    template <size_t... I>
+    static uint32_t DecodeMember(const char* key, rapidjson::SizeType length, const rapidjson::Value& value, Class& bin, uint64_t& seen,
+                                 uint32_t offset, JsonErrorSink& sink, std::index_sequence<I...>) {
+        uint32_t returnCode = 0;
+
+        (DecodeIfNamed<I>(key, length, value, bin, seen, offset, sink, returnCode) || ...);
+
+        return returnCode;
+    }
+
+    template <size_t... I>
+    static void ReportMissing(size_t fieldIdx, JsonErrorSink& sink, std::index_sequence<I...>) {
+        ((I == fieldIdx ? sink.Report(1, JSON_ERROR_NOT_FOUND, FieldType(std::get<I>(kFields)), std::get<I>(kFields).name, -1, JSON_ERROR_NO_OFFSET)
+          : (void)0), ...);
+    }
+
+    template <size_t I>
+    static void EncodeName(rapidjson::StringBuffer& out) {
+        const uint32_t length = std::get<I>(kFields).length;
+
+        // ,"name":
+        char* pName = out.Push(length + (I ? 4 : 3));
+        if (I)
+            *pName++ = ',';
+        *pName++ = '"';
+        memcpy(pName, std::get<I>(kFields).name, length);
+        pName[length] = '"';
+        pName[length + 1] = ':';
+    }
+
+    template <typename Type>
+    static uint32_t EncodeField(const JsonBindField<Class, Type>& field, const Class& bin, rapidjson::StringBuffer& out, JsonErrorSink& sink) {
+        return JsonBindCodec<Type>::Encode(bin.*field.member, out, field.name, -1, sink);
+    }
+
+    template <typename Element, size_t N, typename Count>
+    static uint32_t EncodeField(const JsonBindArray<Class, Element, N, Count>& field, const Class& bin, rapidjson::StringBuffer& out,
+                                JsonErrorSink& sink) {
+        // the count of the binary array, never more than it holds
+        Count count = bin.*field.count;
+        size_t arraySize = count > 0 ? ((size_t)count < N ? (size_t)count : N) : 0;
+
+        const Element (&elements)[N] = bin.*field.member;
+
+        out.Put('[');
+
+        for (size_t arrayIdx = 0; arrayIdx < arraySize; arrayIdx++) {
+            if (arrayIdx)
+                out.Put(',');
+
+            uint32_t elementCode = JsonBindCodec<Element>::Encode(elements[arrayIdx], out, field.name, (int32_t)arrayIdx, sink);
+            if (elementCode != 0)
+                return elementCode;
+        }
+
+        out.Put(']');
+
+        return 0;
+    }
+
+    template <size_t I>
+    static bool EncodeMember(const Class& bin, rapidjson::StringBuffer& out, JsonErrorSink& sink, uint32_t& returnCode) {
+        EncodeName<I>(out);
+        returnCode = EncodeField(std::get<I>(kFields), bin, out, sink);
+        return returnCode == 0;
+    }
+
+    template <size_t... I>
+    static uint32_t EncodeMembers(const Class& bin, rapidjson::StringBuffer& out, JsonErrorSink& sink, std::index_sequence<I...>) {
+        uint32_t returnCode = 0;
+
+        // stops at the first member that fails
+        (EncodeMember<I>(bin, out, sink, returnCode) && ...);
+
+        return returnCode;
+    }
+};
+
+// decoder and encoder of a bound struct, keeps its DOM memory and output buffer from message to message:
+// the DOM and the parse stack live in a buffer of the binder (kPoolSize), only a larger document takes
+// chunks from the heap, they are freed again with the next message
+template <typename Class>
+class JsonBinder {
+  public:
+    static const size_t kPoolSize = 16 * 1024;
+
+    JsonBinder() : allocator(poolBuffer, sizeof(poolBuffer)), document(&allocator, kStackCapacity, &allocator) {
+    }
+
+    // decode jsonString (parsed in situ) into bin, returns what JSON_TextToBin would
+    uint32_t TextToBin(char* jsonString, Class& bin, JsonErrorInfo* pError = NULL) {
+        sink.Begin(jsonString, pError);
+
+        // the memory of the previous message is reused
+        document.SetNull();
+        allocator.Clear();
+
+        if (document.ParseInsitu(jsonString).HasParseError()) {
+            sink.Report(10, JSON_ERROR_PARSE, -1, NULL, -1, (uint32_t)document.GetErrorOffset());
+            return 10;
+        }
+
+        if (!document.IsObject()) {
+            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_OBJECT, NULL, -1, 0);
+            return 2; // wrong type
+        }
+
+        return JsonBindObject<Class>::Decode(document, bin, sink);
+    }
+
+    // encode bin into the output buffer (see GetString), returns what JSON_BinToText would
+    uint32_t BinToText(const Class& bin, JsonErrorInfo* pError = NULL) {
+        sink.Begin(NULL, pError);
+        buffer.Clear();
+
+        return JsonBindObject<Class>::Encode(bin, buffer, sink);
+    }
+
+    const char* GetString() {
+        return buffer.GetString();
+    }
+
+  private:
+    JsonBinder(const JsonBinder&);
+    JsonBinder& operator=(const JsonBinder&);
+
+    typedef rapidjson::GenericDocument<rapidjson::UTF8<>, rapidjson::MemoryPoolAllocator<>, rapidjson::MemoryPoolAllocator<> > Document;
+
+    static const size_t kStackCapacity = 1024;
+
+    alignas(8) unsigned char			poolBuffer[kPoolSize];
+    rapidjson::MemoryPoolAllocator<>	allocator;
+    Document							document;
+    rapidjson::StringBuffer				buffer;
+    JsonErrorSink						sink;
+};
+
+#endif /* JSONBIND_H_ */
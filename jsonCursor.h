@@ -0,0 +1,87 @@
+/*
+ * jsonCursor.h
+ *
+ * Member lookup for producers that emit the keys of an object in a fixed order
+ * (usually the order of the struct). A cursor remembers where its last match
+ * was found and compares the member after it first; only a miss scans the
+ * object from the start. Reading the members in the order they were sent costs
+ * one compare per member, however large the object is.
+ *
+ * If the order of the producer differs from the order the members are read in,
+ * the reader passes a position per member: the cursor tries the member at that
+ * position first and stores where it actually found the key. After the first
+ * message every lookup hits right away again (see PlanInterpret).
+ */
+
+#ifndef JSONCURSOR_H_
+#define JSONCURSOR_H_
+
+#include <stdint.h>
+#include <cstring>
+#include <utility>
+
+#include "jsonKey.h"
+
+constexpr uint32_t JSON_CURSOR_NO_POSITION = 0xFFFFFFFFu;
+
+// ObjectType is a rapidjson value, const for read-only access
+template <typename ObjectType> class JsonMemberCursor {
+  public:
+    typedef decltype(std::declval<ObjectType&>().MemberBegin()) Iterator;
+
+    explicit JsonMemberCursor(ObjectType &object) : begin(object.MemberBegin()), end(object.MemberEnd()), next(begin) {
+    }
+
+    // End() if the object has no such member
+    Iterator Find(const JsonKey &key) {
+        return Find(key.name, key.length);
+    }
+
+    Iterator Find(const char *name, uint32_t length) {
+        // the member after the last match, the usual case
+        if (next != end && Matches(next, name, length))
+            return next++;
+
+        Iterator it = begin;
+
+        for (; it != end; ++it) {
+            if (it != next && Matches(it, name, length)) {
+                next = it;
+                return next++;
+            }
+        }
+
+        return end;
+    }
+
+    // the member at position first, position is updated to where the key was found
+    // (JSON_CURSOR_NO_POSITION or any position out of range: no guess)
+    Iterator Find(const char *name, uint32_t length, uint32_t &position) {
+        if (position < (uint32_t)(end - begin) && Matches(begin + position, name, length)) {
+            next = begin + position;
+            return next++;
+        }
+
+        Iterator it = Find(name, length);
+
+        if (it != end)
+            position = (uint32_t)(it - begin);
+
+        return it;
+    }
+
+    Iterator End() const {
+        return end;
+    }
+
+  private:
+    static bool Matches(const Iterator &it, const char *name, uint32_t length) {
+        return it->name.GetStringLength() == length && memcmp(it->name.GetString(), name, length) == 0;
+    }
+
+    Iterator	begin;
+    Iterator	end;
+    Iterator	next;		// tried first by the next Find
+};
+
+#endif /* JSONCURSOR_H_ */
@@ -0,0 +1,243 @@
+//============================================================================
+// Name        : jsonDecodeCache.cpp
+// Description : Images of earlier decodes, found by the hash of the text
+//               (JSON_parserSetDecodeCache)
+//============================================================================
+
+#include <cstring>
+#include <iterator>
+
+#include "jsonDecodeCache.h"
+
+// besides the vectors: the entry, its list node and its index node
+static const size_t kEntryOverhead = sizeof(void*) * 8 + 64;
+
+static inline uint64_t Mix64(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+// 8 bytes per step, a whole message costs about what copying it does
+static uint64_t HashText(const char* text, size_t length) {
+    const uint64_t kMultiplier = 0x9E3779B97F4A7C15ull;
+    uint64_t hash = length * kMultiplier;
+    uint64_t word;
+
+    for (; length >= sizeof(word); text += sizeof(word), length -= sizeof(word)) {
+        memcpy(&word, text, sizeof(word));
+        hash = (hash ^ Mix64(word)) * kMultiplier;
+    }
+
+    word = 0;
+    memcpy(&word, text, length);
+
+    return Mix64(hash ^ word);
+}
+
+// the bytes a decode writes for a scalar
+static uint32_t ScalarSize(uint32_t dataType) {
+    switch (dataType) {
+    case JSON_INT:
+    case JSON_UINT:
+        return sizeof(int32_t);
+    case JSON_DOUBLE:
+        return sizeof(double);
+    case JSON_BOOL:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+JsonDecodeCache::JsonDecodeCache(size_t byteCapacity) : pPlan(NULL), capacity(byteCapacity), byteSize(0),
+    pendingHash(0), pending(false), hits(0), misses(0), evictions(0) {
+}
+
+bool JsonDecodeCache::Lookup(const JsonPlan* plan, const char* text, size_t length, unsigned char* bin, uint32_t binSize) {
+    if (plan != pPlan) {
+        Clear();
+        pPlan = plan;
+    }
+
+    uint64_t hash = HashText(text, length);
+    auto itIndex = index.find(hash);
+
+    if (itIndex != index.end()) {
+        const Entry& entry = *(itIndex->second);
+
+        bool fits = entry.text.size() == length && memcmp(entry.text.data(), text, length) == 0 && entry.extent <= binSize;
+
+        // the arrays of bin hold as many elements as the decode wrote (else it would have clipped them)
+        for (size_t arrayIdx = 0; fits && arrayIdx < entry.arrays.size(); arrayIdx++) {
+            int32_t maxElements;
+
+            memcpy(&maxElements, bin + entry.arrays[arrayIdx].offset, sizeof(maxElements));
+            fits = maxElements >= entry.arrays[arrayIdx].count;
+        }
+
+        if (fits) {
+            const unsigned char* pBytes = entry.bytes.data();
+
+            for (const JsonBinRange& range : entry.ranges) {
+                memcpy(bin + range.offset, pBytes, range.size);
+                pBytes += range.size;
+            }
+
+            entries.splice(entries.begin(), entries, itIndex->second);
+            hits++;
+            pending = false;
+            return true;
+        }
+    }
+
+    misses++;
+
+    pendingHash = hash;
+    pendingText.assign(text, text + length);
+    pending = true;
+
+    return false;
+}
+
+void JsonDecodeCache::Insert(const JsonPlan* plan, const unsigned char* bin) {
+    if (!pending || plan != pPlan || plan == NULL)
+        return;
+
+    pending = false;
+
+    // a text with the same hash goes
+    auto itIndex = index.find(pendingHash);
+
+    if (itIndex != index.end())
+        Drop(itIndex->second);
+
+    entries.emplace_front();
+
+    Entry& entry = entries.front();
+
+    entry.hash = pendingHash;
+    entry.text.swap(pendingText);
+    entry.extent = 0;
+
+    RecordObject(entry, *plan, plan->rootObject, bin, 0);
+
+    entry.byteSize = kEntryOverhead + entry.text.size() + entry.bytes.size() + entry.ranges.size() * sizeof(JsonBinRange)
+                     + entry.arrays.size() * sizeof(ArrayCount);
+
+    if (entry.byteSize > capacity) {
+        entries.pop_front();
+        return;
+    }
+
+    index[entry.hash] = entries.begin();
+    byteSize += entry.byteSize;
+
+    while (byteSize > capacity) {
+        Drop(std::prev(entries.end()));
+        evictions++;
+    }
+}
+
+void JsonDecodeCache::SetCapacity(size_t byteCapacity) {
+    capacity = byteCapacity;
+
+    while (byteSize > capacity) {
+        Drop(std::prev(entries.end()));
+        evictions++;
+    }
+}
+
+void JsonDecodeCache::Clear() {
+    entries.clear();
+    index.clear();
+    byteSize = 0;
+    pending = false;
+}
+
+void JsonDecodeCache::GetStats(JsonDecodeCacheStats& stats) const {
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.evictions = evictions;
+    stats.entries = entries.size();
+    stats.bytes = byteSize;
+    stats.capacity = capacity;
+}
+
+void JsonDecodeCache::RecordObject(Entry& entry, const JsonPlan& plan, uint32_t objectIdx, const unsigned char* bin, uint32_t baseOffset) {
+    const JsonPlanObject& object = plan.object(objectIdx);
+
+    for (uint32_t memberIdx = object.firstMember; memberIdx < object.firstMember + object.memberCount; memberIdx++) {
+        const JsonPlanMember& member = plan.member(memberIdx);
+        uint32_t offset = baseOffset + member.offsetInBinaryStruct;
+
+        if (member.jsonDataType == JSON_OBJECT) {
+            RecordObject(entry, plan, member.childObject, bin, offset);
+            continue;
+        }
+
+        if (member.jsonDataType < JSON_STRINGARRAY) {
+            RecordValue(entry, member.jsonDataType, member.sizeInBinaryStruct, bin, offset);
+            continue;
+        }
+
+        // the element count, then the elements
+        uint32_t countOffset = offset - (uint32_t)sizeof(int32_t);
+        int32_t count;
+
+        memcpy(&count, bin + countOffset, sizeof(count));
+
+        entry.arrays.push_back({countOffset, count});
+        RecordRange(entry, bin, countOffset, sizeof(int32_t));
+
+        uint32_t elementType = member.jsonDataType - JSON_STRINGARRAY + JSON_STRING;
+
+        for (int32_t arrayIdx = 0; arrayIdx < count; arrayIdx++) {
+            uint32_t elementOffset = offset + (uint32_t)arrayIdx * member.sizeInBinaryStruct;
+
+            if (elementType == JSON_OBJECT)
+                RecordObject(entry, plan, member.childObject, bin, elementOffset);
+            else
+                RecordValue(entry, elementType, member.sizeInBinaryStruct, bin, elementOffset);
+        }
+    }
+}
+
+void JsonDecodeCache::RecordValue(Entry& entry, uint32_t dataType, uint32_t size, const unsigned char* bin, uint32_t offset) {
+    if (dataType == JSON_STRING) {
+        size_t length = strnlen((const char*)bin + offset, size);
+
+        RecordRange(entry, bin, offset, (uint32_t)(length < size ? length + 1 : size));
+    } else
+        RecordRange(entry, bin, offset, ScalarSize(dataType));
+}
+
+// a range that goes on where the last one ended is merged with it
+void JsonDecodeCache::RecordRange(Entry& entry, const unsigned char* bin, uint32_t offset, uint32_t size) {
+    if (size == 0)
+        return;
+
+    if (!entry.ranges.empty() && entry.ranges.back().offset + entry.ranges.back().size == offset)
+        entry.ranges.back().size += size;
+    else
+        entry.ranges.push_back({offset, size});
+
+    entry.bytes.insert(entry.bytes.end(), bin + offset, bin + offset + size);
+
+    if (offset + size > entry.extent)
+        entry.extent = offset + size;
+}
+
+void JsonDecodeCache::Drop(std::list<Entry>::iterator itEntry) {
+    auto itIndex = index.find(itEntry->hash);
+
+    if (itIndex != index.end() && itIndex->second == itEntry)
+        index.erase(itIndex);
+
+    byteSize -= itEntry->byteSize;
+    entries.erase(itEntry);
+}
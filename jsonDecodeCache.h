@@ -0,0 +1,88 @@
+/*
+ * jsonDecodeCache.h
+ *
+ * Cache of the decodes of a parser handle (see JSON_parserSetDecodeCache), for
+ * producers that retransmit the same message byte by byte.
+ *
+ * An entry is found by a 64 bit hash of the text and keeps the text, a hit
+ * compares it (another text with the same hash is a miss). It holds the image
+ * of the decode: the parts of the binary struct that were written, with their
+ * bytes. Only a decode without any fault is stored, a member missing in the
+ * text is one, so that is every member of the plan: arrays up to their element
+ * count, strings up to their terminating 0. A hit copies the image to
+ * binBuffer once the element count in front of each array there (the capacity
+ * on entry) is checked to hold the elements of the image.
+ *
+ * The entries belong to a plan, another one drops them all. The least recently
+ * used entries go when the bytes held would exceed the capacity.
+ */
+
+#ifndef JSONDECODECACHE_H_
+#define JSONDECODECACHE_H_
+
+#include <stdint.h>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "jsonPlan.h"
+#include "jsonWrapper.h"
+
+class JsonDecodeCache {
+  public:
+    explicit JsonDecodeCache(size_t byteCapacity);
+
+    // copies the image of an earlier decode of text with plan to bin, false if there's none
+    // (the text is kept for Insert then, JSON_TextToBin parses it in situ)
+    bool Lookup(const JsonPlan* plan, const char* text, size_t length, unsigned char* bin, uint32_t binSize);
+
+    // the decode of the text of the last Lookup that missed, bin as the decode left it
+    void Insert(const JsonPlan* plan, const unsigned char* bin);
+
+    void SetCapacity(size_t byteCapacity);
+
+    void Clear();
+
+    void GetStats(JsonDecodeCacheStats& stats) const;
+
+  private:
+    struct ArrayCount {
+        uint32_t	offset;		// of the element count in front of the array
+        int32_t		count;
+    };
+
+    struct Entry {
+        uint64_t					hash;
+        std::vector<char>			text;
+        std::vector<JsonBinRange>	ranges;
+        std::vector<unsigned char>	bytes;		// of the ranges, one after the other
+        std::vector<ArrayCount>		arrays;
+        uint32_t					extent;		// end of the last byte written
+        size_t						byteSize;	// counted against the capacity
+    };
+
+    void RecordObject(Entry& entry, const JsonPlan& plan, uint32_t objectIdx, const unsigned char* bin, uint32_t baseOffset);
+
+    void RecordValue(Entry& entry, uint32_t dataType, uint32_t size, const unsigned char* bin, uint32_t offset);
+
+    void RecordRange(Entry& entry, const unsigned char* bin, uint32_t offset, uint32_t size);
+
+    void Drop(std::list<Entry>::iterator itEntry);
+
+    const JsonPlan*											pPlan;		// the entries belong to it
+    size_t													capacity;
+    size_t													byteSize;
+    std::list<Entry>										entries;	// the most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator>	index;
+
+    // the text of the last miss
+    uint64_t												pendingHash;
+    std::vector<char>										pendingText;
+    bool													pending;
+
+    uint64_t												hits;
+    uint64_t												misses;
+    uint64_t												evictions;
+};
+
+#endif /* JSONDECODECACHE_H_ */
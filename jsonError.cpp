@@ -0,0 +1,325 @@
+//============================================================================
+// Name        : jsonError.cpp
+// Description : Error records of the JSON wrapper and their deferred logging
+//============================================================================
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#if defined(OL91)
+#include <el/osal/logger.h>
+#endif
+
+#include "jsonError.h"
+
+static const char* ErrorTypeText(int32_t dataType) {
+    switch (dataType) {
+    case JSON_STRING:
+        return "a string";
+    case JSON_INT:
+        return "an int";
+    case JSON_UINT:
+        return "a uint";
+    case JSON_DOUBLE:
+        return "a double";
+    case JSON_BOOL:
+        return "a bool";
+    case JSON_OBJECT:
+        return "an object";
+    case JSON_STRINGARRAY:
+    case JSON_INTARRAY:
+    case JSON_UINTARRAY:
+    case JSON_DOUBLEARRAY:
+    case JSON_BOOLARRAY:
+    case JSON_OBJECTARRAY:
+        return "an array";
+    default:
+        return "a known type";
+    }
+}
+
+const char* JSON_errorText(const JsonErrorInfo* pError, char* text, size_t size) {
+
+    int length = 0;
+
+    switch (pError->reason) {
+    case JSON_ERROR_NONE:
+        length = snprintf(text, size, "JSON for PLC: no error.");
+        break;
+    case JSON_ERROR_PARSE:
+        length = snprintf(text, size, "JSON parsing error");
+        break;
+    case JSON_ERROR_NOT_FOUND:
+        length = snprintf(text, size, "JSON for PLC: \"%s\" not found.", pError->path);
+        break;
+    case JSON_ERROR_NOT_ADDED:
+        length = snprintf(text, size, "JSON for PLC: \"%s\" not added.", pError->path);
+        break;
+    case JSON_ERROR_WRONG_TYPE:
+        length = snprintf(text, size, "JSON for PLC: \"%s\" is not %s.", pError->path, ErrorTypeText(pError->expectedType));
+        break;
+    case JSON_ERROR_STRING_TRUNCATED:
+        length = snprintf(text, size, "JSON for PLC: \"%s\" insufficient binSize for string -> truncated.", pError->path);
+        break;
+    case JSON_ERROR_BINSIZE_TOO_SMALL:
+        length = snprintf(text, size, "JSON for PLC: \"%s\" insufficient binSize for dataType.", pError->path);
+        break;
+    case JSON_ERROR_BINSIZE_TOO_LARGE:
+        length = snprintf(text, size, "JSON for PLC: \"%s\" too large binSize for dataType.", pError->path);
+        break;
+    case JSON_ERROR_UNKNOWN_TYPE:
+        length = snprintf(text, size, "unknown JSON Type %d for \"%s\". I don't know how to handle it", pError->expectedType, pError->path);
+        break;
+    case JSON_ERROR_ARRAY_CLIPPED:
+        length = snprintf(text, size, "JSON for PLC - WARNING: binary arraySize (%u) for \"%s\" is less than JSON no of array elements (%u)",
+                          pError->binaryArraySize, pError->path, pError->jsonArraySize);
+        break;
+    }
+
+    if (pError->offset != JSON_ERROR_NO_OFFSET && length >= 0 && (size_t)length < size)
+        snprintf(text + length, size - length, " (offset %u)", pError->offset);
+
+    return text;
+}
+
+
+void JsonErrorSink::Begin(const char* jsonText, JsonErrorInfo* pErrorInfo, const char* jsonTextEnd) {
+    text = jsonText;
+    textEnd = jsonTextEnd;
+    pError = pErrorInfo;
+    severity = 0;
+    faultCount = 0;
+    segments.clear();
+
+    if (pError) {
+        pError->code = 0;
+        pError->reason = JSON_ERROR_NONE;
+        pError->expectedType = -1;
+        pError->offset = JSON_ERROR_NO_OFFSET;
+        pError->binaryArraySize = 0;
+        pError->jsonArraySize = 0;
+        pError->path[0] = 0;
+    }
+}
+
+// append a path segment, silently truncated at the end of the path
+static size_t AppendSegment(char* path, size_t length, const char* name, int32_t index) {
+    if (name && length < JSON_ERROR_PATH_SIZE) {
+        int written = snprintf(path + length, JSON_ERROR_PATH_SIZE - length, length ? ".%s" : "%s", name);
+        length = written < 0 ? length : std::min(length + written, JSON_ERROR_PATH_SIZE - 1);
+    }
+
+    if (index >= 0 && length < JSON_ERROR_PATH_SIZE) {
+        int written = snprintf(path + length, JSON_ERROR_PATH_SIZE - length, "[%d]", index);
+        length = written < 0 ? length : std::min(length + written, JSON_ERROR_PATH_SIZE - 1);
+    }
+
+    return length;
+}
+
+void JsonErrorSink::Report(uint32_t code, JsonErrorReason reason, int32_t expectedType, const char* name, int32_t index, uint32_t offset,
+                           uint32_t binaryArraySize, uint32_t jsonArraySize) {
+    JsonErrorInfo info;
+
+    info.code = code;
+    info.reason = reason;
+    info.expectedType = expectedType;
+    info.offset = offset;
+    info.binaryArraySize = binaryArraySize;
+    info.jsonArraySize = jsonArraySize;
+    info.path[0] = 0;
+
+    size_t length = 0;
+    for (const Segment& segment : segments)
+        length = AppendSegment(info.path, length, segment.name, segment.index);
+    AppendSegment(info.path, length, name, index);
+
+    JSON_logPost(info);
+    faultCount++;
+
+    // the caller gets the most severe fault, the first one of equal severity
+    uint32_t infoSeverity = reason == JSON_ERROR_ARRAY_CLIPPED ? 1 : (reason == JSON_ERROR_STRING_TRUNCATED ? 2 : 3);
+
+    if (pError && infoSeverity > severity) {
+        *pError = info;
+        severity = infoSeverity;
+    }
+}
+
+
+// bounded multi-producer queue (Vyukov): every cell carries a sequence number telling
+// producers and the consumer whose turn it is, so posting never takes a lock
+class JsonLog {
+  public:
+    JsonLog() : enqueuePos(0), dequeuePos(0), written(0), stop(false),
+        rateLimit(kDefaultRateLimit), windowStart(0), windowCount(0), suppressed(0) {
+        for (size_t idx = 0; idx < kQueueSize; idx++)
+            cells[idx].sequence.store(idx, std::memory_order_relaxed);
+    }
+
+    ~JsonLog() {
+        if (worker.joinable()) {
+            stop.store(true, std::memory_order_release);
+            worker.join();
+        }
+    }
+
+    void Post(const JsonErrorInfo& info) {
+        if (!Admit())
+            return;
+
+        std::call_once(started, [this]() {
+            worker = std::thread(&JsonLog::Drain, this);
+        });
+
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+
+        for (;;) {
+            Cell& cell = cells[pos & (kQueueSize - 1)];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.info = info;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return;
+                }
+            } else if (diff < 0) {
+                // full, the background thread can't keep up
+                suppressed.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void Flush() {
+        size_t target = enqueuePos.load(std::memory_order_acquire);
+
+        while (written.load(std::memory_order_acquire) < target)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    void SetRateLimit(uint32_t messagesPerSecond) {
+        rateLimit.store(messagesPerSecond, std::memory_order_relaxed);
+    }
+
+  private:
+    static const size_t kQueueSize = 256;			// power of 2
+    static const uint32_t kDefaultRateLimit = 100;	// messages per second
+
+    struct Cell {
+        std::atomic<size_t>	sequence;
+        JsonErrorInfo		info;
+    };
+
+    // at most rateLimit messages per second (concurrent posters may overshoot by a few)
+    bool Admit() {
+        uint32_t limit = rateLimit.load(std::memory_order_relaxed);
+        uint64_t now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        uint64_t window = windowStart.load(std::memory_order_relaxed);
+
+        if (now != window && windowStart.compare_exchange_strong(window, now, std::memory_order_relaxed))
+            windowCount.store(0, std::memory_order_relaxed);
+
+        if (windowCount.fetch_add(1, std::memory_order_relaxed) >= limit) {
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool Pop(JsonErrorInfo& info) {
+        Cell& cell = cells[dequeuePos & (kQueueSize - 1)];
+
+        if (cell.sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+            return false;
+
+        info = cell.info;
+        cell.sequence.store(dequeuePos + kQueueSize, std::memory_order_release);
+        dequeuePos++;
+
+        return true;
+    }
+
+    void Drain() {
+        JsonErrorInfo info;
+        char text[256];
+        std::chrono::steady_clock::time_point lastSuppressed = std::chrono::steady_clock::now();
+
+        for (;;) {
+            if (Pop(info)) {
+                JSON_errorText(&info, text, sizeof(text));
+
+                // indicate error to console & logfile
+                std::cout << text << std::endl;
+#if defined(OL91)
+                el_logff(LOG_NOTICE, "%s\n", text);
+#endif
+                written.fetch_add(1, std::memory_order_release);
+                continue;
+            }
+
+            bool stopping = stop.load(std::memory_order_acquire);
+
+            // the count of suppressed messages at most once a second
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            uint64_t dropped = 0;
+
+            if (stopping || now - lastSuppressed >= std::chrono::seconds(1)) {
+                dropped = suppressed.exchange(0, std::memory_order_relaxed);
+                lastSuppressed = now;
+            }
+
+            if (dropped) {
+                std::cout << "JSON for PLC: " << dropped << " messages suppressed." << std::endl;
+#if defined(OL91)
+                el_logff(LOG_NOTICE, "JSON for PLC: %llu messages suppressed.\n", (unsigned long long)dropped);
+#endif
+            }
+
+            if (stopping && written.load(std::memory_order_relaxed) == enqueuePos.load(std::memory_order_acquire))
+                return;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    Cell					cells[kQueueSize];
+    std::atomic<size_t>		enqueuePos;
+    size_t					dequeuePos;		// the background thread's only
+    std::atomic<size_t>		written;
+    std::atomic<bool>		stop;
+    std::atomic<uint32_t>	rateLimit;
+    std::atomic<uint64_t>	windowStart;
+    std::atomic<uint32_t>	windowCount;
+    std::atomic<uint64_t>	suppressed;
+    std::once_flag			started;
+    std::thread				worker;
+};
+
+static JsonLog& Log() {
+    static JsonLog log;
+    return log;
+}
+
+void JSON_logPost(const JsonErrorInfo& info) {
+    Log().Post(info);
+}
+
+void JSON_logSetRateLimit(uint32_t messagesPerSecond) {
+    Log().SetRateLimit(messagesPerSecond);
+}
+
+void JSON_logFlush() {
+    Log().Flush();
+}
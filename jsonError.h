@@ -0,0 +1,81 @@
+/*
+ * jsonError.h
+ *
+ * Error reporting of the decode and encode paths without I/O on the caller's thread.
+ *
+ * A JsonErrorSink collects the JSON path of the value being worked on and turns
+ * a failure into a JsonErrorInfo record: into the caller's record (if one was
+ * given) and into the log queue. The queue is a bounded lock-free ring drained
+ * by a background thread, which formats the records and writes them to the
+ * console (and el_logff).
+ */
+
+#ifndef JSONERROR_H_
+#define JSONERROR_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "jsonWrapper.h"
+
+class JsonErrorSink {
+  public:
+    JsonErrorSink() : text(NULL), textEnd(NULL), pError(NULL), severity(0), faultCount(0) {
+    }
+
+    // prepare for the next message, text is the JSON text offsets refer to (NULL if there is none),
+    // jsonTextEnd its end if it isn't parsed in situ (a DOM's strings are no positions in the text then)
+    void Begin(const char* jsonText, JsonErrorInfo* pErrorInfo, const char* jsonTextEnd = NULL);
+
+    // enter a member or an array element, names have to stay valid until they are popped
+    void Push(const char* name) {
+        segments.push_back({name, -1});
+    }
+
+    void PushIndex(int32_t index) {
+        segments.push_back({NULL, index});
+    }
+
+    void Pop() {
+        segments.pop_back();
+    }
+
+    void ClearPath() {
+        segments.clear();
+    }
+
+    // byte offset of a position in the JSON text (e.g. the string of a key parsed in situ)
+    uint32_t Offset(const char* pTextPos) const {
+        if (text == NULL || pTextPos == NULL || pTextPos < text || (textEnd && pTextPos > textEnd))
+            return JSON_ERROR_NO_OFFSET;
+
+        return (uint32_t)(pTextPos - text);
+    }
+
+    // record a fault of the current value, name and index (if not NULL/-1) complete the path
+    void Report(uint32_t code, JsonErrorReason reason, int32_t expectedType, const char* name, int32_t index, uint32_t offset,
+                uint32_t binaryArraySize = 0, uint32_t jsonArraySize = 0);
+
+    // faults reported since Begin, warnings included
+    uint32_t GetFaultCount() const {
+        return faultCount;
+    }
+
+  private:
+    struct Segment {
+        const char*		name;	// NULL for an array element
+        int32_t			index;
+    };
+
+    const char*				text;
+    const char*				textEnd;	// NULL: in situ, up to the terminating 0
+    JsonErrorInfo*			pError;
+    uint32_t				severity;	// of the error in pError: 0 none, 1 warning, 2 truncation, 3 fatal
+    uint32_t				faultCount;
+    std::vector<Segment>	segments;
+};
+
+// queue a record for the background thread (rate limited, dropped if the queue is full)
+void JSON_logPost(const JsonErrorInfo& info);
+
+#endif /* JSONERROR_H_ */
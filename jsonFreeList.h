@@ -0,0 +1,69 @@
+/*
+ * jsonFreeList.h
+ *
+ * Lock-free stack of the indices 0 .. capacity-1 (Treiber stack), used to hand out
+ * pre-built parser handles to threads without a mutex (see JSON_parserPoolAcquire).
+ *
+ * The head carries a tag besides the index that changes with every push and pop,
+ * so a thread holding a stale head can't win the compare-and-swap (ABA).
+ */
+
+#ifndef JSONFREELIST_H_
+#define JSONFREELIST_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+
+class JsonFreeList {
+  public:
+    static const uint32_t kEmpty = 0xFFFFFFFF;
+
+    // all indices are on the list
+    explicit JsonFreeList(uint32_t capacity) : next(new std::atomic<uint32_t>[capacity]),
+        head(Pack(0, capacity ? 0 : kEmpty)) {
+        for (uint32_t idx = 0; idx < capacity; idx++)
+            next[idx].store(idx + 1 < capacity ? idx + 1 : kEmpty, std::memory_order_relaxed);
+    }
+
+    // kEmpty if all indices are taken
+    uint32_t Pop() {
+        uint64_t oldHead = head.load(std::memory_order_acquire);
+
+        for (;;) {
+            uint32_t idx = (uint32_t)oldHead;
+
+            if (idx == kEmpty)
+                return kEmpty;
+
+            // may be stale if idx was popped meanwhile, the tag makes the CAS fail then
+            uint32_t nextIdx = next[idx].load(std::memory_order_relaxed);
+
+            if (head.compare_exchange_weak(oldHead, Pack((uint32_t)(oldHead >> 32) + 1, nextIdx),
+                                           std::memory_order_acquire, std::memory_order_acquire))
+                return idx;
+        }
+    }
+
+    void Push(uint32_t idx) {
+        uint64_t oldHead = head.load(std::memory_order_relaxed);
+
+        for (;;) {
+            next[idx].store((uint32_t)oldHead, std::memory_order_relaxed);
+
+            if (head.compare_exchange_weak(oldHead, Pack((uint32_t)(oldHead >> 32) + 1, idx),
+                                           std::memory_order_release, std::memory_order_relaxed))
+                return;
+        }
+    }
+
+  private:
+    static uint64_t Pack(uint32_t tag, uint32_t idx) {
+        return ((uint64_t)tag << 32) | idx;
+    }
+
+    std::unique_ptr<std::atomic<uint32_t>[]>	next;	// the index below idx on the stack
+    std::atomic<uint64_t>						head;	// tag << 32 | index of the top
+};
+
+#endif /* JSONFREELIST_H_ */
@@ -0,0 +1,327 @@
+//============================================================================
+// Name        : jsonIncremental.cpp
+// Description : Decodes only the values whose text changed since the last
+//               message (JSON_DECODE_INCREMENTAL)
+//============================================================================
+
+#include <cstring>
+
+#include "jsonIncremental.h"
+
+using namespace rapidjson;
+
+static const uint64_t kFingerprintOffset = 14695981039346656037ull;
+static const uint64_t kFingerprintPrime = 1099511628211ull;
+
+static uint64_t Fingerprint64(const char* pText, const char* pEnd) {
+    uint64_t hash = kFingerprintOffset;
+
+    for (; pText < pEnd; pText++) {
+        hash ^= (unsigned char)*pText;
+        hash *= kFingerprintPrime;
+    }
+
+    return hash;
+}
+
+static bool IsWhitespace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static char* SkipWhitespace(char* p) {
+    if (IsWhitespace(*p))
+        p = const_cast<char*>(jsonSimdKernels.skipWhitespace(p));
+
+    return p;
+}
+
+// p at the opening quote: the position after the closing one, NULL if the string isn't closed
+static char* SkipString(char* p) {
+    for (p++;; p++) {
+        // the plain characters in one go
+        p += jsonSimdKernels.scanString(p);
+
+        if (*p == '"')
+            return p + 1;
+
+        if (*p == 0)
+            return NULL;
+
+        if (*p == '\\' && *++p == 0)
+            return NULL;
+    }
+}
+
+// the end of the value at p, NULL if it isn't closed (the rest is up to the reader or was checked before)
+static char* SkipValue(char* p) {
+    if (*p == '"')
+        return SkipString(p);
+
+    if (*p == '{' || *p == '[') {
+        uint32_t depth = 0;
+
+        for (;;) {
+            switch (*p) {
+            case 0:
+                return NULL;
+
+            case '"':
+                p = SkipString(p);
+                if (p == NULL)
+                    return NULL;
+                continue;
+
+            case '{':
+            case '[':
+                depth++;
+                break;
+
+            case '}':
+            case ']':
+                if (--depth == 0)
+                    return p + 1;
+                break;
+            }
+
+            p++;
+        }
+    }
+
+    // a number or a literal
+    char* pStart = p;
+
+    while (*p != 0 && *p != ',' && *p != '}' && *p != ']' && !IsWhitespace(*p))
+        p++;
+
+    return p == pStart ? NULL : p;
+}
+
+// the key of a member, for keys with escapes only
+struct JsonKeyHandler : public BaseReaderHandler<UTF8<>, JsonKeyHandler> {
+    bool String(const char* str, SizeType length, bool) {
+        pKey = str;
+        keyLength = length;
+        return true;
+    }
+
+    bool Default() {
+        return false;
+    }
+
+    const char*	pKey;
+    uint32_t	keyLength;
+};
+
+uint32_t JsonIncrementalDecoder::Decode(const JsonPlan* plan, char* jsonString, unsigned char* bin, JsonErrorSink* sink) {
+    JsonInsituStream stream(jsonString);
+
+    pPlan = plan;
+    binBuffer = bin;
+    pSink = sink;
+    pText = jsonString;
+    pStream = &stream;
+
+    writtenRanges.clear();
+
+    // fingerprints of another plan or another binary struct say nothing
+    if (plan != pLastPlan || bin != pLastBin) {
+        fingerprints.assign(plan->memberCount, Fingerprint());
+        pLastPlan = plan;
+        pLastBin = bin;
+    }
+
+    decoder.Reset(plan, bin, sink, &stream.src_);
+
+    char* p = SkipWhitespace(jsonString);
+    uint32_t returnCode;
+
+    if (*p == '{') {
+        stream.src_ = p + 1;
+
+        // the root frame
+        decoder.StartObject();
+
+        returnCode = DecodeObject(plan->rootObject, 0);
+
+        if (returnCode == 0 || returnCode == 3) {
+            p = SkipWhitespace(stream.src_);
+
+            if (*p != 0)
+                returnCode = ParseError(p);
+        }
+    } else {
+        char* pEnd = *p ? SkipValue(p) : NULL;
+
+        // the root has to be an object
+        if (pEnd && *SkipWhitespace(pEnd) == 0) {
+            sink->Report(2, JSON_ERROR_WRONG_TYPE, JSON_OBJECT, NULL, -1, sink->Offset(p));
+            returnCode = 2;
+        } else
+            returnCode = ParseError(p);
+    }
+
+    // the binary struct may be half written, the next message is decoded in full
+    if (returnCode != 0 && returnCode != 3) {
+        pLastPlan = NULL;
+        pLastBin = NULL;
+    }
+
+    return returnCode;
+}
+
+// from after the opening brace to after the closing one
+uint32_t JsonIncrementalDecoder::DecodeObject(uint32_t objectIdx, uint32_t baseOffset) {
+    char*& p = pStream->src_;
+    uint32_t returnCode = 0;
+
+    p = SkipWhitespace(p);
+
+    if (*p == '}')
+        p++;
+    else {
+        for (;;) {
+            if (*p != '"')
+                return ParseError(p);
+
+            const char* pKey = p + 1;
+            char* pKeyEnd = SkipString(p);
+
+            if (pKeyEnd == NULL)
+                return ParseError(p);
+
+            uint32_t keyLength = (uint32_t)(pKeyEnd - 1 - pKey);
+
+            // the reader unescapes it in situ
+            if (memchr(pKey, '\\', keyLength)) {
+                JsonKeyHandler keyHandler;
+
+                reader.Parse<kParseInsituFlag | kParseStopWhenDoneFlag>(*pStream, keyHandler);
+
+                if (reader.HasParseError())
+                    return ParseError(pText + reader.GetErrorOffset());
+
+                pKey = keyHandler.pKey;
+                keyLength = keyHandler.keyLength;
+            }
+
+            p = SkipWhitespace(pKeyEnd);
+
+            if (*p != ':')
+                return ParseError(p);
+
+            char* pValue = SkipWhitespace(p + 1);
+            char* pValueEnd = SkipValue(pValue);
+
+            if (pValueEnd == NULL)
+                return ParseError(pValue);
+
+            uint32_t memberIdx = objectIdx == JSON_PLAN_NO_OBJECT ? JSON_PLAN_NO_MEMBER : pPlan->findMember(objectIdx, pKey, keyLength);
+
+            // members the plan doesn't describe are skipped, as are repeated ones
+            if (memberIdx != JSON_PLAN_NO_MEMBER && decoder.SetMember(memberIdx)) {
+                uint32_t planMemberIdx = pPlan->object(objectIdx).firstMember + memberIdx;
+                const JsonPlanMember& member = pPlan->member(planMemberIdx);
+                uint32_t binOffset = baseOffset + member.offsetInBinaryStruct;
+                uint32_t memberCode;
+
+                if (member.jsonDataType == JSON_OBJECT && *pValue == '{') {
+                    // an object of the plan is compared member by member
+                    decoder.StartObject();
+                    p = pValue + 1;
+
+                    memberCode = DecodeObject(member.childObject, binOffset);
+                } else
+                    memberCode = DecodeValue(planMemberIdx, binOffset, member, pValue, pValueEnd);
+
+                if (memberCode == 3)
+                    returnCode = 3; // string truncated, go on with the next member
+                else if (memberCode != 0)
+                    return memberCode;
+            }
+
+            p = SkipWhitespace(pValueEnd);
+
+            if (*p == '}') {
+                p++;
+                break;
+            }
+
+            if (*p != ',')
+                return ParseError(p);
+
+            p = SkipWhitespace(p + 1);
+        }
+    }
+
+    // every member of the plan has to show up
+    if (!decoder.EndObject(0))
+        return decoder.GetReturnCode();
+
+    return returnCode;
+}
+
+uint32_t JsonIncrementalDecoder::DecodeValue(uint32_t planMemberIdx, uint32_t binOffset, const JsonPlanMember& member, char* pValue,
+        char* pValueEnd) {
+
+    Fingerprint& fingerprint = fingerprints[planMemberIdx];
+    uint32_t length = (uint32_t)(pValueEnd - pValue);
+    uint64_t hash = Fingerprint64(pValue, pValueEnd);
+
+    // the element count goes to a required 'int' just before the array, it holds the maximum on entry
+    bool isArray = member.jsonDataType >= JSON_STRINGARRAY && member.jsonDataType <= JSON_OBJECTARRAY && *pValue == '[';
+    int32_t* pCount = isArray ? (int32_t*)(binBuffer + binOffset - sizeof(int32_t)) : NULL;
+    int32_t arrayMax = isArray ? *pCount : 0;
+
+    if (fingerprint.length == length && fingerprint.hash == hash && fingerprint.binOffset == binOffset
+            && (!isArray || fingerprint.arrayMax == arrayMax)) {
+        decoder.KeepMember();
+
+        if (isArray)
+            *pCount = fingerprint.arrayCount;
+
+        return 0;
+    }
+
+    // none until the value is decoded without a fault
+    fingerprint.length = 0;
+
+    decoder.ClearReturnCode();
+    pStream->src_ = pValue;
+
+    reader.Parse<kParseInsituFlag | kParseStopWhenDoneFlag>(*pStream, decoder);
+
+    uint32_t returnCode = decoder.GetReturnCode();
+
+    if (reader.HasParseError()) {
+        // a decoding error stops the reader, too
+        if (returnCode != 0 && returnCode != 3)
+            return returnCode;
+
+        pSink->Report(10, JSON_ERROR_PARSE, -1, NULL, -1, (uint32_t)reader.GetErrorOffset());
+        return 10;
+    }
+
+    // e.g. 12x, the scan took it for one value
+    if (pStream->src_ != pValueEnd)
+        return ParseError(pStream->src_);
+
+    if (isArray)
+        writtenRanges.push_back({binOffset - (uint32_t)sizeof(int32_t), (uint32_t)(sizeof(int32_t) + *pCount * member.sizeInBinaryStruct)});
+    else
+        writtenRanges.push_back({binOffset, member.sizeInBinaryStruct});
+
+    if (returnCode == 0) {
+        fingerprint.hash = hash;
+        fingerprint.length = length;
+        fingerprint.binOffset = binOffset;
+        fingerprint.arrayMax = arrayMax;
+        fingerprint.arrayCount = isArray ? *pCount : 0;
+    }
+
+    return returnCode;
+}
+
+uint32_t JsonIncrementalDecoder::ParseError(const char* pPos) {
+    pSink->Report(10, JSON_ERROR_PARSE, -1, NULL, -1, pSink->Offset(pPos));
+    return 10;
+}
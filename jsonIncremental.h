@@ -0,0 +1,90 @@
+/*
+ * jsonIncremental.h
+ *
+ * JSON_DECODE_INCREMENTAL: for producers that resend the whole message every
+ * cycle with only a few values changed.
+ *
+ * The decoder walks the objects of the plan with a structural scan only
+ * (strings, brackets, commas) and keeps a fingerprint per plan member: a 64 bit
+ * FNV-1a hash and the length of the raw text of its value. A value whose text
+ * matches the fingerprint of the last message is skipped entirely, the binary
+ * struct still holds it. Any other value is decoded by the SAX decoder (see
+ * jsonSaxDecoder.h) and reported as a written range of the binary struct.
+ * Objects of the plan are walked member by member, arrays are one value.
+ *
+ * That only holds as long as nobody else writes the binary struct: the caller
+ * passes the same binBuffer every time and leaves it as it is, besides the
+ * element count in front of an array (an unchanged array gets its count back).
+ * Another binBuffer, another plan or a message that failed start over with a
+ * full decode.
+ *
+ * Return codes and error records are the ones of JSON_DECODE_SAX. The text of
+ * unchanged values and of members the plan doesn't describe is only checked
+ * for its structure.
+ */
+
+#ifndef JSONINCREMENTAL_H_
+#define JSONINCREMENTAL_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/reader.h"
+
+#include "jsonPlan.h"
+#include "jsonSaxDecoder.h"
+#include "jsonSimd.h"
+#include "jsonError.h"
+
+class JsonIncrementalDecoder {
+  public:
+    JsonIncrementalDecoder() : pLastPlan(NULL), pLastBin(NULL), pPlan(NULL), binBuffer(NULL), pSink(NULL), pText(NULL), pStream(NULL) {
+    }
+
+    // the next message is decoded in full
+    void Invalidate() {
+        pLastPlan = NULL;
+        pLastBin = NULL;
+        writtenRanges.clear();
+    }
+
+    // the return codes of JSON_TextToBin
+    uint32_t Decode(const JsonPlan* plan, char* jsonString, unsigned char* bin, JsonErrorSink* sink);
+
+    // the parts of the binary struct the last Decode wrote, in the order of the text
+    const std::vector<JsonBinRange>& GetWrittenRanges() const {
+        return writtenRanges;
+    }
+
+  private:
+    struct Fingerprint {
+        uint64_t	hash;			// of the raw value text
+        uint32_t	length;			// 0: none
+        uint32_t	binOffset;		// where the value went, a plan member may be reached on more than one path
+        int32_t		arrayMax;		// arrays: the element count in front of the array on entry
+        int32_t		arrayCount;		// arrays: the element count written
+    };
+
+    uint32_t DecodeObject(uint32_t objectIdx, uint32_t baseOffset);
+
+    uint32_t DecodeValue(uint32_t planMemberIdx, uint32_t binOffset, const JsonPlanMember& member, char* pValue, char* pValueEnd);
+
+    uint32_t ParseError(const char* pPos);
+
+    const JsonPlan*						pLastPlan;		// the fingerprints belong to these
+    const unsigned char*				pLastBin;
+    std::vector<Fingerprint>			fingerprints;	// per plan member
+    std::vector<JsonBinRange>			writtenRanges;
+
+    // the message being decoded
+    const JsonPlan*						pPlan;
+    unsigned char*						binBuffer;
+    JsonErrorSink*						pSink;
+    char*								pText;
+    JsonInsituStream*					pStream;
+    RAPIDJSON_NAMESPACE::Reader			reader;
+    JsonSaxDecoder						decoder;
+};
+
+#endif /* JSONINCREMENTAL_H_ */
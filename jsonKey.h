@@ -0,0 +1,79 @@
+/*
+ * jsonKey.h
+ *
+ * Member names with their length and hash known up front. A key made from a
+ * string literal with JSON_KEY is a constant: neither strlen nor hashing is
+ * left for runtime.
+ *
+ * The DOM stores the length of every member name but no hash, so a DOM lookup
+ * (JSON_findMember) compares lengths and runs memcmp on equal ones only. The
+ * compiled plan hashes its member names, a key goes straight to its slot there
+ * (JsonPlan::findMember).
+ */
+
+#ifndef JSONKEY_H_
+#define JSONKEY_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <cstring>
+
+// FNV-1a, used to precompute the hash of every member name
+constexpr uint32_t JSON_hashKey(const char* key, size_t length) {
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)key[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+// up to the first 0 (a literal has none but its terminator, a char buffer may)
+constexpr uint32_t JSON_keyLength(const char* key, size_t size) {
+    uint32_t length = 0;
+
+    while (length < size && key[length] != 0)
+        length++;
+
+    return length;
+}
+
+struct JsonKey {
+    // from a literal or char array, implicit: GetValue(jval, "schemaVersion", ...)
+    // (a constant only where the compiler folds it, JSON_KEY makes sure it does)
+    template <size_t N>
+    constexpr JsonKey(const char (&key)[N]) : name(key), length(JSON_keyLength(key, N)), hash(JSON_hashKey(key, JSON_keyLength(key, N))) {
+    }
+
+    // from a name only known at runtime
+    explicit JsonKey(const char* key) : name(key), length((uint32_t)strlen(key)), hash(JSON_hashKey(key, length)) {
+    }
+
+    constexpr JsonKey(const char* key, uint32_t keyLength) : name(key), length(keyLength), hash(JSON_hashKey(key, keyLength)) {
+    }
+
+    const char*		name;
+    uint32_t		length;
+    uint32_t		hash;
+};
+
+// a key computed at compile time: GetValue(jval, JSON_KEY("schemaVersion"), ...)
+#define JSON_KEY(literal) ([]() -> const JsonKey& { static constexpr JsonKey key(literal, JSON_keyLength(literal, sizeof(literal))); return key; }())
+
+// FindMember without strlen: lengths first, memcmp on equal ones only
+template <typename ValueType>
+typename ValueType::ConstMemberIterator JSON_findMember(const ValueType& jval, const JsonKey& key) {
+    typename ValueType::ConstMemberIterator it = jval.MemberBegin();
+    typename ValueType::ConstMemberIterator end = jval.MemberEnd();
+
+    for (; it != end; ++it) {
+        if (it->name.GetStringLength() == key.length && memcmp(it->name.GetString(), key.name, key.length) == 0)
+            break;
+    }
+
+    return it;
+}
+
+#endif /* JSONKEY_H_ */
@@ -0,0 +1,273 @@
+//============================================================================
+// Name        : jsonLines.cpp
+// Description : JSON Lines (a message per line) mapped from a file, split
+//               into lines on all cores and decoded with the batch threads
+//============================================================================
+
+#include <stdio.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JSON_LINES_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "jsonWrapper.h"
+#include "jsonSimd.h"
+#include "jsonThreadPool.h"
+
+// below this per thread a file is split on the calling thread alone
+static const size_t kLinesChunkSize = 4 * 1024 * 1024;
+
+struct RW_Lines {
+    const char*					text;
+    size_t						length;
+    void*						pMapping;		// the mapped file, NULL if there's none
+    size_t						mappingSize;
+    std::vector<char>			fileText;		// the file read in where there's no mmap
+    std::vector<const char*>	messages;		// in the order of the lines
+    std::vector<size_t>			lengths;
+};
+
+// the messages of the lines that start within [chunkBegin, chunkEnd) of the text
+static void SplitLines(const char* text, size_t length, size_t chunkBegin, size_t chunkEnd,
+                       std::vector<const char*>& messages, std::vector<size_t>& lengths) {
+    const char* pEnd = text + length;
+    const char* p = text + chunkBegin;
+
+    // the line cut by the start of the chunk belongs to the chunk before
+    if (chunkBegin != 0 && p[-1] != '\n') {
+        p = jsonSimdKernels.findNewline(p, pEnd);
+
+        if (p != pEnd)
+            p++;
+    }
+
+    while (p < text + chunkEnd) {
+        const char* pLineEnd = jsonSimdKernels.findNewline(p, pEnd);
+        const char* pMessageEnd = pLineEnd;
+
+        if (pMessageEnd != p && pMessageEnd[-1] == '\r')
+            pMessageEnd--;
+
+        const char* pFirst = p;
+
+        while (pFirst != pMessageEnd && JSON_simdIsWhitespace(*pFirst))
+            pFirst++;
+
+        if (pFirst != pMessageEnd) {
+            messages.push_back(p);
+            lengths.push_back((size_t)(pMessageEnd - p));
+        }
+
+        if (pLineEnd == pEnd)
+            break;
+
+        p = pLineEnd + 1;
+    }
+}
+
+static void IndexLines(RW_Lines* pLines) {
+    unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    threadCount = (unsigned int)std::min<size_t>(threadCount, pLines->length / kLinesChunkSize);
+
+    if (threadCount <= 1) {
+        SplitLines(pLines->text, pLines->length, 0, pLines->length, pLines->messages, pLines->lengths);
+        return;
+    }
+
+    // a chunk per thread, put together in the order of the chunks
+    size_t chunkSize = pLines->length / threadCount;
+    std::vector<std::vector<const char*> > chunkMessages(threadCount);
+    std::vector<std::vector<size_t> > chunkLengths(threadCount);
+
+    JsonThreadPool threadPool(threadCount);
+
+    threadPool.Run([&](unsigned int threadIdx) {
+        size_t chunkBegin = threadIdx * chunkSize;
+        size_t chunkEnd = threadIdx + 1 == threadCount ? pLines->length : chunkBegin + chunkSize;
+
+        SplitLines(pLines->text, pLines->length, chunkBegin, chunkEnd, chunkMessages[threadIdx], chunkLengths[threadIdx]);
+    });
+
+    size_t messageCount = 0;
+
+    for (const auto& messages : chunkMessages)
+        messageCount += messages.size();
+
+    pLines->messages.reserve(messageCount);
+    pLines->lengths.reserve(messageCount);
+
+    for (unsigned int threadIdx = 0; threadIdx < threadCount; threadIdx++) {
+        pLines->messages.insert(pLines->messages.end(), chunkMessages[threadIdx].begin(), chunkMessages[threadIdx].end());
+        pLines->lengths.insert(pLines->lengths.end(), chunkLengths[threadIdx].begin(), chunkLengths[threadIdx].end());
+    }
+}
+
+static RW_Lines* NewLines(const char* text, size_t length) {
+    RW_Lines* pLines = new RW_Lines;
+
+    pLines->text = text;
+    pLines->length = length;
+    pLines->pMapping = NULL;
+    pLines->mappingSize = 0;
+
+    return pLines;
+}
+
+#ifdef JSON_LINES_MMAP
+
+static RW_Lines* MapFile(const char* path) {
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return NULL;
+
+    struct stat fileStat;
+
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t length = (size_t)fileStat.st_size;
+
+    // nothing to map
+    if (length == 0) {
+        close(fd);
+        return NewLines("", 0);
+    }
+
+    void* pMapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // the mapping holds its own reference to the file
+    close(fd);
+
+    if (pMapping == MAP_FAILED)
+        return NULL;
+
+    // read once from the front to the back, by the splitting and again by the decoding
+    madvise(pMapping, length, MADV_SEQUENTIAL);
+
+    RW_Lines* pLines = NewLines((const char*)pMapping, length);
+
+    pLines->pMapping = pMapping;
+    pLines->mappingSize = length;
+
+    return pLines;
+}
+
+#else
+
+static RW_Lines* MapFile(const char* path) {
+    FILE* pFile = fopen(path, "rb");
+
+    if (pFile == NULL)
+        return NULL;
+
+    RW_Lines* pLines = NewLines("", 0);
+    char block[65536];
+    size_t blockLength;
+
+    while ((blockLength = fread(block, 1, sizeof(block), pFile)) != 0)
+        pLines->fileText.insert(pLines->fileText.end(), block, block + blockLength);
+
+    fclose(pFile);
+
+    // the kernels may read a block behind the end
+    pLines->fileText.reserve(pLines->fileText.size() + 32);
+
+    pLines->text = pLines->fileText.data();
+    pLines->length = pLines->fileText.size();
+
+    return pLines;
+}
+
+#endif
+
+LinesHandle JSON_linesOpen(const char* path) {
+
+    assert(path != NULL);
+
+    RW_Lines* pLines = MapFile(path);
+
+    if (pLines == NULL) {
+        std::cout << "JSON for PLC: \"" << path << "\" can't be opened." << std::endl;
+        return NULL;
+    }
+
+    IndexLines(pLines);
+
+    return pLines;
+}
+
+LinesHandle JSON_linesOpenText(const char* text, size_t length) {
+
+    assert(text != NULL || length == 0);
+
+    RW_Lines* pLines = NewLines(text ? text : "", length);
+
+    IndexLines(pLines);
+
+    return pLines;
+}
+
+void JSON_linesClose(LinesHandle hLines) {
+    RW_Lines* pLines = (RW_Lines*)hLines;
+
+    if (pLines == NULL)
+        return;
+
+#ifdef JSON_LINES_MMAP
+    if (pLines->pMapping)
+        munmap(pLines->pMapping, pLines->mappingSize);
+#endif
+
+    delete pLines;
+}
+
+size_t JSON_linesCount(LinesHandle hLines) {
+
+    assert(hLines != NULL);
+
+    return ((RW_Lines*)hLines)->messages.size();
+}
+
+const char* JSON_linesGet(LinesHandle hLines, size_t idx, size_t* pLength) {
+
+    assert(hLines != NULL);
+
+    RW_Lines* pLines = (RW_Lines*)hLines;
+
+    if (idx >= pLines->messages.size())
+        return NULL;
+
+    if (pLength)
+        *pLength = pLines->lengths[idx];
+
+    return pLines->messages[idx];
+}
+
+size_t JSON_TextToBinLines(ParserHandle hDoc, LinesHandle hLines, size_t first, size_t count, unsigned char* bins,
+                           size_t stride, uint32_t* results) {
+
+    assert(hDoc != NULL && hLines != NULL);
+
+    RW_Lines* pLines = (RW_Lines*)hLines;
+
+    assert(first + count <= pLines->messages.size());
+
+    if (count == 0)
+        return 0;
+
+    return JSON_TextToBinBatch(hDoc, &pLines->messages[first], &pLines->lengths[first], bins, stride, count, results);
+}
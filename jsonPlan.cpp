@@ -0,0 +1,532 @@
+//============================================================================
+// Name        : jsonPlan.cpp
+// Description : Compiles an interpreter into a flat, immutable plan
+//============================================================================
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <climits>
+#include <unordered_map>
+
+#include "jsonPlan.h"
+
+static uint32_t AlignPlanOffset(uint32_t offset) {
+    return (offset + 7u) & ~7u;
+}
+
+// a member name as JSON string, escaped the way rapidjson's Writer does
+static void AppendJsonString(std::string& text, const std::string& value) {
+    static const char hexDigits[] = "0123456789ABCDEF";
+
+    text.push_back('"');
+
+    for (unsigned char c : value) {
+        switch (c) {
+        case '"':  text.append("\\\""); break;
+        case '\\': text.append("\\\\"); break;
+        case '\b': text.append("\\b"); break;
+        case '\f': text.append("\\f"); break;
+        case '\n': text.append("\\n"); break;
+        case '\r': text.append("\\r"); break;
+        case '\t': text.append("\\t"); break;
+        default:
+            if (c < 0x20) {
+                text.append("\\u00");
+                text.push_back(hexDigits[c >> 4]);
+                text.push_back(hexDigits[c & 0xF]);
+            } else
+                text.push_back((char)c);
+            break;
+        }
+    }
+
+    text.push_back('"');
+}
+
+// upper bound for the displacement search of a single bucket
+static const uint32_t kMaxDisplacement = 0x100000;
+
+// hash and displace: the keys are put into buckets by their hash, then the buckets (largest first)
+// search a displacement that scatters all their keys into slots still free
+static bool BuildPerfectHash(const std::vector<uint32_t>& hashes, std::vector<JsonPlanSlot>& slots, uint32_t& slotMask) {
+
+    // names with the same hash can't be separated by any displacement
+    std::vector<uint32_t> sorted(hashes);
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+        return false;
+
+    uint32_t slotCount = 1;
+    while (slotCount < hashes.size())
+        slotCount <<= 1;
+
+    slotMask = slotCount - 1;
+    slots.assign(slotCount, JsonPlanSlot{0, JSON_PLAN_NO_MEMBER});
+
+    std::vector<std::vector<uint32_t> > buckets(slotCount);
+    for (uint32_t idx = 0; idx < hashes.size(); idx++)
+        buckets[hashes[idx] & slotMask].push_back(idx);
+
+    std::vector<uint32_t> order(slotCount);
+    for (uint32_t bucket = 0; bucket < slotCount; bucket++)
+        order[bucket] = bucket;
+
+    std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    std::vector<uint32_t> bucketSlots;
+
+    for (uint32_t bucket : order) {
+        const std::vector<uint32_t>& keys = buckets[bucket];
+
+        if (keys.empty())
+            break;
+
+        uint32_t displacement = 0;
+
+        for (; displacement < kMaxDisplacement; displacement++) {
+            bucketSlots.clear();
+
+            for (uint32_t key : keys) {
+                uint32_t slot = JSON_planSlot(hashes[key], displacement) & slotMask;
+
+                if (slots[slot].member != JSON_PLAN_NO_MEMBER
+                        || std::find(bucketSlots.begin(), bucketSlots.end(), slot) != bucketSlots.end())
+                    break;
+
+                bucketSlots.push_back(slot);
+            }
+
+            if (bucketSlots.size() == keys.size())
+                break;
+        }
+
+        if (displacement == kMaxDisplacement)
+            return false;
+
+        slots[bucket].displacement = displacement;
+        for (uint32_t idx = 0; idx < keys.size(); idx++)
+            slots[bucketSlots[idx]].member = keys[idx];
+    }
+
+    return true;
+}
+
+// binary size of a scalar, 0 for strings and objects
+static uint32_t ScalarSize(uint32_t dataType) {
+    switch (dataType) {
+    case JSON_INT:
+        return sizeof(int32_t);
+    case JSON_UINT:
+        return sizeof(uint32_t);
+    case JSON_DOUBLE:
+        return sizeof(double);
+    case JSON_BOOL:
+        return sizeof(char); // in IEC the size of a CODESYS-BOOL is one byte
+    default:
+        return 0;
+    }
+}
+
+static bool IsArrayType(uint32_t dataType) {
+    return dataType >= JSON_STRINGARRAY && dataType <= JSON_OBJECTARRAY;
+}
+
+const char* JSON_planCheckMember(JsonDataType dataType, uint32_t offset, uint32_t size) {
+
+    if ((uint32_t)dataType > JSON_OBJECTARRAY)
+        return "unknown dataType";
+
+    // the size of an array member is the size of one element, a scalar element may be padded
+    uint32_t valueType = IsArrayType(dataType) ? dataType - JSON_STRINGARRAY + JSON_STRING : dataType;
+    uint32_t scalarSize = ScalarSize(valueType);
+
+    if (size < scalarSize)
+        return "insufficient binSize for dataType";
+
+    if (size > scalarSize && scalarSize != 0 && !IsArrayType(dataType))
+        return "too large binSize for dataType";
+
+    if (valueType == JSON_STRING && size == 0)
+        return "no binSize for the terminating 0 of a string";
+
+    if (dataType == JSON_OBJECTARRAY && size == 0)
+        return "no binSize for the array elements";
+
+    if (IsArrayType(dataType) && offset < sizeof(int32_t))
+        return "no room for the element count in front of the array";
+
+    if ((uint64_t)offset + size > UINT32_MAX)
+        return "offset and binSize beyond 4 GB";
+
+    return NULL;
+}
+
+// the bytes of an object's struct a member takes: an array's capacity is unknown up front, its first
+// element stands for all of them, the element count in front of it is a span of its own
+struct PlanSpan {
+    uint32_t			begin;
+    uint32_t			end;
+    const std::string*	pName;
+    bool				isCount;
+};
+
+static std::string MemberPath(const std::string& objectName, const std::string& memberName) {
+    return "\"" + (objectName.empty() ? memberName : objectName + "." + memberName) + "\"";
+}
+
+bool JSON_planCheck(const JsonInterpreter& interpreter, std::string& fault) {
+
+    // bytes the members of an object take from the start of its struct
+    std::unordered_map<std::string, uint32_t> objectExtents;
+    std::vector<PlanSpan> spans;
+
+    for (auto& object : interpreter) {
+        spans.clear();
+
+        for (auto& member : object.second) {
+            const JsonBinaryStructMapInfo& info = member.second;
+            const char* memberFault = JSON_planCheckMember(info.jsonDataType, info.offsetInBinaryStruct, info.sizeInBinaryStruct);
+
+            if (memberFault) {
+                fault = MemberPath(object.first, member.first) + ": " + memberFault;
+                return false;
+            }
+
+            if (info.sizeInBinaryStruct > 0)
+                spans.push_back({info.offsetInBinaryStruct, info.offsetInBinaryStruct + info.sizeInBinaryStruct, &member.first, false});
+
+            if (IsArrayType(info.jsonDataType))
+                spans.push_back({info.offsetInBinaryStruct - (uint32_t)sizeof(int32_t), info.offsetInBinaryStruct, &member.first, true});
+        }
+
+        std::sort(spans.begin(), spans.end(), [](const PlanSpan& a, const PlanSpan& b) {
+            return a.begin < b.begin;
+        });
+
+        uint32_t extent = 0;
+
+        for (size_t idx = 0; idx < spans.size(); idx++) {
+            if (idx > 0 && spans[idx].begin < spans[idx - 1].end) {
+                const PlanSpan& first = spans[idx - 1];
+                const PlanSpan& second = spans[idx];
+
+                fault = MemberPath(object.first, *second.pName) + (second.isCount ? " (its element count)" : "")
+                        + " overlaps " + MemberPath(object.first, *first.pName) + (first.isCount ? " (its element count)" : "");
+                return false;
+            }
+
+            extent = std::max(extent, spans[idx].end);
+        }
+
+        objectExtents[object.first] = extent;
+    }
+
+    // objects are described by the interpreter entry of the same name, wherever they show up
+    for (auto& object : interpreter) {
+        for (auto& member : object.second) {
+            const JsonBinaryStructMapInfo& info = member.second;
+
+            if (info.jsonDataType != JSON_OBJECT && info.jsonDataType != JSON_OBJECTARRAY)
+                continue;
+
+            auto child = objectExtents.find(member.first);
+
+            if (child != objectExtents.end() && child->second > info.sizeInBinaryStruct) {
+                fault = MemberPath(object.first, member.first) + ": its members take " + std::to_string(child->second)
+                        + " bytes, binSize is " + std::to_string(info.sizeInBinaryStruct);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+JsonPlan* JSON_planBuild(const JsonInterpreter& interpreter) {
+
+    // 1. number the objects, the root object ("") is numbered like any other
+    std::vector<const std::pair<const std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >*> objects;
+    std::unordered_map<std::string, uint32_t> objectIndex;
+
+    for (auto& object : interpreter) {
+        objectIndex[object.first] = (uint32_t)objects.size();
+        objects.push_back(&object);
+    }
+
+    if (objectIndex.find("") == objectIndex.end()) {
+        // nothing to interpret without a root object
+        return NULL;
+    }
+
+    // 2. lay the members out object by object, sorted by their offset in the binary struct:
+    //    producers usually emit the members in struct order, too
+    std::vector<JsonPlanObject> planObjects;
+    std::vector<JsonPlanMember> planMembers;
+    std::vector<JsonPlanSlot> planSlots;
+    std::string names;
+    std::string templates;
+
+    for (auto pObject : objects) {
+        std::vector<const std::pair<const std::string, JsonBinaryStructMapInfo>*> members;
+
+        for (auto& member : pObject->second)
+            members.push_back(&member);
+
+        std::sort(members.begin(), members.end(), [](auto a, auto b) {
+            return a->second.offsetInBinaryStruct < b->second.offsetInBinaryStruct;
+        });
+
+        JsonPlanObject planObject = {(uint32_t)planMembers.size(), (uint32_t)members.size(), JSON_PLAN_NO_SLOT, 0};
+        std::vector<uint32_t> hashes;
+
+        for (auto pMember : members) {
+            JsonPlanMember planMember;
+
+            planMember.nameOffset = (uint32_t)names.size();
+            planMember.nameLength = (uint32_t)pMember->first.size();
+            planMember.nameHash = JSON_hashKey(pMember->first.c_str(), pMember->first.size());
+            planMember.jsonDataType = pMember->second.jsonDataType;
+            planMember.offsetInBinaryStruct = pMember->second.offsetInBinaryStruct;
+            planMember.sizeInBinaryStruct = pMember->second.sizeInBinaryStruct;
+            planMember.childObject = JSON_PLAN_NO_OBJECT;
+
+            // the first member opens the object, the others follow a comma
+            planMember.prefixOffset = (uint32_t)templates.size();
+            templates.push_back(planMembers.size() == planObject.firstMember ? '{' : ',');
+            AppendJsonString(templates, pMember->first);
+            templates.push_back(':');
+            planMember.prefixLength = (uint32_t)templates.size() - planMember.prefixOffset;
+
+            if (pMember->second.jsonDataType == JSON_OBJECT || pMember->second.jsonDataType == JSON_OBJECTARRAY) {
+                // objects are described by the interpreter entry of the same name
+                auto child = objectIndex.find(pMember->first);
+                if (child != objectIndex.end())
+                    planMember.childObject = child->second;
+            }
+
+            names.append(pMember->first);
+            names.push_back('\0');
+
+            planMembers.push_back(planMember);
+            hashes.push_back(planMember.nameHash);
+        }
+
+        // 3. resolve the names of the object by a perfect hash, objects that defy it are scanned linearly
+        std::vector<JsonPlanSlot> slots;
+
+        if (!hashes.empty() && BuildPerfectHash(hashes, slots, planObject.slotMask)) {
+            planObject.firstSlot = (uint32_t)planSlots.size();
+            planSlots.insert(planSlots.end(), slots.begin(), slots.end());
+        }
+
+        planObjects.push_back(planObject);
+    }
+
+    // 4. copy everything into one contiguous block
+    uint32_t objectTable = AlignPlanOffset(sizeof(JsonPlan));
+    uint32_t memberTable = AlignPlanOffset(objectTable + planObjects.size() * sizeof(JsonPlanObject));
+    uint32_t slotTable = AlignPlanOffset(memberTable + planMembers.size() * sizeof(JsonPlanMember));
+    uint32_t nameTable = AlignPlanOffset(slotTable + planSlots.size() * sizeof(JsonPlanSlot));
+    uint32_t templateTable = AlignPlanOffset(nameTable + names.size());
+    uint32_t byteSize = AlignPlanOffset(templateTable + templates.size());
+
+    unsigned char* pStorage = new unsigned char[byteSize];
+    memset(pStorage, 0, byteSize);
+
+    JsonPlan* pPlan = (JsonPlan*)pStorage;
+
+    pPlan->byteSize = byteSize;
+    pPlan->objectCount = (uint32_t)planObjects.size();
+    pPlan->objectTable = objectTable;
+    pPlan->memberCount = (uint32_t)planMembers.size();
+    pPlan->memberTable = memberTable;
+    pPlan->slotCount = (uint32_t)planSlots.size();
+    pPlan->slotTable = slotTable;
+    pPlan->nameTable = nameTable;
+    pPlan->nameTableSize = (uint32_t)names.size();
+    pPlan->templateTable = templateTable;
+    pPlan->templateSize = (uint32_t)templates.size();
+    pPlan->rootObject = objectIndex[""];
+
+    if (!planObjects.empty())
+        memcpy(pStorage + objectTable, planObjects.data(), planObjects.size() * sizeof(JsonPlanObject));
+    if (!planMembers.empty())
+        memcpy(pStorage + memberTable, planMembers.data(), planMembers.size() * sizeof(JsonPlanMember));
+    if (!planSlots.empty())
+        memcpy(pStorage + slotTable, planSlots.data(), planSlots.size() * sizeof(JsonPlanSlot));
+    if (!names.empty())
+        memcpy(pStorage + nameTable, names.data(), names.size());
+    if (!templates.empty())
+        memcpy(pStorage + templateTable, templates.data(), templates.size());
+
+    return pPlan;
+}
+
+void JSON_planDelete(JsonPlan* pPlan) {
+    delete[] (unsigned char*)pPlan;
+}
+
+// in front of the plan in an image
+struct JsonPlanImageHeader {
+    uint32_t		magic;			// kPlanImageMagic, in the byte order of the machine that wrote it
+    uint32_t		version;		// of the plan records
+    uint32_t		headerSize;
+    uint32_t		planSize;
+    uint64_t		layoutKey;
+    uint64_t		checksum;		// of layoutKey and the plan
+};
+
+static const uint32_t kPlanImageMagic = 0x4A504C4Eu;	// "JPLN"
+static const uint32_t kPlanImageVersion = 1;
+
+// FNV-1a, the image is read once at startup
+static uint64_t PlanImageChecksum(uint64_t layoutKey, const unsigned char* pPlan, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        hash ^= (layoutKey >> shift) & 0xFF;
+        hash *= 1099511628211ull;
+    }
+
+    for (size_t idx = 0; idx < size; idx++) {
+        hash ^= pPlan[idx];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+size_t JSON_planSaveImage(const JsonPlan& plan, uint64_t layoutKey, void* image, size_t imageCapacity) {
+    size_t imageSize = sizeof(JsonPlanImageHeader) + plan.byteSize;
+
+    if (image == NULL || imageCapacity < imageSize)
+        return imageSize;
+
+    JsonPlanImageHeader header;
+
+    header.magic = kPlanImageMagic;
+    header.version = kPlanImageVersion;
+    header.headerSize = sizeof(JsonPlanImageHeader);
+    header.planSize = plan.byteSize;
+    header.layoutKey = layoutKey;
+    header.checksum = PlanImageChecksum(layoutKey, (const unsigned char*)&plan, plan.byteSize);
+
+    memcpy(image, &header, sizeof(header));
+    memcpy((unsigned char*)image + sizeof(header), &plan, plan.byteSize);
+
+    return imageSize;
+}
+
+// does a table of count records of recordSize lie within the plan?
+static bool PlanTableFits(const JsonPlan& plan, uint32_t offset, uint32_t count, size_t recordSize) {
+    return offset % 8 == 0 && offset >= sizeof(JsonPlan) && offset <= plan.byteSize
+           && (uint64_t)count * recordSize <= plan.byteSize - offset;
+}
+
+// the records refer to each other within the plan: an image that was checksummed correctly but built
+// by a faulty writer must not send the decoder out of it
+static const char* CheckPlanRecords(const JsonPlan& plan) {
+    if (!PlanTableFits(plan, plan.objectTable, plan.objectCount, sizeof(JsonPlanObject))
+            || !PlanTableFits(plan, plan.memberTable, plan.memberCount, sizeof(JsonPlanMember))
+            || !PlanTableFits(plan, plan.slotTable, plan.slotCount, sizeof(JsonPlanSlot))
+            || !PlanTableFits(plan, plan.nameTable, plan.nameTableSize, 1)
+            || !PlanTableFits(plan, plan.templateTable, plan.templateSize, 1))
+        return "a table beyond the plan";
+
+    if (plan.rootObject >= plan.objectCount)
+        return "no root object";
+
+    for (uint32_t objectIdx = 0; objectIdx < plan.objectCount; objectIdx++) {
+        const JsonPlanObject& object = plan.object(objectIdx);
+
+        if (object.firstMember > plan.memberCount || object.memberCount > plan.memberCount - object.firstMember)
+            return "members beyond the member table";
+
+        if (object.firstSlot == JSON_PLAN_NO_SLOT)
+            continue;
+
+        if ((object.slotMask & (object.slotMask + 1)) != 0 || object.firstSlot > plan.slotCount
+                || object.slotMask >= plan.slotCount - object.firstSlot)
+            return "slots beyond the slot table";
+
+        const JsonPlanSlot* pSlots = (const JsonPlanSlot*)((const char*)&plan + plan.slotTable) + object.firstSlot;
+
+        for (uint32_t slotIdx = 0; slotIdx <= object.slotMask; slotIdx++)
+            if (pSlots[slotIdx].member != JSON_PLAN_NO_MEMBER && pSlots[slotIdx].member >= object.memberCount)
+                return "a slot beyond the members of its object";
+    }
+
+    for (uint32_t memberIdx = 0; memberIdx < plan.memberCount; memberIdx++) {
+        const JsonPlanMember& member = plan.member(memberIdx);
+
+        if (member.nameOffset >= plan.nameTableSize || member.nameLength >= plan.nameTableSize - member.nameOffset
+                || plan.name(member)[member.nameLength] != 0)
+            return "a name beyond the name table";
+
+        if (member.prefixOffset > plan.templateSize || member.prefixLength > plan.templateSize - member.prefixOffset)
+            return "a prefix beyond the template table";
+
+        if (JSON_planCheckMember((JsonDataType)member.jsonDataType, member.offsetInBinaryStruct, member.sizeInBinaryStruct))
+            return "a faulty member";
+
+        bool hasChild = member.jsonDataType == JSON_OBJECT || member.jsonDataType == JSON_OBJECTARRAY;
+
+        if (member.childObject != JSON_PLAN_NO_OBJECT && (!hasChild || member.childObject >= plan.objectCount))
+            return "a child object beyond the object table";
+    }
+
+    return NULL;
+}
+
+const JsonPlan* JSON_planFromImage(const void* image, size_t size, uint64_t layoutKey, std::string& fault) {
+    JsonPlanImageHeader header;
+
+    if (image == NULL || size < sizeof(header)) {
+        fault = "too short";
+        return NULL;
+    }
+
+    if ((uintptr_t)image % 8 != 0) {
+        fault = "not 8 byte aligned";
+        return NULL;
+    }
+
+    memcpy(&header, image, sizeof(header));
+
+    if (header.magic != kPlanImageMagic) {
+        fault = "no interpreter image (or one of another byte order)";
+        return NULL;
+    }
+
+    if (header.version != kPlanImageVersion) {
+        fault = "version " + std::to_string(header.version) + ", expected " + std::to_string(kPlanImageVersion);
+        return NULL;
+    }
+
+    if (header.layoutKey != layoutKey) {
+        fault = "saved for another binary struct layout";
+        return NULL;
+    }
+
+    const unsigned char* pPlanBytes = (const unsigned char*)image + sizeof(header);
+
+    if (header.headerSize != sizeof(header) || header.planSize < sizeof(JsonPlan) || header.planSize != size - sizeof(header)
+            || header.checksum != PlanImageChecksum(layoutKey, pPlanBytes, header.planSize)) {
+        fault = "damaged (checksum)";
+        return NULL;
+    }
+
+    const JsonPlan* pPlan = (const JsonPlan*)pPlanBytes;
+    const char* recordFault = pPlan->byteSize == header.planSize ? CheckPlanRecords(*pPlan) : "plan size";
+
+    if (recordFault) {
+        fault = std::string("faulty, ") + recordFault;
+        return NULL;
+    }
+
+    return pPlan;
+}
@@ -0,0 +1,167 @@
+/*
+ * jsonPlan.h
+ *
+ * Compiled, immutable form of an interpreter (see JSON_parserCompile).
+ *
+ * The whole plan lives in one contiguous block of memory: a header followed by
+ * a table of objects, a table of members and a pool of member names.
+ * Records refer to each other by index/offset only, never by pointer, so
+ * a plan can be copied or shared without fixups, or saved as an image and
+ * mapped back in at the next start (JSON_planSaveImage).
+ *
+ * For the way back (JSON_BinToText) every member carries its constant JSON
+ * prefix, e.g. {"schemaVersion": for the first and ,"dhcp": for any further
+ * member, rendered once into a template pool.
+ *
+ * Every object carries a minimal perfect hash of its member names
+ * (hash and displace): a key is resolved with one hash, two table reads
+ * and a single compare, no matter how many members the object has.
+ */
+
+#ifndef JSONPLAN_H_
+#define JSONPLAN_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include "jsonWrapper.h"
+#include "jsonKey.h"
+
+// second level of the perfect hash: scatter a key hash with the displacement of its bucket
+// (murmur3 finalizer, so that every bit of the slot depends on every bit of hash and displacement)
+constexpr uint32_t JSON_planSlot(uint32_t hash, uint32_t displacement) {
+    uint32_t slot = hash ^ (displacement * 0x9E3779B1u);
+
+    slot ^= slot >> 16;
+    slot *= 0x85EBCA6Bu;
+    slot ^= slot >> 13;
+    slot *= 0xC2B2AE35u;
+    slot ^= slot >> 16;
+
+    return slot;
+}
+
+constexpr uint32_t JSON_PLAN_NO_OBJECT = 0xFFFFFFFFu;
+constexpr uint32_t JSON_PLAN_NO_MEMBER = 0xFFFFFFFFu;
+constexpr uint32_t JSON_PLAN_NO_SLOT = 0xFFFFFFFFu;
+
+struct JsonPlanMember {
+    uint32_t		nameOffset;		// into the name pool, names are 0-terminated
+    uint32_t		nameLength;
+    uint32_t		nameHash;
+    uint32_t		jsonDataType;	// JsonDataType
+    uint32_t		offsetInBinaryStruct;
+    uint32_t		sizeInBinaryStruct;
+    uint32_t		childObject;	// object index for JSON_OBJECT/JSON_OBJECTARRAY, else JSON_PLAN_NO_OBJECT
+    uint32_t		prefixOffset;	// into the template pool, the JSON text in front of the value
+    uint32_t		prefixLength;
+};
+
+struct JsonPlanObject {
+    uint32_t		firstMember;
+    uint32_t		memberCount;
+    uint32_t		firstSlot;		// into the slot table, JSON_PLAN_NO_SLOT if the names can't be hashed perfectly
+    uint32_t		slotMask;		// slot count - 1, the slot count is a power of 2
+};
+
+struct JsonPlanSlot {
+    uint32_t		displacement;	// for the keys whose hash selects this slot as bucket
+    uint32_t		member;			// member index within the object, JSON_PLAN_NO_MEMBER if the slot is free
+};
+
+struct JsonPlan {
+    uint32_t		byteSize;		// size of the whole block including this header
+    uint32_t		objectCount;
+    uint32_t		objectTable;	// byte offsets from the start of the plan
+    uint32_t		memberCount;
+    uint32_t		memberTable;
+    uint32_t		slotCount;
+    uint32_t		slotTable;
+    uint32_t		nameTable;
+    uint32_t		nameTableSize;
+    uint32_t		templateTable;
+    uint32_t		templateSize;
+    uint32_t		rootObject;
+
+    const JsonPlanObject& object(uint32_t idx) const {
+        return ((const JsonPlanObject*)((const char*)this + objectTable))[idx];
+    }
+
+    const JsonPlanMember& member(uint32_t idx) const {
+        return ((const JsonPlanMember*)((const char*)this + memberTable))[idx];
+    }
+
+    const char* name(const JsonPlanMember& member) const {
+        return (const char*)this + nameTable + member.nameOffset;
+    }
+
+    const char* prefix(const JsonPlanMember& member) const {
+        return (const char*)this + templateTable + member.prefixOffset;
+    }
+
+    // index of a key within the members of an object, JSON_PLAN_NO_MEMBER if the object doesn't describe it
+    uint32_t findMember(uint32_t objectIdx, const char* key, uint32_t length) const {
+        return findMember(objectIdx, key, length, JSON_hashKey(key, length));
+    }
+
+    // with the hash precomputed
+    uint32_t findMember(uint32_t objectIdx, const JsonKey& key) const {
+        return findMember(objectIdx, key.name, key.length, key.hash);
+    }
+
+    uint32_t findMember(uint32_t objectIdx, const char* key, uint32_t length, uint32_t hash) const {
+        const JsonPlanObject& planObject = object(objectIdx);
+
+        if (planObject.firstSlot != JSON_PLAN_NO_SLOT) {
+            const JsonPlanSlot* pSlots = (const JsonPlanSlot*)((const char*)this + slotTable) + planObject.firstSlot;
+            uint32_t idx = pSlots[JSON_planSlot(hash, pSlots[hash & planObject.slotMask].displacement) & planObject.slotMask].member;
+
+            if (idx != JSON_PLAN_NO_MEMBER) {
+                const JsonPlanMember& planMember = member(planObject.firstMember + idx);
+
+                if (planMember.nameHash == hash && planMember.nameLength == length && memcmp(name(planMember), key, length) == 0)
+                    return idx;
+            }
+
+            return JSON_PLAN_NO_MEMBER;
+        }
+
+        for (uint32_t idx = 0; idx < planObject.memberCount; idx++) {
+            const JsonPlanMember& planMember = member(planObject.firstMember + idx);
+
+            if (planMember.nameLength == length && memcmp(name(planMember), key, length) == 0)
+                return idx;
+        }
+
+        return JSON_PLAN_NO_MEMBER;
+    }
+};
+
+typedef std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> > JsonInterpreter;
+
+// The layout of the binary struct depends on the interpreter only, so it's checked
+// when the interpreter is set up instead of with every message:
+// the fault of a single member (type, size and offset), NULL if there's none
+const char* JSON_planCheckMember(JsonDataType dataType, uint32_t offset, uint32_t size);
+
+// the whole interpreter: every member, no member overlapping another one or the element
+// count in front of an array, the members of an object within the size its parents give it
+// (false with the first fault in fault)
+bool JSON_planCheck(const JsonInterpreter& interpreter, std::string& fault);
+
+// build a plan from an interpreter, the result has to be released with JSON_planDelete
+JsonPlan* JSON_planBuild(const JsonInterpreter& interpreter);
+
+void JSON_planDelete(JsonPlan* pPlan);
+
+// A plan as a binary image (see JSON_interpreterSaveImage): a header with the version of the records, layoutKey and a
+// checksum, followed by the plan as it is. Writes the image to image if imageCapacity holds it, returns its size.
+size_t JSON_planSaveImage(const JsonPlan& plan, uint64_t layoutKey, void* image, size_t imageCapacity);
+
+// the plan within an image, used in place (the image has to be 8 byte aligned and stay as it is), NULL with the
+// reason in fault if it isn't an image of this version, was saved with another layoutKey or was changed since
+const JsonPlan* JSON_planFromImage(const void* image, size_t size, uint64_t layoutKey, std::string& fault);
+
+#endif /* JSONPLAN_H_ */
@@ -0,0 +1,475 @@
+/*
+ * jsonSaxDecoder.h
+ *
+ * rapidjson SAX handler that follows a compiled plan (see jsonPlan.h) and
+ * writes every scalar straight to its place in the binary struct while the
+ * text is tokenized. No DOM is built, members not described by the plan are
+ * skipped without being stored.
+ *
+ * Return codes are the ones of JSON_TextToBin:
+ *   1 member not found, 2 wrong type, 3 string truncated
+ * (the sizes of the members were checked with the interpreter, see JSON_planCheck)
+ * Faults are reported to a JsonErrorSink with the path taken from the open frames.
+ */
+
+#ifndef JSONSAXDECODER_H_
+#define JSONSAXDECODER_H_
+
+#include <vector>
+#include <cstring>
+#include <climits>
+
+#include "rapidjson/rapidjson.h"
+
+#include "jsonPlan.h"
+#include "jsonError.h"
+
+class JsonSaxDecoder {
+  public:
+    typedef char Ch;
+    typedef RAPIDJSON_NAMESPACE::SizeType SizeType;
+
+    JsonSaxDecoder() : pPlan(NULL), binBuffer(NULL), pSink(NULL), ppTextPos(NULL), skipDepth(0), seenTop(0), returnCode(0) {
+    }
+
+    // prepare for the next message, keeps the capacity of the internal stacks
+    // (textPos is where the reader is in the text of the sink, only read for the offset of a fault)
+    void Reset(const JsonPlan* plan, unsigned char* bin, JsonErrorSink* sink, const char* const* textPos) {
+        pPlan = plan;
+        binBuffer = bin;
+        pSink = sink;
+        ppTextPos = textPos;
+        frames.clear();
+        skipDepth = 0;
+        seenTop = 0;
+        returnCode = 0;
+    }
+
+    // 0 or 3 (string truncated) if the whole text was decoded, the error code if the handler stopped the reader
+    uint32_t GetReturnCode() const {
+        return returnCode;
+    }
+
+    // JsonIncrementalDecoder forgets a 3 once it knows which member it belongs to
+    void ClearReturnCode() {
+        returnCode = 0;
+    }
+
+    // JsonIncrementalDecoder hands the values over one by one: the next value (or StartObject)
+    // belongs to member memberIdx of the innermost open object, false if the member was found
+    // before (the first occurrence counts, the value is to be skipped)
+    bool SetMember(uint32_t memberIdx) {
+        Frame& frame = frames.back();
+
+        if (IsSeen(frame, memberIdx))
+            return false;
+
+        frame.pendingMember = memberIdx;
+        return true;
+    }
+
+    // the member set by SetMember keeps what the binary struct holds, it counts as found
+    void KeepMember() {
+        Target target;
+
+        NextTarget(target);
+    }
+
+    bool Null() {
+        Target target;
+
+        if (frames.empty())
+            return RootNotObject();
+
+        if (skipDepth > 0 || !NextTarget(target))
+            return true;
+
+        return WrongType(target);
+    }
+
+    bool Bool(bool b) {
+        Target target;
+
+        if (frames.empty())
+            return RootNotObject();
+
+        if (skipDepth > 0 || !NextTarget(target))
+            return true;
+
+        if (target.dataType != JSON_BOOL)
+            return WrongType(target);
+
+        // in IEC the size of a CODESYS-BOOL is one byte
+        *(char*)target.pDest = b ? 1 : 0;
+
+        return true;
+    }
+
+    bool Int(int i) {
+        return Integer(true, i, i >= 0);
+    }
+
+    bool Uint(unsigned u) {
+        return Integer(u <= (unsigned)INT_MAX, (int32_t)u, true);
+    }
+
+    bool Int64(int64_t i64) {
+        return Integer(i64 >= INT_MIN && i64 <= INT_MAX, (int32_t)i64, i64 >= 0 && i64 <= (int64_t)UINT_MAX);
+    }
+
+    bool Uint64(uint64_t u64) {
+        return Integer(u64 <= (uint64_t)INT_MAX, (int32_t)u64, u64 <= (uint64_t)UINT_MAX);
+    }
+
+    bool Double(double d) {
+        Target target;
+
+        if (frames.empty())
+            return RootNotObject();
+
+        if (skipDepth > 0 || !NextTarget(target))
+            return true;
+
+        if (target.dataType != JSON_DOUBLE)
+            return WrongType(target);
+
+        *(double*)target.pDest = d;
+
+        return true;
+    }
+
+    bool RawNumber(const Ch*, SizeType, bool) {
+        // only with kParseNumbersAsStringsFlag, which is never used here
+        return false;
+    }
+
+    bool String(const Ch* str, SizeType length, bool) {
+        Target target;
+
+        if (frames.empty())
+            return RootNotObject();
+
+        if (skipDepth > 0 || !NextTarget(target))
+            return true;
+
+        if (target.dataType != JSON_STRING)
+            return WrongType(target);
+
+        if (length > target.size-1) {
+            Report(3, JSON_ERROR_STRING_TRUNCATED, JSON_STRING, &target);
+            returnCode = 3; // string truncated, go on with the next member
+
+            // truncate stringLength
+            length = target.size-1;
+        }
+
+        memcpy(target.pDest, str, length);
+        //set terminating 0
+        target.pDest[length] = 0;
+
+        return true;
+    }
+
+    bool StartObject() {
+        if (skipDepth > 0) {
+            skipDepth++;
+            return true;
+        }
+
+        if (frames.empty()) {
+            // the root object is described by the plan's root
+            PushObject(pPlan->rootObject, binBuffer, NULL, -1);
+            return true;
+        }
+
+        Target target;
+
+        if (!NextTarget(target)) {
+            skipDepth = 1;
+            return true;
+        }
+
+        if (target.dataType != JSON_OBJECT)
+            return WrongType(target);
+
+        PushObject(target.pMember->childObject, target.pDest, target.pMember, target.arrayIdx);
+
+        return true;
+    }
+
+    bool Key(const Ch* str, SizeType length, bool) {
+        if (skipDepth > 0)
+            return true;
+
+        Frame& frame = frames.back();
+
+        frame.pendingMember = FindMember(frame.objectIdx, str, length);
+
+        // the first occurrence of a key counts, as with the DOM, a later one is skipped
+        if (frame.pendingMember != kUnknownMember && IsSeen(frame, frame.pendingMember))
+            frame.pendingMember = kUnknownMember;
+
+        return true;
+    }
+
+    bool EndObject(SizeType) {
+        if (skipDepth > 0) {
+            skipDepth--;
+            return true;
+        }
+
+        Frame& frame = frames.back();
+
+        if (frame.objectIdx != JSON_PLAN_NO_OBJECT) {
+            const JsonPlanObject& object = pPlan->object(frame.objectIdx);
+
+            // every member of the plan has to show up
+            for (uint32_t idx = 0; idx < object.memberCount; idx++) {
+                if (!(seen[frame.seenBase + idx / 64] & (1ull << (idx % 64)))) {
+                    const JsonPlanMember& member = pPlan->member(object.firstMember + idx);
+
+                    Report(1, JSON_ERROR_NOT_FOUND, member.jsonDataType, pPlan->name(member), -1);
+                    returnCode = 1;
+                    return false;
+                }
+            }
+
+            seenTop = frame.seenBase;
+        }
+
+        frames.pop_back();
+
+        return true;
+    }
+
+    bool StartArray() {
+        if (skipDepth > 0) {
+            skipDepth++;
+            return true;
+        }
+
+        if (frames.empty())
+            return RootNotObject();
+
+        Target target;
+
+        if (!NextTarget(target)) {
+            skipDepth = 1;
+            return true;
+        }
+
+        if (target.dataType < JSON_STRINGARRAY || target.dataType > JSON_OBJECTARRAY)
+            return WrongType(target);
+
+        Frame frame;
+
+        frame.isArray = true;
+        frame.objectIdx = JSON_PLAN_NO_OBJECT;
+        frame.pMember = target.pMember;
+        frame.pBase = target.pDest;
+        frame.arrayIdx = -1;
+        frame.elementCount = 0;
+        // the used array size goes to a required 'int' just before the array, it holds the maximum on entry
+        frame.maxElements = *(int32_t*)(target.pDest - sizeof(int32_t));
+
+        frames.push_back(frame);
+
+        return true;
+    }
+
+    bool EndArray(SizeType elementCount) {
+        if (skipDepth > 0) {
+            skipDepth--;
+            return true;
+        }
+
+        Frame& frame = frames.back();
+
+        SizeType jsonArraySize = elementCount;
+
+        // limit the arraysize to the maximum
+        if (frame.maxElements < jsonArraySize) {
+            Report(0, JSON_ERROR_ARRAY_CLIPPED, frame.pMember->jsonDataType, NULL, -1, frame.maxElements, jsonArraySize);
+            jsonArraySize = frame.maxElements;
+        }
+
+        *(int32_t*)(frame.pBase - sizeof(int32_t)) = jsonArraySize;
+
+        frames.pop_back();
+
+        return true;
+    }
+
+  private:
+    static constexpr uint32_t kUnknownMember = JSON_PLAN_NO_MEMBER;
+
+    struct Frame {
+        bool					isArray;
+        uint32_t				objectIdx;		// objects: plan object, JSON_PLAN_NO_OBJECT if not described
+        uint32_t				pendingMember;	// objects: member index of the last key
+        uint32_t				seenBase;		// objects: first word in seen
+        const JsonPlanMember*	pMember;		// the member this is the value of, NULL for the root
+        unsigned char*			pBase;
+        int32_t					arrayIdx;		// objects: index in the enclosing array, -1 for object members
+        SizeType				elementCount;	// arrays: elements so far
+        SizeType				maxElements;	// arrays: capacity of the binary array
+    };
+
+    struct Target {
+        const JsonPlanMember*	pMember;
+        uint32_t				dataType;
+        uint32_t				size;
+        unsigned char*			pDest;
+        int						arrayIdx;		// -1 for object members
+    };
+
+    void PushObject(uint32_t objectIdx, unsigned char* pBase, const JsonPlanMember* pMember, int32_t arrayIdx) {
+        Frame frame;
+
+        frame.isArray = false;
+        frame.objectIdx = objectIdx;
+        frame.pendingMember = kUnknownMember;
+        frame.seenBase = seenTop;
+        frame.pMember = pMember;
+        frame.pBase = pBase;
+        frame.arrayIdx = arrayIdx;
+        frame.elementCount = 0;
+        frame.maxElements = 0;
+
+        if (objectIdx != JSON_PLAN_NO_OBJECT) {
+            uint32_t words = (pPlan->object(objectIdx).memberCount + 63) / 64;
+
+            if (seen.size() < seenTop + words)
+                seen.resize(seenTop + words);
+
+            memset(&seen[seenTop], 0, words * sizeof(uint64_t));
+            seenTop += words;
+        }
+
+        frames.push_back(frame);
+    }
+
+    bool IsSeen(const Frame& frame, uint32_t idx) const {
+        return (seen[frame.seenBase + idx / 64] >> (idx % 64)) & 1;
+    }
+
+    uint32_t FindMember(uint32_t objectIdx, const Ch* str, SizeType length) const {
+        if (objectIdx == JSON_PLAN_NO_OBJECT)
+            return kUnknownMember;
+
+        return pPlan->findMember(objectIdx, str, length);
+    }
+
+    // where does the next value go? false if it is not described and has to be skipped
+    bool NextTarget(Target& target) {
+        Frame& frame = frames.back();
+
+        if (frame.isArray) {
+            SizeType arrayIdx = frame.elementCount++;
+
+            // elements beyond the binary array are dropped
+            if (arrayIdx >= frame.maxElements)
+                return false;
+
+            target.pMember = frame.pMember;
+            // the element type is the scalar type of the same order in JsonDataType
+            target.dataType = frame.pMember->jsonDataType - JSON_STRINGARRAY + JSON_STRING;
+            target.size = frame.pMember->sizeInBinaryStruct;
+            target.pDest = frame.pBase + arrayIdx * frame.pMember->sizeInBinaryStruct;
+            target.arrayIdx = (int)arrayIdx;
+
+            return true;
+        }
+
+        if (frame.pendingMember == kUnknownMember)
+            return false;
+
+        uint32_t idx = frame.pendingMember;
+        frame.pendingMember = kUnknownMember;
+
+        seen[frame.seenBase + idx / 64] |= 1ull << (idx % 64);
+
+        const JsonPlanMember& member = pPlan->member(pPlan->object(frame.objectIdx).firstMember + idx);
+
+        target.pMember = &member;
+        target.dataType = member.jsonDataType;
+        target.size = member.sizeInBinaryStruct;
+        target.pDest = frame.pBase + member.offsetInBinaryStruct;
+        target.arrayIdx = -1;
+
+        return true;
+    }
+
+    bool Integer(bool isInt, int32_t intValue, bool isUint) {
+        Target target;
+
+        if (frames.empty())
+            return RootNotObject();
+
+        if (skipDepth > 0 || !NextTarget(target))
+            return true;
+
+        if (target.dataType == JSON_INT && isInt) {
+            *(int32_t*)target.pDest = intValue;
+            return true;
+        }
+
+        if (target.dataType == JSON_UINT && isUint) {
+            *(uint32_t*)target.pDest = (uint32_t)intValue;
+            return true;
+        }
+
+        // integers are neither doubles nor anything else
+        return WrongType(target);
+    }
+
+    // the root has to be an object
+    bool RootNotObject() {
+        Report(2, JSON_ERROR_WRONG_TYPE, JSON_OBJECT, NULL, -1);
+        returnCode = 2;
+
+        return false;
+    }
+
+    bool WrongType(const Target& target) {
+        Report(2, JSON_ERROR_WRONG_TYPE, target.dataType, &target);
+        returnCode = 2; // wrong type
+
+        return false;
+    }
+
+    void Report(uint32_t code, JsonErrorReason reason, int32_t expectedType, const Target* pTarget) {
+        // an array element is named by the array's frame already
+        if (pTarget->arrayIdx >= 0)
+            Report(code, reason, expectedType, NULL, pTarget->arrayIdx);
+        else
+            Report(code, reason, expectedType, pPlan->name(*pTarget->pMember), -1);
+    }
+
+    // the path is only collected from the frames if there's something to report
+    void Report(uint32_t code, JsonErrorReason reason, int32_t expectedType, const char* name, int32_t index,
+                uint32_t binaryArraySize = 0, uint32_t jsonArraySize = 0) {
+        pSink->ClearPath();
+
+        for (size_t idx = 1; idx < frames.size(); idx++) {
+            if (frames[idx].arrayIdx >= 0)
+                pSink->PushIndex(frames[idx].arrayIdx);
+            else
+                pSink->Push(pPlan->name(*frames[idx].pMember));
+        }
+
+        pSink->Report(code, reason, expectedType, name, index, pSink->Offset(*ppTextPos), binaryArraySize, jsonArraySize);
+    }
+
+    const JsonPlan*			pPlan;
+    unsigned char*			binBuffer;
+    JsonErrorSink*			pSink;
+    const char* const*		ppTextPos;
+    std::vector<Frame>		frames;
+    std::vector<uint64_t>	seen;			// one bit per plan member of every open object
+    uint32_t				skipDepth;		// nesting depth inside a value that is not described
+    uint32_t				seenTop;
+    uint32_t				returnCode;
+};
+
+#endif /* JSONSAXDECODER_H_ */
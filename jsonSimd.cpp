@@ -0,0 +1,294 @@
+//============================================================================
+// Name        : jsonSimd.cpp
+// Description : Scanning kernels per instruction set and the dispatch to the
+//               best one the CPU has
+//============================================================================
+
+#include <stdint.h>
+#include <algorithm>
+
+#include "jsonSimd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JSON_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+static const char* SkipWhitespaceScalar(const char* p) {
+    while (JSON_simdIsWhitespace(*p))
+        p++;
+
+    return p;
+}
+
+static size_t ScanStringScalar(const char* p) {
+    const char* pStart = p;
+
+    while (JSON_simdIsPlain(*p))
+        p++;
+
+    return (size_t)(p - pStart);
+}
+
+static const char* FindNewlineScalar(const char* p, const char* pEnd) {
+    while (p < pEnd && *p != '\n')
+        p++;
+
+    return p;
+}
+
+#ifdef JSON_SIMD_X86
+
+// the kernels read whole aligned blocks, maybe behind the 0 at the end
+#define JSON_SIMD_KERNEL(isa) __attribute__((target(isa), no_sanitize_address))
+
+static inline const char* AlignUp(const char* p, uintptr_t alignment) {
+    return (const char*)(((uintptr_t)p + alignment - 1) & ~(alignment - 1));
+}
+
+JSON_SIMD_KERNEL("sse2")
+static const char* SkipWhitespaceSse2(const char* p) {
+    // one by one up to the first aligned block
+    for (const char* pAligned = AlignUp(p, 16); p != pAligned; p++)
+        if (!JSON_simdIsWhitespace(*p))
+            return p;
+
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriageReturn = _mm_set1_epi8('\r');
+    const __m128i tab = _mm_set1_epi8('\t');
+
+    for (;; p += 16) {
+        __m128i block = _mm_load_si128((const __m128i*)p);
+        __m128i isWhitespace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, newline)),
+                                            _mm_or_si128(_mm_cmpeq_epi8(block, carriageReturn), _mm_cmpeq_epi8(block, tab)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(isWhitespace) ^ 0xFFFFu;
+
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+}
+
+JSON_SIMD_KERNEL("sse2")
+static size_t ScanStringSse2(const char* p) {
+    const char* pStart = p;
+
+    for (const char* pAligned = AlignUp(p, 16); p != pAligned; p++)
+        if (!JSON_simdIsPlain(*p))
+            return (size_t)(p - pStart);
+
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+
+    for (;; p += 16) {
+        __m128i block = _mm_load_si128((const __m128i*)p);
+        // unsigned block <= 0x1F
+        __m128i isControl = _mm_cmpeq_epi8(_mm_max_epu8(block, control), control);
+        __m128i isSpecial = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)), isControl);
+        unsigned mask = (unsigned)_mm_movemask_epi8(isSpecial);
+
+        if (mask)
+            return (size_t)(p + __builtin_ctz(mask) - pStart);
+    }
+}
+
+JSON_SIMD_KERNEL("sse4.2")
+static const char* SkipWhitespaceSse42(const char* p) {
+    for (const char* pAligned = AlignUp(p, 16); p != pAligned; p++)
+        if (!JSON_simdIsWhitespace(*p))
+            return p;
+
+    const __m128i whitespace = _mm_setr_epi8(' ', '\n', '\r', '\t', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    for (;; p += 16) {
+        __m128i block = _mm_load_si128((const __m128i*)p);
+        int idx = _mm_cmpestri(whitespace, 4, block, 16,
+                               _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT | _SIDD_NEGATIVE_POLARITY);
+
+        if (idx != 16)
+            return p + idx;
+    }
+}
+
+JSON_SIMD_KERNEL("sse4.2")
+static size_t ScanStringSse42(const char* p) {
+    const char* pStart = p;
+
+    for (const char* pAligned = AlignUp(p, 16); p != pAligned; p++)
+        if (!JSON_simdIsPlain(*p))
+            return (size_t)(p - pStart);
+
+    // the ranges 0x00-0x1F, '"' and '\\'
+    const __m128i special = _mm_setr_epi8(0x00, 0x1F, '"', '"', '\\', '\\', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    for (;; p += 16) {
+        __m128i block = _mm_load_si128((const __m128i*)p);
+        int idx = _mm_cmpestri(special, 6, block, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+
+        if (idx != 16)
+            return (size_t)(p + idx - pStart);
+    }
+}
+
+JSON_SIMD_KERNEL("avx2")
+static const char* SkipWhitespaceAvx2(const char* p) {
+    for (const char* pAligned = AlignUp(p, 32); p != pAligned; p++)
+        if (!JSON_simdIsWhitespace(*p))
+            return p;
+
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i carriageReturn = _mm256_set1_epi8('\r');
+    const __m256i tab = _mm256_set1_epi8('\t');
+
+    for (;; p += 32) {
+        __m256i block = _mm256_load_si256((const __m256i*)p);
+        __m256i isWhitespace = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, newline)),
+                                               _mm256_or_si256(_mm256_cmpeq_epi8(block, carriageReturn), _mm256_cmpeq_epi8(block, tab)));
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(isWhitespace);
+
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+}
+
+JSON_SIMD_KERNEL("avx2")
+static size_t ScanStringAvx2(const char* p) {
+    const char* pStart = p;
+
+    for (const char* pAligned = AlignUp(p, 32); p != pAligned; p++)
+        if (!JSON_simdIsPlain(*p))
+            return (size_t)(p - pStart);
+
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+
+    for (;; p += 32) {
+        __m256i block = _mm256_load_si256((const __m256i*)p);
+        __m256i isControl = _mm256_cmpeq_epi8(_mm256_max_epu8(block, control), control);
+        __m256i isSpecial = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash)),
+                                            isControl);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(isSpecial);
+
+        if (mask)
+            return (size_t)(p + __builtin_ctz(mask) - pStart);
+    }
+}
+
+// SSE4.2 has nothing better for a single character
+JSON_SIMD_KERNEL("sse2")
+static const char* FindNewlineSse2(const char* p, const char* pEnd) {
+    for (const char* pAligned = AlignUp(p, 16); p != pAligned; p++)
+        if (p >= pEnd || *p == '\n')
+            return p;
+
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    // the last block may reach behind pEnd, but not across a page
+    for (; p < pEnd; p += 16) {
+        __m128i block = _mm_load_si128((const __m128i*)p);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+
+        if (mask)
+            return std::min(p + __builtin_ctz(mask), pEnd);
+    }
+
+    return pEnd;
+}
+
+JSON_SIMD_KERNEL("avx2")
+static const char* FindNewlineAvx2(const char* p, const char* pEnd) {
+    for (const char* pAligned = AlignUp(p, 32); p != pAligned; p++)
+        if (p >= pEnd || *p == '\n')
+            return p;
+
+    const __m256i newline = _mm256_set1_epi8('\n');
+
+    for (; p < pEnd; p += 32) {
+        __m256i block = _mm256_load_si256((const __m256i*)p);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline));
+
+        if (mask)
+            return std::min(p + __builtin_ctz(mask), pEnd);
+    }
+
+    return pEnd;
+}
+
+#endif
+
+static const JsonSimdKernels kKernels[JSON_SIMD_PATH_COUNT] = {
+    {SkipWhitespaceScalar, ScanStringScalar, FindNewlineScalar},
+#ifdef JSON_SIMD_X86
+    {SkipWhitespaceSse2, ScanStringSse2, FindNewlineSse2},
+    {SkipWhitespaceSse42, ScanStringSse42, FindNewlineSse2},
+    {SkipWhitespaceAvx2, ScanStringAvx2, FindNewlineAvx2},
+#else
+    {SkipWhitespaceScalar, ScanStringScalar, FindNewlineScalar},
+    {SkipWhitespaceScalar, ScanStringScalar, FindNewlineScalar},
+    {SkipWhitespaceScalar, ScanStringScalar, FindNewlineScalar},
+#endif
+};
+
+static const char* const kPathNames[JSON_SIMD_PATH_COUNT] = {"scalar", "SSE2", "SSE4.2", "AVX2"};
+
+// scalar until the CPU is checked, a parse during static initialization works, too
+JsonSimdKernels jsonSimdKernels = {SkipWhitespaceScalar, ScanStringScalar, FindNewlineScalar};
+
+static JsonSimdPath activePath = JSON_SIMD_SCALAR;
+
+bool JSON_simdPathSupported(JsonSimdPath path) {
+    switch (path) {
+    case JSON_SIMD_SCALAR:
+        return true;
+#ifdef JSON_SIMD_X86
+    case JSON_SIMD_SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+    case JSON_SIMD_SSE42:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.2");
+    case JSON_SIMD_AVX2:
+        // checks that the OS saves the AVX registers, too
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+JsonSimdPath JSON_simdBestPath() {
+    int path = JSON_SIMD_PATH_COUNT - 1;
+
+    while (!JSON_simdPathSupported((JsonSimdPath)path))
+        path--;
+
+    return (JsonSimdPath)path;
+}
+
+bool JSON_simdSetPath(JsonSimdPath path) {
+    if (!JSON_simdPathSupported(path))
+        return false;
+
+    jsonSimdKernels = kKernels[path];
+    activePath = path;
+    return true;
+}
+
+JsonSimdPath JSON_simdGetPath() {
+    return activePath;
+}
+
+const char* JSON_simdPathName(JsonSimdPath path) {
+    return path >= JSON_SIMD_SCALAR && path < JSON_SIMD_PATH_COUNT ? kPathNames[path] : "unknown";
+}
+
+// the dispatch at startup
+static struct JsonSimdDispatch {
+    JsonSimdDispatch() {
+        JSON_simdSetPath(JSON_simdBestPath());
+    }
+} simdDispatch;
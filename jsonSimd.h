@@ -0,0 +1,96 @@
+/*
+ * jsonSimd.h
+ *
+ * The scanning loops of the parse entry points (JSON_parse, JSON_TextToBin),
+ * with the instruction set picked by CPUID at startup (see JsonSimdPath).
+ *
+ * rapidjson decides on SSE2/SSE4.2 when it is compiled and has nothing for
+ * AVX2, a binary built for the oldest target never uses what the machine
+ * has. JsonInsituStream is rapidjson's in situ stream with its two hot loops
+ * handed to the kernels of the active path: whitespace between tokens
+ * (SkipWhitespace) and the plain characters of a string
+ * (GenericReader::ScanCopyUnescapedString). A reader type that parses a
+ * JsonInsituStream needs JSON_SIMD_READER for its allocator, before its first
+ * Parse. JSON_linesOpen finds the line ends of JSON Lines with them, too.
+ *
+ * The kernels load aligned blocks: they may read up to 31 bytes behind the
+ * terminating 0 of the text (the end of the lines), never across a page.
+ */
+
+#ifndef JSONSIMD_H_
+#define JSONSIMD_H_
+
+#include <stddef.h>
+#include <cstring>
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/reader.h"
+
+#include "jsonWrapper.h"
+
+struct JsonSimdKernels {
+    const char*	(*skipWhitespace)(const char* p);	// the first character that isn't ' ', \n, \r or \t
+    size_t		(*scanString)(const char* p);		// the characters before the first '"', '\\' or control character (the 0, too)
+    const char*	(*findNewline)(const char* p, const char* pEnd);	// the first '\n' before pEnd, else pEnd (JSON Lines)
+};
+
+// the kernels of the active path
+extern JsonSimdKernels jsonSimdKernels;
+
+static inline bool JSON_simdIsWhitespace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline bool JSON_simdIsPlain(char c) {
+    return (unsigned char)c >= 0x20 && c != '"' && c != '\\';
+}
+
+class JsonInsituStream : public RAPIDJSON_NAMESPACE::InsituStringStream {
+  public:
+    explicit JsonInsituStream(char* text) : RAPIDJSON_NAMESPACE::InsituStringStream(text) {
+    }
+};
+
+// keys and short values end within a few characters, they don't pay for the call
+static inline void JSON_simdScanString(JsonInsituStream& is, JsonInsituStream& os) {
+    const char* p = is.src_;
+    size_t length = 0;
+
+    while (length < 16 && JSON_simdIsPlain(p[length]))
+        length++;
+
+    if (length == 16)
+        length += jsonSimdKernels.scanString(p + length);
+
+    // an escape sequence before made the string shorter
+    if (os.dst_ != is.src_)
+        memmove(os.dst_, is.src_, length);
+
+    is.src_ += length;
+    os.dst_ += length;
+}
+
+RAPIDJSON_NAMESPACE_BEGIN
+
+// compact text has no whitespace at all, a single check
+template<>
+inline void SkipWhitespace(JsonInsituStream& is) {
+    if (JSON_simdIsWhitespace(*is.src_))
+        is.src_ = const_cast<char*>(jsonSimdKernels.skipWhitespace(is.src_));
+}
+
+RAPIDJSON_NAMESPACE_END
+
+#define JSON_SIMD_READER(StackAllocator) \
+    RAPIDJSON_NAMESPACE_BEGIN \
+    template<> template<> \
+    inline void GenericReader<UTF8<>, UTF8<>, StackAllocator>::ScanCopyUnescapedString<JsonInsituStream, JsonInsituStream>( \
+            JsonInsituStream& is, JsonInsituStream& os) { \
+        JSON_simdScanString(is, os); \
+    } \
+    RAPIDJSON_NAMESPACE_END
+
+// rapidjson::Reader
+JSON_SIMD_READER(CrtAllocator)
+
+#endif /* JSONSIMD_H_ */
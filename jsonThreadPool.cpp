@@ -0,0 +1,84 @@
+//============================================================================
+// Name        : jsonThreadPool.cpp
+// Description : Threads shared by the batch functions of a parser handle
+//============================================================================
+
+#include "jsonThreadPool.h"
+
+JsonThreadPool::JsonThreadPool(unsigned int threadCount) : pJob(NULL), generation(0), running(0), stop(false) {
+
+    if (threadCount == 0)
+        threadCount = std::thread::hardware_concurrency();
+
+    // the calling thread is worker 0
+    for (unsigned int workerIdx = 1; workerIdx < threadCount; workerIdx++)
+        threads.push_back(std::thread(&JsonThreadPool::WorkerLoop, this, workerIdx));
+}
+
+JsonThreadPool::~JsonThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+
+    wake.notify_all();
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void JsonThreadPool::Run(const std::function<void(unsigned int)>& job) {
+
+    if (!threads.empty()) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        pJob = &job;
+        running = (unsigned int)threads.size();
+        generation++;
+    }
+
+    wake.notify_all();
+
+    job(0);
+
+    if (!threads.empty()) {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        done.wait(lock, [this]() {
+            return running == 0;
+        });
+
+        pJob = NULL;
+    }
+}
+
+void JsonThreadPool::WorkerLoop(unsigned int workerIdx) {
+    uint64_t lastGeneration = 0;
+
+    for (;;) {
+        const std::function<void(unsigned int)>* pCurrentJob;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            wake.wait(lock, [this, lastGeneration]() {
+                return stop || generation != lastGeneration;
+            });
+
+            if (stop)
+                return;
+
+            lastGeneration = generation;
+            pCurrentJob = pJob;
+        }
+
+        (*pCurrentJob)(workerIdx);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (--running == 0)
+                done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,48 @@
+/*
+ * jsonThreadPool.h
+ *
+ * Fixed set of threads that run one job at a time on all of them,
+ * the calling thread taking part as worker 0 (see JSON_TextToBinBatch).
+ */
+
+#ifndef JSONTHREADPOOL_H_
+#define JSONTHREADPOOL_H_
+
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class JsonThreadPool {
+  public:
+    // threadCount includes the calling thread, 0 for one thread per core
+    explicit JsonThreadPool(unsigned int threadCount);
+
+    ~JsonThreadPool();
+
+    unsigned int GetThreadCount() const {
+        return (unsigned int)threads.size() + 1;
+    }
+
+    // run job(workerIdx) on every thread, returns when all of them are done
+    void Run(const std::function<void(unsigned int)>& job);
+
+  private:
+    JsonThreadPool(const JsonThreadPool&);
+    JsonThreadPool& operator=(const JsonThreadPool&);
+
+    void WorkerLoop(unsigned int workerIdx);
+
+    std::mutex									mutex;
+    std::condition_variable						wake;
+    std::condition_variable						done;
+    const std::function<void(unsigned int)>*	pJob;
+    uint64_t									generation;	// counts the jobs, a worker runs each one once
+    unsigned int								running;	// workers still busy with the current job
+    bool										stop;
+    std::vector<std::thread>					threads;
+};
+
+#endif /* JSONTHREADPOOL_H_ */
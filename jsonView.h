@@ -0,0 +1,188 @@
+/*
+ * jsonView.h
+ *
+ * Non-owning views into a parsed document, handed out by GetValue/GetMember
+ * for arrays and objects. A view points at the values in the DOM, nothing is
+ * copied or moved, the document stays intact. It is valid as long as the
+ * document is.
+ */
+
+#ifndef JSONVIEW_H_
+#define JSONVIEW_H_
+
+#include "rapidjson/document.h"
+
+// type check and accessor of the element types of an array view
+template <typename T> struct JsonViewElement;
+
+// any value, usually objects
+template <> struct JsonViewElement<rapidjson::Value> {
+    typedef const rapidjson::Value& Type;
+
+    static bool Is(const rapidjson::Value &) {
+        return true;
+    }
+
+    static Type Get(const rapidjson::Value &val) {
+        return val;
+    }
+};
+
+template <> struct JsonViewElement<int> {
+    typedef int Type;
+
+    static bool Is(const rapidjson::Value &val) {
+        return val.IsInt();
+    }
+
+    static Type Get(const rapidjson::Value &val) {
+        return val.GetInt();
+    }
+};
+
+template <> struct JsonViewElement<unsigned> {
+    typedef unsigned Type;
+
+    static bool Is(const rapidjson::Value &val) {
+        return val.IsUint();
+    }
+
+    static Type Get(const rapidjson::Value &val) {
+        return val.GetUint();
+    }
+};
+
+template <> struct JsonViewElement<double> {
+    typedef double Type;
+
+    static bool Is(const rapidjson::Value &val) {
+        return val.IsDouble();
+    }
+
+    static Type Get(const rapidjson::Value &val) {
+        return val.GetDouble();
+    }
+};
+
+template <> struct JsonViewElement<bool> {
+    typedef bool Type;
+
+    static bool Is(const rapidjson::Value &val) {
+        return val.IsBool();
+    }
+
+    static Type Get(const rapidjson::Value &val) {
+        return val.GetBool();
+    }
+};
+
+// strings stay in the document (in situ parsing: in the parsed text)
+template <> struct JsonViewElement<const char*> {
+    typedef const char* Type;
+
+    static bool Is(const rapidjson::Value &val) {
+        return val.IsString();
+    }
+
+    static Type Get(const rapidjson::Value &val) {
+        return val.GetString();
+    }
+};
+
+// the first elements of a JSON array, all of them of type T
+template <typename T> class JsonArrayView {
+  public:
+    typedef typename JsonViewElement<T>::Type Reference;
+
+    class Iterator {
+      public:
+        explicit Iterator(const rapidjson::Value *pValue) : pValue(pValue) {
+        }
+
+        Reference operator*() const {
+            return JsonViewElement<T>::Get(*pValue);
+        }
+
+        Iterator& operator++() {
+            ++pValue;
+            return *this;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return pValue == other.pValue;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return pValue != other.pValue;
+        }
+
+      private:
+        const rapidjson::Value *pValue;
+    };
+
+    JsonArrayView() : pElements(NULL), count(0) {
+    }
+
+    // view at most cnt elements of array, false (and an empty view) if one of them is no T
+    bool Assign(const rapidjson::Value &array, rapidjson::SizeType cnt) {
+        rapidjson::SizeType n = array.Size() < cnt ? array.Size() : cnt;
+
+        pElements = NULL;
+        count = 0;
+
+        for(rapidjson::SizeType i = 0; i < n; ++i) {
+            if(!JsonViewElement<T>::Is(array[i]))
+                return false;
+        }
+
+        pElements = array.Begin();
+        count = n;
+
+        return true;
+    }
+
+    rapidjson::SizeType Size() const {
+        return count;
+    }
+
+    bool Empty() const {
+        return count == 0;
+    }
+
+    Reference operator[](rapidjson::SizeType idx) const {
+        RAPIDJSON_ASSERT(idx < count);
+        return JsonViewElement<T>::Get(pElements[idx]);
+    }
+
+    Iterator begin() const {
+        return Iterator(pElements);
+    }
+
+    Iterator end() const {
+        return Iterator(pElements + count);
+    }
+
+  private:
+    const rapidjson::Value *pElements;
+    rapidjson::SizeType count;
+};
+
+// a JSON object, passed to GetValue/GetMember like the value itself
+class JsonObjectView {
+  public:
+    JsonObjectView() : pObject(NULL) {
+    }
+
+    explicit JsonObjectView(const rapidjson::Value *pObject) : pObject(pObject) {
+    }
+
+    operator const rapidjson::Value&() const {
+        RAPIDJSON_ASSERT(pObject != NULL);
+        return *pObject;
+    }
+
+  private:
+    const rapidjson::Value *pObject;
+};
+
+#endif /* JSONVIEW_H_ */
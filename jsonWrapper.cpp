@@ -9,14 +9,36 @@
 #include <iostream>
 #include <string>
 #include <cassert>
+#include <cmath>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
 
 #include <stdint.h>
+#include <stdio.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JSON_IMAGE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #if defined(OL91)
 #include <el/osal/logger.h>
 #endif
 
 #include "jsonWrapper.h"
+#include "jsonPlan.h"
+#include "jsonSaxDecoder.h"
+#include "jsonIncremental.h"
+#include "jsonDecodeCache.h"
+#include "jsonError.h"
+#include "jsonThreadPool.h"
+#include "jsonFreeList.h"
+#include "jsonCursor.h"
+#include "jsonSimd.h"
 
 #include "rapidjson/rapidjson.h"
 #include "rapidjson/document.h"
@@ -24,6 +46,10 @@
 #include "rapidjson/filereadstream.h"
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
+#include "rapidjson/reader.h"
+#include "rapidjson/memorystream.h"
+#include "rapidjson/internal/itoa.h"
+#include "rapidjson/internal/dtoa.h"
 
 using namespace rapidjson;
 
@@ -42,6 +68,9 @@ public:
     static void Free(void *ptr) { delete[] ptr; }
 };
 */
+// blocks the allocators below moved to grow, on the calling thread (JSON_getThreadReallocCopies)
+static thread_local uint64_t threadReallocCopies = 0;
+
 class MyAllocator_New {
   public:
     static const bool kNeedFree = true;
@@ -52,32 +81,291 @@ class MyAllocator_New {
         void* newPtr = Malloc(newSize);
         memcpy(newPtr, originalPtr, originalSize);
         Free(originalPtr);
+        if (originalPtr != NULL)
+            threadReallocCopies++;
         return newPtr;
     }
     static void Free(void *ptr) {
         delete[] (unsigned char*)ptr;
     }
 };
+
+// Arena owned by each parser handle, based on new and delete as well.
+// Malloc only bumps a pointer, Free does nothing. Reset() rewinds to the first
+// chunk in O(1) and keeps every chunk, so after the first few messages no more
+// heap calls are done. The first chunk may be a buffer supplied by the caller.
+class MyAllocator_Arena {
+  public:
+    static const bool kNeedFree = false;
+    static const size_t kDefaultChunkCapacity = 0x4000;
+
+    MyAllocator_Arena() : pHead(NULL), pCurrent(NULL), used(0), cycleBytes(0), highWater(0), capacity(0), chunkCount(0), heapAllocations(0), reallocCopies(0) {
+    }
+
+    ~MyAllocator_Arena() {
+        while (pHead) {
+            Chunk* pNext = pHead->pNext;
+            if (pHead->owned)
+                delete[] (unsigned char*)pHead;
+            pHead = pNext;
+        }
+    }
+
+    void* Malloc(size_t size) {
+        if (size == 0)
+            return NULL;
+
+        size = RAPIDJSON_ALIGN(size);
+
+        if (pCurrent == NULL || used + size > pCurrent->capacity)
+            NextChunk(size);
+
+        void* ptr = ChunkData(pCurrent) + used;
+        used += size;
+        cycleBytes += size;
+
+        if (cycleBytes > highWater)
+            highWater = cycleBytes;
+
+        return ptr;
+    }
+
+    void* Realloc(void* originalPtr, size_t originalSize, size_t newSize) {
+        if (originalPtr == NULL)
+            return Malloc(newSize);
+
+        if (newSize == 0)
+            return NULL;
+
+        originalSize = RAPIDJSON_ALIGN(originalSize);
+        newSize = RAPIDJSON_ALIGN(newSize);
+
+        if (originalSize >= newSize)
+            return originalPtr;
+
+        // the last allocation grows in place if the chunk has room left
+        if ((unsigned char*)originalPtr + originalSize == ChunkData(pCurrent) + used
+                && used + (newSize - originalSize) <= pCurrent->capacity) {
+            used += newSize - originalSize;
+            cycleBytes += newSize - originalSize;
+
+            if (cycleBytes > highWater)
+                highWater = cycleBytes;
+
+            return originalPtr;
+        }
+
+        void* newPtr = Malloc(newSize);
+        memcpy(newPtr, originalPtr, originalSize);
+        reallocCopies++;
+        threadReallocCopies++;
+        return newPtr;
+    }
+
+    static void Free(void*) {
+    }
+
+    // forget everything allocated so far, all chunks stay for the next message
+    void Reset() {
+        pCurrent = pHead;
+        used = 0;
+        cycleBytes = 0;
+    }
+
+    // use a caller-supplied buffer as first chunk, it has to outlive the arena
+    // (8 byte aligned as the chunks from the heap, with room for the header and at least one block)
+    bool SetBuffer(void* buffer, size_t size) {
+        if (buffer == NULL || ((uintptr_t)buffer & 7) != 0 || size < RAPIDJSON_ALIGN(sizeof(Chunk)) + 8)
+            return false;
+
+        Chunk* pChunk = (Chunk*)buffer;
+        pChunk->pNext = pHead;
+        pChunk->capacity = (size - RAPIDJSON_ALIGN(sizeof(Chunk))) & ~(size_t)7;
+        pChunk->owned = false;
+
+        pHead = pChunk;
+        capacity += pChunk->capacity;
+        chunkCount++;
+
+        Reset();
+
+        return true;
+    }
+
+    size_t GetHighWater() const {
+        return highWater;
+    }
+
+    size_t GetCapacity() const {
+        return capacity;
+    }
+
+    size_t GetChunkCount() const {
+        return chunkCount;
+    }
+
+    size_t GetHeapAllocations() const {
+        return heapAllocations;
+    }
+
+    size_t GetReallocCopies() const {
+        return reallocCopies;
+    }
+
+  private:
+    struct Chunk {
+        Chunk*	pNext;
+        size_t	capacity;
+        bool	owned;
+    };
+
+    static unsigned char* ChunkData(Chunk* pChunk) {
+        return (unsigned char*)pChunk + RAPIDJSON_ALIGN(sizeof(Chunk));
+    }
+
+    // continue in the next chunk that is large enough, a new one is only allocated during warm-up
+    void NextChunk(size_t size) {
+        Chunk* pPrev = pCurrent;
+        Chunk* pNext = pCurrent ? pCurrent->pNext : pHead;
+
+        while (pNext && pNext->capacity < size) {
+            pPrev = pNext;
+            pNext = pNext->pNext;
+        }
+
+        if (pNext == NULL) {
+            size_t chunkCapacity = size > kDefaultChunkCapacity ? size : kDefaultChunkCapacity;
+
+            pNext = (Chunk*)new unsigned char[RAPIDJSON_ALIGN(sizeof(Chunk)) + chunkCapacity];
+            pNext->pNext = NULL;
+            pNext->capacity = chunkCapacity;
+            pNext->owned = true;
+
+            if (pPrev)
+                pPrev->pNext = pNext;
+            else
+                pHead = pNext;
+
+            capacity += chunkCapacity;
+            chunkCount++;
+            heapAllocations++;
+        }
+
+        // the rest of the current chunk is not used any more in this cycle
+        if (pCurrent)
+            cycleBytes += pCurrent->capacity - used;
+
+        pCurrent = pNext;
+        used = 0;
+    }
+
+    Chunk*	pHead;
+    Chunk*	pCurrent;
+    size_t	used;				// bytes used in pCurrent
+    size_t	cycleBytes;			// bytes used since the last Reset()
+    size_t	highWater;			// maximum of cycleBytes
+    size_t	capacity;
+    size_t	chunkCount;
+    size_t	heapAllocations;
+    size_t	reallocCopies;		// Realloc calls that couldn't grow in place
+};
+
 /////Use memory leak free allocator
-typedef MyAllocator_New MyAllocator;
+//typedef MyAllocator_New MyAllocator;
+
+/////Use the arena of the parser handle, reset before each message
+typedef MyAllocator_Arena MyAllocator;
 
 /////Back to standard allocator
 //typedef MemoryPoolAllocator<> MyAllocator;
 
 // define types for document and value based on the new Allocator
-typedef GenericDocument<UTF8<>, MyAllocator > MyDocument;
+// (the parse stack of the document comes from the same arena)
+typedef GenericDocument<UTF8<>, MyAllocator, MyAllocator > MyDocument;
 typedef GenericValue<UTF8<>, MyAllocator > MyValue;
 
+// the parse stack of MyDocument scans with the kernels of jsonSimd.h, too
+JSON_SIMD_READER(MyAllocator)
+
+// initial size of the parse stack of a document
+static const size_t kDocumentStackCapacity = 1024;
+// JSON_ENCODE_DELTA: every 100th text is a full one unless JSON_parserSetDeltaInterval says otherwise
+static const uint32_t kDefaultDeltaInterval = 100;
+
 #include <unordered_map>
 #include <vector>
+#include <list>
+
+struct JsonFrozenInterpreter;
+struct RW_Parser;
+
+// what an InterpreterObjectHandle points to: the members of the object and the handle they belong to
+struct RW_InterpreterObject {
+    RW_Parser*												pParser;
+    std::unordered_map<std::string, JsonBinaryStructMapInfo>*	pMembers;
+};
 
 struct RW_Parser {
+    MyAllocator*			pAllocator;
     MyDocument* 			pDocument;
     StringBuffer* 			pBuffer;
     Writer<StringBuffer>* 	pWriter;
     // outer(object-name    inner (member-name  type/offset/size       ) )  interpreter
     std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >*	pInterpreter;
     bool					interpreterAllocated;
+    // compiled form of pInterpreter, NULL until JSON_parserCompile
+    JsonPlan*				pPlan;
+    JsonDecodeMode			decodeMode;
+    JsonSaxDecoder*			pSaxDecoder;
+    JsonIncrementalDecoder*	pIncrementalDecoder;
+    // JSON_TextToBinN without a DOM: the strings of the read-only text go through its stack, it keeps its capacity
+    Reader*					pSpanReader;
+    JsonEncodeMode			encodeMode;
+    // pBuffer holds the text of the last JSON_BinToText already (template), nothing left to serialize
+    bool					outputRendered;
+    // JSON_ENCODE_DELTA: the binary struct as of the last text, false until the next full text,
+    // every deltaInterval-th text is a full one, deltaCount texts went out since the last full one
+    std::vector<unsigned char>	deltaSnapshot;
+    bool					deltaValid;
+    uint32_t				deltaInterval;
+    uint32_t				deltaCount;
+    // path and error record of the message being worked on
+    JsonErrorSink			errorSink;
+    // JSON_TextToBinBatch: the threads and a parser for each thread besides the calling one
+    // (sharing pInterpreter and pPlan)
+    JsonThreadPool*					pThreadPool;
+    std::vector<RW_Parser*>			batchParsers;
+    // shared, immutable interpreter (pInterpreter and pPlan point into it), NULL if the handle has its own
+    JsonFrozenInterpreter*			pFrozen;
+    // slot of the handle in its JsonParserPool
+    uint32_t						poolIndex;
+    // per member of pPlan: where it was found in the last message (JSON_DECODE_DOM)
+    std::vector<uint32_t>			memberPositions;
+    // images of earlier decodes, NULL unless JSON_parserSetDecodeCache
+    JsonDecodeCache*				pDecodeCache;
+    // the objects handed out by JSON_parserNewObject (a list keeps their addresses)
+    std::list<RW_InterpreterObject>	interpreterObjects;
+};
+
+// A compiled interpreter that doesn't change anymore. Any number of handles
+// on any number of threads work with it, it's released with the last one.
+// Loaded from an image it has the plan only, in place within the image.
+struct JsonFrozenInterpreter {
+    JsonInterpreter			interpreter;	// never written after JSON_interpreterFreeze, empty for an image
+    JsonPlan*				pPlan;
+    std::atomic<uint32_t>	refCount;		// the reference of JSON_interpreterFreeze and one per handle
+    bool					fromImage;		// pPlan lies in an image, it isn't deleted
+    void*					pMapping;		// the image file mapped by JSON_interpreterLoadImage, NULL if there's none
+    size_t					mappingSize;
+};
+
+// handles sharing a frozen interpreter, built up front and handed out without a lock
+struct JsonParserPool {
+    explicit JsonParserPool(uint32_t handleCount) : freeList(handleCount) {
+    }
+
+    JsonFreeList			freeList;
+    std::vector<RW_Parser*>	parsers;
 };
 
 // A JSON object consists of a list of JSON-members. Each member has a name and
@@ -85,14 +373,36 @@ struct RW_Parser {
 // The inner map below stores the members of an object.
 // The outer map below stores the object of an interpreter.
 
-// use this to create interpreter step by step
-ParserHandle JSON_parserNew() {
+static RW_Parser* NewParser() {
     RW_Parser* pDocStrBufWriter = new RW_Parser();
 
-    pDocStrBufWriter->pDocument = new MyDocument();
+    pDocStrBufWriter->pAllocator = new MyAllocator();
+    pDocStrBufWriter->pDocument = new MyDocument(pDocStrBufWriter->pAllocator, kDocumentStackCapacity, pDocStrBufWriter->pAllocator);
     pDocStrBufWriter->pBuffer = new StringBuffer();
     pDocStrBufWriter->pWriter = new Writer<StringBuffer>(*(pDocStrBufWriter->pBuffer));
 
+    pDocStrBufWriter->pPlan = NULL;
+    pDocStrBufWriter->decodeMode = JSON_DECODE_DOM;
+    pDocStrBufWriter->pSaxDecoder = NULL;
+    pDocStrBufWriter->pIncrementalDecoder = NULL;
+    pDocStrBufWriter->pSpanReader = NULL;
+    pDocStrBufWriter->encodeMode = JSON_ENCODE_DOM;
+    pDocStrBufWriter->outputRendered = false;
+    pDocStrBufWriter->deltaValid = false;
+    pDocStrBufWriter->deltaInterval = kDefaultDeltaInterval;
+    pDocStrBufWriter->deltaCount = 0;
+    pDocStrBufWriter->pThreadPool = NULL;
+    pDocStrBufWriter->pFrozen = NULL;
+    pDocStrBufWriter->poolIndex = 0;
+    pDocStrBufWriter->pDecodeCache = NULL;
+
+    return pDocStrBufWriter;
+}
+
+// use this to create interpreter step by step
+ParserHandle JSON_parserNew() {
+    RW_Parser* pDocStrBufWriter = NewParser();
+
     pDocStrBufWriter->pInterpreter = new std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >;
     pDocStrBufWriter->interpreterAllocated = true;
 
@@ -101,11 +411,15 @@ ParserHandle JSON_parserNew() {
 
 // use this to use a pre-initialized interpreter
 ParserHandle JSON_parserNew(std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >*	pInterpreter) {
-    RW_Parser* pDocStrBufWriter = new RW_Parser();
+    std::string fault;
 
-    pDocStrBufWriter->pDocument = new MyDocument();
-    pDocStrBufWriter->pBuffer = new StringBuffer();
-    pDocStrBufWriter->pWriter = new Writer<StringBuffer>(*(pDocStrBufWriter->pBuffer));
+    // its members never went through JSON_parserObjectAddMember
+    if (!JSON_planCheck(*pInterpreter, fault)) {
+        std::cout << "JSON for PLC: " << fault << ", interpreter not used." << std::endl;
+        return NULL;
+    }
+
+    RW_Parser* pDocStrBufWriter = NewParser();
 
     pDocStrBufWriter->pInterpreter = pInterpreter;
     pDocStrBufWriter->interpreterAllocated = false;
@@ -113,848 +427,2414 @@ ParserHandle JSON_parserNew(std::unordered_map<std::string, std::unordered_map<s
     return pDocStrBufWriter;
 }
 
-bool JSON_parse(ParserHandle docHandle, char* jsonString) {
-    // 1. Parse a JSON string into DOM.
+#ifdef JSON_IMAGE_MMAP
 
-    RW_Parser* pDocStrBufWriter = (RW_Parser*)docHandle;
+// an interpreter image file, mapped read only (the pages are shared by all processes using it)
+static void* MapImage(const char* path, size_t& size) {
+    int fd = open(path, O_RDONLY);
 
-    pDocStrBufWriter->pDocument->ParseInsitu(jsonString);
+    if (fd < 0)
+        return NULL;
 
-    if (pDocStrBufWriter->pDocument->HasParseError()) {
-        // if there's a parsing error do not return a document
-        return false;
-    }
+    struct stat fileStat;
 
-    return true;
-}
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
 
-void JSON_parserDelete(ParserHandle hDoc) {
-    // also clean up a possibly attached writer and buffer
-    if (((RW_Parser*)hDoc)->pDocument)
-        delete ((RW_Parser*)hDoc)->pDocument;
+    size = (size_t)fileStat.st_size;
 
-    if (((RW_Parser*)hDoc)->pBuffer)
-        delete ((RW_Parser*)hDoc)->pBuffer;
+    void* pMapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
 
-    if (((RW_Parser*)hDoc)->pWriter)
-        delete ((RW_Parser*)hDoc)->pWriter;
+    close(fd);
 
-    if ((((RW_Parser*)hDoc)->pInterpreter)
-            && (((RW_Parser*)hDoc)->interpreterAllocated))
-        delete ((RW_Parser*)hDoc)->pInterpreter;
+    return pMapping == MAP_FAILED ? NULL : pMapping;
+}
 
-    delete ((RW_Parser*)hDoc);
+static void UnmapImage(void* pMapping, size_t size) {
+    munmap(pMapping, size);
 }
 
-ValueHandle JSON_getMemberValue(ParserHandle hDoc, const char* jsonMemberName) {
-    // NOTE: "s" does not need to be cleaned up because it's a reference to a member
-    // in the DOM model of the document
-    MyValue* s = &(*((RW_Parser*)hDoc)->pDocument)[jsonMemberName];
+#else
 
-    return s;
-}
+// read into memory where there's no mmap (operator new aligns for any record of the plan)
+static void* MapImage(const char* path, size_t& size) {
+    FILE* pFile = fopen(path, "rb");
 
-const char* JSON_getOutString(ParserHandle hDoc) {
+    if (pFile == NULL)
+        return NULL;
 
-    // Attach writer and stringbuffer if they have not been created for this document yet.
-    // The user of this wrapper does not want to know about the existence of a stringbuffer nor writer.
+    std::vector<unsigned char> image;
+    unsigned char block[4096];
+    size_t blockSize;
 
-    if (!(((RW_Parser*)hDoc)->pBuffer))
-        ((RW_Parser*)hDoc)->pBuffer = new StringBuffer();
+    while ((blockSize = fread(block, 1, sizeof(block), pFile)) != 0)
+        image.insert(image.end(), block, block + blockSize);
 
-    ((RW_Parser*)hDoc)->pBuffer->Clear();
+    fclose(pFile);
 
-    if (!(((RW_Parser*)hDoc)->pWriter))
-        ((RW_Parser*)hDoc)->pWriter = new Writer<StringBuffer>(*(((RW_Parser*)hDoc)->pBuffer));
+    if (image.empty())
+        return NULL;
 
-    ((RW_Parser*)hDoc)->pWriter->Reset(*(((RW_Parser*)hDoc)->pBuffer));
+    size = image.size();
 
-    (((RW_Parser*)hDoc)->pDocument)->Accept(*(((RW_Parser*)hDoc)->pWriter));
+    unsigned char* pImage = new unsigned char[size];
+    memcpy(pImage, image.data(), size);
 
-    return ((RW_Parser*)hDoc)->pBuffer->GetString();
+    return pImage;
 }
 
-bool JSON_isInt(ValueHandle hVal) {
-    return ((MyValue*)hVal)->IsInt();
+static void UnmapImage(void* pMapping, size_t) {
+    delete[] (unsigned char*)pMapping;
 }
 
-int JSON_getIntValue(ValueHandle hVal) {
-    return ((MyValue*)hVal)->GetInt();
-}
+#endif
 
-void JSON_setIntValue(ValueHandle hVal, int anInt) {
-    ((MyValue*)hVal)->SetInt(anInt);
-}
+FrozenInterpreterHandle JSON_interpreterFreeze(ParserHandle hDoc) {
 
+    assert(hDoc != NULL);
 
+    std::string fault;
 
+    if (!JSON_planCheck(*(((RW_Parser*)hDoc)->pInterpreter), fault)) {
+        std::cout << "JSON for PLC: " << fault << ", not frozen." << std::endl;
+        return NULL;
+    }
 
-bool JSON_isUint(ValueHandle hVal) {
-    return ((MyValue*)hVal)->IsUint();
-}
+    JsonFrozenInterpreter* pFrozen = new JsonFrozenInterpreter();
 
-unsigned int JSON_getUintValue(ValueHandle hVal) {
-    return ((MyValue*)hVal)->GetUint();
-}
+    pFrozen->interpreter = *(((RW_Parser*)hDoc)->pInterpreter);
+    pFrozen->pPlan = JSON_planBuild(pFrozen->interpreter);
+    pFrozen->refCount.store(1, std::memory_order_relaxed);
+    pFrozen->fromImage = false;
+    pFrozen->pMapping = NULL;
+    pFrozen->mappingSize = 0;
 
-void JSON_setUintValue(ValueHandle hVal, unsigned int aUint) {
-    ((MyValue*)hVal)->SetUint(aUint);
+    if (pFrozen->pPlan == NULL) {
+        std::cout << "JSON for PLC: interpreter has no root object, not frozen." << std::endl;
+        delete pFrozen;
+        return NULL;
+    }
+
+    return pFrozen;
 }
 
+void JSON_interpreterRelease(FrozenInterpreterHandle hFrozen) {
 
+    JsonFrozenInterpreter* pFrozen = (JsonFrozenInterpreter*)hFrozen;
 
+    if (pFrozen == NULL)
+        return;
 
-bool JSON_isString(ValueHandle hVal) {
-    return ((MyValue*)hVal)->IsString();
-}
+    // the last one deletes it, after all writes of the others (acq_rel)
+    if (pFrozen->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        if (!pFrozen->fromImage)
+            JSON_planDelete(pFrozen->pPlan);
 
-char* JSON_getStringValue(ValueHandle hVal) {
-    return (char*)((MyValue*)hVal)->GetString();
-}
+        if (pFrozen->pMapping)
+            UnmapImage(pFrozen->pMapping, pFrozen->mappingSize);
 
-void JSON_setStringValue(ValueHandle hVal, char* aString) {
-    ((MyValue*)hVal)->SetString(aString, strlen(aString));
+        delete pFrozen;
+    }
 }
 
+size_t JSON_interpreterSaveImage(ParserHandle hDoc, uint64_t layoutKey, void* image, size_t imageCapacity) {
 
+    assert(hDoc != NULL);
 
+    RW_Parser* pParser = (RW_Parser*)hDoc;
 
-bool JSON_isDouble(ValueHandle hVal) {
-    return ((MyValue*)hVal)->IsDouble();
-}
+    if (pParser->pPlan == NULL && !JSON_parserCompile(hDoc))
+        return 0;
 
-double JSON_getDoubleValue(ValueHandle hVal) {
-    return ((MyValue*)hVal)->GetDouble();
+    return JSON_planSaveImage(*(pParser->pPlan), layoutKey, image, imageCapacity);
 }
 
-void JSON_setDoubleValue(ValueHandle hVal, double aDouble) {
-    ((MyValue*)hVal)->SetDouble(aDouble);
-}
+bool JSON_interpreterWriteImage(ParserHandle hDoc, uint64_t layoutKey, const char* path) {
 
+    assert(hDoc != NULL && path != NULL);
 
+    size_t imageSize = JSON_interpreterSaveImage(hDoc, layoutKey, NULL, 0);
 
-bool JSON_isBool(ValueHandle hVal) {
-    return ((MyValue*)hVal)->IsBool();
-}
+    if (imageSize == 0)
+        return false;
 
-bool JSON_getBoolValue(ValueHandle hVal) {
-    return ((MyValue*)hVal)->GetBool();
-}
+    std::vector<unsigned char> image(imageSize);
+    JSON_interpreterSaveImage(hDoc, layoutKey, image.data(), image.size());
 
-void JSON_setBoolValue(ValueHandle hVal, bool aBool) {
-    ((MyValue*)hVal)->SetBool(aBool);
+    FILE* pFile = fopen(path, "wb");
+    bool written = pFile && fwrite(image.data(), 1, image.size(), pFile) == image.size();
+
+    if (pFile && fclose(pFile) != 0)
+        written = false;
+
+    if (!written)
+        std::cout << "JSON for PLC: interpreter image \"" << path << "\" not written." << std::endl;
+
+    return written;
 }
 
+// an interpreter using the plan within image, pMapping (if not NULL) goes with it
+static JsonFrozenInterpreter* FreezeImage(const void* image, size_t size, uint64_t layoutKey, void* pMapping, const char* source) {
+    std::string fault;
+    const JsonPlan* pPlan = JSON_planFromImage(image, size, layoutKey, fault);
 
+    if (pPlan == NULL) {
+        std::cout << "JSON for PLC: interpreter image " << source << ": " << fault << ", not loaded." << std::endl;
+        return NULL;
+    }
 
+    JsonFrozenInterpreter* pFrozen = new JsonFrozenInterpreter();
 
-bool JSON_isArray(ValueHandle hVal) {
-    return ((MyValue*)hVal)->IsArray();
-}
+    // the decode and encode paths only read the plan, the mapping is read only
+    pFrozen->pPlan = const_cast<JsonPlan*>(pPlan);
+    pFrozen->refCount.store(1, std::memory_order_relaxed);
+    pFrozen->fromImage = true;
+    pFrozen->pMapping = pMapping;
+    pFrozen->mappingSize = size;
 
-unsigned int JSON_getArraySize(ValueHandle hVal) {
-    return ((MyValue*)hVal)->Size();
+    return pFrozen;
 }
 
-ValueHandle	JSON_getArrayElement(ValueHandle hVal, unsigned int idx) {
-    MyValue* s = &(((MyValue*)hVal)[idx]);
+FrozenInterpreterHandle JSON_interpreterLoadImage(const char* path, uint64_t layoutKey) {
 
-    return s;
-}
+    assert(path != NULL);
 
-// NOTE: "s" does not need to be cleaned up because it's a reference to a member
-// in the DOM model of the document
+    size_t size;
+    void* pMapping = MapImage(path, size);
+
+    if (pMapping == NULL) {
+        std::cout << "JSON for PLC: interpreter image \"" << path << "\" can't be read." << std::endl;
+        return NULL;
+    }
 
+    JsonFrozenInterpreter* pFrozen = FreezeImage(pMapping, size, layoutKey, pMapping, ("\"" + std::string(path) + "\"").c_str());
 
-bool JSON_isObject(ValueHandle hVal) {
-    return ((Value*)hVal)->IsObject();
+    if (pFrozen == NULL)
+        UnmapImage(pMapping, size);
+
+    return pFrozen;
 }
 
+FrozenInterpreterHandle JSON_interpreterUseImage(const void* image, size_t size, uint64_t layoutKey) {
+    return FreezeImage(image, size, layoutKey, NULL, "in memory");
+}
 
+// use this to work with a frozen interpreter
+ParserHandle JSON_parserNewFrozen(FrozenInterpreterHandle hFrozen) {
 
+    assert(hFrozen != NULL);
 
+    JsonFrozenInterpreter* pFrozen = (JsonFrozenInterpreter*)hFrozen;
+    RW_Parser* pDocStrBufWriter = NewParser();
 
+    pFrozen->refCount.fetch_add(1, std::memory_order_relaxed);
 
+    // the decode and encode paths only read the interpreter, JSON_parserNewObject refuses to change it
+    pDocStrBufWriter->pFrozen = pFrozen;
+    pDocStrBufWriter->pInterpreter = &pFrozen->interpreter;
+    pDocStrBufWriter->interpreterAllocated = false;
+    pDocStrBufWriter->pPlan = pFrozen->pPlan;
 
-uint32_t RecurseInterpret(
-    GenericValue<UTF8<char>, MyAllocator>& jsonObject,
-    std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >* pInterpreter,
-    std::unordered_map<std::string, JsonBinaryStructMapInfo>& jsonObjectMapping,
-    unsigned char* binBuffer,
-    uint32_t binBufferSize);
+    return pDocStrBufWriter;
+}
 
-uint32_t RecurseWrite(
-    MyAllocator& myAlloc,
-    GenericValue<UTF8<char>, MyAllocator>& jsonObject,
-    std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >* pInterpreter,
-    std::unordered_map<std::string, JsonBinaryStructMapInfo>& jsonObjectMapping,
-    unsigned char* binBuffer);
+ParserPoolHandle JSON_parserPoolNew(FrozenInterpreterHandle hFrozen, size_t handleCount) {
 
+    assert(hFrozen != NULL);
+    assert(handleCount < JsonFreeList::kEmpty);
 
-InterpreterObjectHandle JSON_parserNewObject(ParserHandle hDoc, const char* jsonObjectName) {
-    // create a new (empty) map entry for the object
-    std::unordered_map<std::string, JsonBinaryStructMapInfo> jsonMemberDescrVect;
+    JsonParserPool* pPool = new JsonParserPool((uint32_t)handleCount);
 
-    // add it to the map
-    (*(((RW_Parser*)hDoc)->pInterpreter))[std::string(jsonObjectName)] = jsonMemberDescrVect;
+    for (size_t idx = 0; idx < handleCount; idx++) {
+        RW_Parser* pParser = (RW_Parser*)JSON_parserNewFrozen(hFrozen);
+
+        pParser->poolIndex = (uint32_t)idx;
+        pPool->parsers.push_back(pParser);
+    }
 
-    return (InterpreterObjectHandle)&((*(((RW_Parser*)hDoc)->pInterpreter))[std::string(jsonObjectName)]);
+    return pPool;
 }
 
-bool JSON_parserObjectAddMember(InterpreterObjectHandle interpreterObjectHandle, const char* member, JsonDataType dataType, uint32_t offset, uint32_t size) {
-    std::unordered_map<std::string, JsonBinaryStructMapInfo> * pJsonMemberDescrVect = (std::unordered_map<std::string, JsonBinaryStructMapInfo> *)interpreterObjectHandle;
+ParserHandle JSON_parserPoolAcquire(ParserPoolHandle hPool) {
 
-    (*pJsonMemberDescrVect)[std::string(member)] = {dataType, offset, size};
+    assert(hPool != NULL);
 
-    return true;
-}
+    JsonParserPool* pPool = (JsonParserPool*)hPool;
+    uint32_t idx = pPool->freeList.Pop();
 
+    if (idx == JsonFreeList::kEmpty)
+        return NULL;
 
-/*
-	// diagnostic output to check table-to-map-conversion
-	for (auto& object : g_jsonObjectMapping) {
+    return pPool->parsers[idx];
+}
 
-		std::cout << "\tDescription for object: " << object.first << std::endl;
+void JSON_parserPoolRelease(ParserPoolHandle hPool, ParserHandle hDoc) {
 
-		for (auto& member : object.second) {
-			std::cout << "\tMember: " << member.first << std::endl;
-			std::cout << "\t\tDatatype: " << member.second.jsonDataType << std::endl;
-			std::cout << "\t\tOffset to Struct: " << member.second.offsetInBinaryStruct << std::endl;
-			std::cout << "\t\tSize: " << member.second.sizeInBinaryStruct << std::endl;
-		}
+    assert(hPool != NULL && hDoc != NULL);
 
-	}
-*/
+    JsonParserPool* pPool = (JsonParserPool*)hPool;
 
-uint32_t JSON_TextToBin(ParserHandle hDoc, char* jsonString, unsigned char* binBuffer, uint32_t binBufferSize) {
+    assert(pPool->parsers[((RW_Parser*)hDoc)->poolIndex] == hDoc);
 
-    assert(hDoc != NULL);
+    pPool->freeList.Push(((RW_Parser*)hDoc)->poolIndex);
+}
 
-    // cast to pInterpreter
-    std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >* pInterpreter = (((RW_Parser*)hDoc)->pInterpreter);
+void JSON_parserPoolDelete(ParserPoolHandle hPool) {
 
-    MyDocument* pDoc = ((RW_Parser*)hDoc)->pDocument;
+    JsonParserPool* pPool = (JsonParserPool*)hPool;
 
-    // 1. Parse a JSON string into DOM.
-    bool bResult = JSON_parse(hDoc, jsonString);
-    if (!bResult) {
-        std::cout << "JSON parsing error\n";
-        return 10;
-    }
+    if (pPool == NULL)
+        return;
 
-    // Do a standard interpretation, pass the GenericDocument as the GenericValue
-    // (1st param, a GenercDocument is derived from GenericValue)
-    return RecurseInterpret(*pDoc,
-                            pInterpreter,
-                            (*pInterpreter)[""],
-                            binBuffer,
-                            binBufferSize);
+    for (RW_Parser* pParser : pPool->parsers)
+        JSON_parserDelete(pParser);
+
+    delete pPool;
 }
 
-uint32_t JSON_BinToText(ParserHandle hDoc, unsigned char* binBuffer) {
+bool JSON_parserSetArenaBuffer(ParserHandle hDoc, void* buffer, size_t size) {
 
     assert(hDoc != NULL);
 
-    // cast to pInterpreter
-    std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >* pInterpreter = (((RW_Parser*)hDoc)->pInterpreter);
+    // the DOM lives in the arena, start over with an empty document
+    ((RW_Parser*)hDoc)->pDocument->SetNull();
 
-    // reuse the same document that may have been used for parsing
-    // in any case the output string is created new from scratch
-    MyDocument* pDoc = ((RW_Parser*)hDoc)->pDocument;
+    return ((RW_Parser*)hDoc)->pAllocator->SetBuffer(buffer, size);
+}
 
-    // initially the document is an empty object ...
-    pDoc->SetObject();
+bool JSON_parserGetStats(ParserHandle hDoc, JsonParserStats* pStats) {
+
+    assert(hDoc != NULL);
+
+    if (pStats == NULL)
+        return false;
+
+    MyAllocator* pAllocator = ((RW_Parser*)hDoc)->pAllocator;
+
+    pStats->arenaHighWater = pAllocator->GetHighWater();
+    pStats->arenaCapacity = pAllocator->GetCapacity();
+    pStats->arenaChunks = pAllocator->GetChunkCount();
+    pStats->heapAllocations = pAllocator->GetHeapAllocations();
+    pStats->reallocCopies = pAllocator->GetReallocCopies();
+
+    return true;
+}
+
+uint64_t JSON_getThreadReallocCopies() {
+    return threadReallocCopies;
+}
+
+// the DOM of the text in stream, in situ or with the strings copied to the arena (parseFlags)
+template<unsigned parseFlags, typename Stream>
+static bool ParseDocument(RW_Parser* pDocStrBufWriter, Stream& stream) {
+
+    // the previous DOM is not needed any more, its memory is reused
+    pDocStrBufWriter->pAllocator->Reset();
+    // JSON_getOutString serializes this document from now on
+    pDocStrBufWriter->outputRendered = false;
+
+    pDocStrBufWriter->pDocument->ParseStream<parseFlags>(stream);
+
+    if (pDocStrBufWriter->pDocument->HasParseError()) {
+        // if there's a parsing error do not return a document
+        // (the old one is gone with the arena reset)
+        pDocStrBufWriter->pDocument->SetNull();
+        return false;
+    }
+
+    return true;
+}
+
+bool JSON_parse(ParserHandle docHandle, char* jsonString) {
+    // 1. Parse a JSON string into DOM.
+
+    // ParseInsitu, with the scanning of jsonSimd.h
+    JsonInsituStream stream(jsonString);
+
+    return ParseDocument<kParseInsituFlag>((RW_Parser*)docHandle, stream);
+}
+
+// stop the batch threads and drop their parsers, the interpreter and the plan stay with hDoc
+static void DeleteBatchThreads(RW_Parser* pParser) {
+    if (pParser->pThreadPool)
+        delete pParser->pThreadPool;
+
+    pParser->pThreadPool = NULL;
+
+    for (RW_Parser* pBatchParser : pParser->batchParsers) {
+        pBatchParser->pInterpreter = NULL;
+        pBatchParser->pPlan = NULL;
+        JSON_parserDelete(pBatchParser);
+    }
+
+    pParser->batchParsers.clear();
+}
+
+void JSON_parserDelete(ParserHandle hDoc) {
+    DeleteBatchThreads((RW_Parser*)hDoc);
+
+    // also clean up a possibly attached writer and buffer
+    if (((RW_Parser*)hDoc)->pDocument)
+        delete ((RW_Parser*)hDoc)->pDocument;
+
+    if (((RW_Parser*)hDoc)->pAllocator)
+        delete ((RW_Parser*)hDoc)->pAllocator;
+
+    if (((RW_Parser*)hDoc)->pBuffer)
+        delete ((RW_Parser*)hDoc)->pBuffer;
+
+    if (((RW_Parser*)hDoc)->pWriter)
+        delete ((RW_Parser*)hDoc)->pWriter;
+
+    if ((((RW_Parser*)hDoc)->pInterpreter)
+            && (((RW_Parser*)hDoc)->interpreterAllocated))
+        delete ((RW_Parser*)hDoc)->pInterpreter;
+
+    if (((RW_Parser*)hDoc)->pFrozen)
+        JSON_interpreterRelease(((RW_Parser*)hDoc)->pFrozen);
+    else if (((RW_Parser*)hDoc)->pPlan)
+        JSON_planDelete(((RW_Parser*)hDoc)->pPlan);
+
+    if (((RW_Parser*)hDoc)->pSaxDecoder)
+        delete ((RW_Parser*)hDoc)->pSaxDecoder;
+
+    if (((RW_Parser*)hDoc)->pIncrementalDecoder)
+        delete ((RW_Parser*)hDoc)->pIncrementalDecoder;
+
+    if (((RW_Parser*)hDoc)->pSpanReader)
+        delete ((RW_Parser*)hDoc)->pSpanReader;
+
+    if (((RW_Parser*)hDoc)->pDecodeCache)
+        delete ((RW_Parser*)hDoc)->pDecodeCache;
+
+    delete ((RW_Parser*)hDoc);
+}
+
+ValueHandle JSON_getMemberValue(ParserHandle hDoc, const char* jsonMemberName) {
+    // the same lookup as with a JsonKey, the key is hashed here
+    return JSON_getMemberValue(hDoc, JsonKey(jsonMemberName));
+}
+
+ValueHandle JSON_getMemberValue(ParserHandle hDoc, const JsonKey& jsonMemberName) {
+    // NOTE: the value does not need to be cleaned up because it's a reference to a member
+    // in the DOM model of the document
+    MyDocument& document = *(((RW_Parser*)hDoc)->pDocument);
+
+    if (!document.IsObject())
+        return NULL;
+
+    MyValue::ConstMemberIterator it = JSON_findMember(document, jsonMemberName);
+
+    if (it == document.MemberEnd())
+        return NULL;
+
+    return const_cast<MyValue*>(&it->value);
+}
+
+const char* JSON_getOutString(ParserHandle hDoc) {
+
+    // the template already rendered the text
+    if (((RW_Parser*)hDoc)->outputRendered)
+        return ((RW_Parser*)hDoc)->pBuffer->GetString();
+
+    // Attach writer and stringbuffer if they have not been created for this document yet.
+    // The user of this wrapper does not want to know about the existence of a stringbuffer nor writer.
+
+    if (!(((RW_Parser*)hDoc)->pBuffer))
+        ((RW_Parser*)hDoc)->pBuffer = new StringBuffer();
+
+    ((RW_Parser*)hDoc)->pBuffer->Clear();
+
+    if (!(((RW_Parser*)hDoc)->pWriter))
+        ((RW_Parser*)hDoc)->pWriter = new Writer<StringBuffer>(*(((RW_Parser*)hDoc)->pBuffer));
+
+    ((RW_Parser*)hDoc)->pWriter->Reset(*(((RW_Parser*)hDoc)->pBuffer));
+
+    (((RW_Parser*)hDoc)->pDocument)->Accept(*(((RW_Parser*)hDoc)->pWriter));
+
+    return ((RW_Parser*)hDoc)->pBuffer->GetString();
+}
+
+bool JSON_isInt(ValueHandle hVal) {
+    return ((MyValue*)hVal)->IsInt();
+}
+
+int JSON_getIntValue(ValueHandle hVal) {
+    return ((MyValue*)hVal)->GetInt();
+}
+
+void JSON_setIntValue(ValueHandle hVal, int anInt) {
+    ((MyValue*)hVal)->SetInt(anInt);
+}
+
+
+
+
+bool JSON_isUint(ValueHandle hVal) {
+    return ((MyValue*)hVal)->IsUint();
+}
+
+unsigned int JSON_getUintValue(ValueHandle hVal) {
+    return ((MyValue*)hVal)->GetUint();
+}
+
+void JSON_setUintValue(ValueHandle hVal, unsigned int aUint) {
+    ((MyValue*)hVal)->SetUint(aUint);
+}
+
+
+
+
+bool JSON_isString(ValueHandle hVal) {
+    return ((MyValue*)hVal)->IsString();
+}
+
+char* JSON_getStringValue(ValueHandle hVal) {
+    return (char*)((MyValue*)hVal)->GetString();
+}
+
+void JSON_setStringValue(ValueHandle hVal, char* aString) {
+    ((MyValue*)hVal)->SetString(aString, strlen(aString));
+}
+
+
+
+
+bool JSON_isDouble(ValueHandle hVal) {
+    return ((MyValue*)hVal)->IsDouble();
+}
+
+double JSON_getDoubleValue(ValueHandle hVal) {
+    return ((MyValue*)hVal)->GetDouble();
+}
+
+void JSON_setDoubleValue(ValueHandle hVal, double aDouble) {
+    ((MyValue*)hVal)->SetDouble(aDouble);
+}
+
+
+
+bool JSON_isBool(ValueHandle hVal) {
+    return ((MyValue*)hVal)->IsBool();
+}
+
+bool JSON_getBoolValue(ValueHandle hVal) {
+    return ((MyValue*)hVal)->GetBool();
+}
+
+void JSON_setBoolValue(ValueHandle hVal, bool aBool) {
+    ((MyValue*)hVal)->SetBool(aBool);
+}
+
+
+
+
+bool JSON_isArray(ValueHandle hVal) {
+    return ((MyValue*)hVal)->IsArray();
+}
+
+unsigned int JSON_getArraySize(ValueHandle hVal) {
+    return ((MyValue*)hVal)->Size();
+}
+
+ValueHandle	JSON_getArrayElement(ValueHandle hVal, unsigned int idx) {
+    MyValue* s = &(((MyValue*)hVal)[idx]);
+
+    return s;
+}
+
+// NOTE: "s" does not need to be cleaned up because it's a reference to a member
+// in the DOM model of the document
+
+
+bool JSON_isObject(ValueHandle hVal) {
+    return ((Value*)hVal)->IsObject();
+}
+
+
+
+
+
+
+
+// the members of an object of the interpreter, none if it isn't registered
+// (find, not operator[]: the interpreter may be shared by several threads)
+static const std::unordered_map<std::string, JsonBinaryStructMapInfo>& InterpreterObject(const JsonInterpreter* pInterpreter,
+        const char* objectName) {
+    static const std::unordered_map<std::string, JsonBinaryStructMapInfo> noMembers;
+
+    auto it = pInterpreter->find(objectName);
+
+    return it == pInterpreter->end() ? noMembers : it->second;
+}
+
+uint32_t RecurseInterpret(
+    GenericValue<UTF8<char>, MyAllocator>& jsonObject,
+    const std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >* pInterpreter,
+    const std::unordered_map<std::string, JsonBinaryStructMapInfo>& jsonObjectMapping,
+    unsigned char* binBuffer,
+    uint32_t binBufferSize,
+    JsonErrorSink& sink);
+
+uint32_t RecurseWrite(
+    MyAllocator& myAlloc,
+    GenericValue<UTF8<char>, MyAllocator>& jsonObject,
+    const std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >* pInterpreter,
+    const std::unordered_map<std::string, JsonBinaryStructMapInfo>& jsonObjectMapping,
+    unsigned char* binBuffer,
+    JsonErrorSink& sink);
+
+
+uint32_t PlanInterpret(
+    const JsonPlan& plan,
+    uint32_t objectIdx,
+    GenericValue<UTF8<char>, MyAllocator>& jsonObject,
+    unsigned char* binBuffer,
+    bool singlePass,
+    uint32_t* pPositions,
+    JsonErrorSink& sink);
+
+uint32_t PlanWrite(
+    const JsonPlan& plan,
+    uint32_t objectIdx,
+    unsigned char* binBuffer,
+    StringBuffer& out,
+    JsonErrorSink& sink);
+
+uint32_t PlanWriteDelta(
+    const JsonPlan& plan,
+    uint32_t objectIdx,
+    unsigned char* binBuffer,
+    const unsigned char* pSent,
+    StringBuffer& out,
+    JsonErrorSink& sink);
+
+uint32_t PlanExtent(
+    const JsonPlan& plan,
+    uint32_t objectIdx,
+    const unsigned char* binBuffer);
+
+
+// a compiled plan does not know about a new object or member, it has to be compiled again
+static void DropPlan(RW_Parser* pParser) {
+    if (pParser->pPlan) {
+        JSON_planDelete(pParser->pPlan);
+        pParser->pPlan = NULL;
+    }
+
+    if (pParser->pIncrementalDecoder)
+        pParser->pIncrementalDecoder->Invalidate();
+
+    if (pParser->pDecodeCache)
+        pParser->pDecodeCache->Clear();
+}
+
+InterpreterObjectHandle JSON_parserNewObject(ParserHandle hDoc, const char* jsonObjectName) {
+    // other threads may be reading a frozen interpreter
+    if (((RW_Parser*)hDoc)->pFrozen) {
+        std::cout << "JSON for PLC: interpreter is frozen, object \"" << jsonObjectName << "\" not added." << std::endl;
+        return NULL;
+    }
+
+    DropPlan((RW_Parser*)hDoc);
+
+    // create a new (empty) map entry for the object
+    std::unordered_map<std::string, JsonBinaryStructMapInfo> jsonMemberDescrVect;
+
+    // add it to the map
+    (*(((RW_Parser*)hDoc)->pInterpreter))[std::string(jsonObjectName)] = jsonMemberDescrVect;
+
+    ((RW_Parser*)hDoc)->interpreterObjects.push_back({(RW_Parser*)hDoc, &((*(((RW_Parser*)hDoc)->pInterpreter))[std::string(jsonObjectName)])});
+
+    return (InterpreterObjectHandle)&((RW_Parser*)hDoc)->interpreterObjects.back();
+}
+
+bool JSON_parserObjectAddMember(InterpreterObjectHandle interpreterObjectHandle, const char* member, JsonDataType dataType, uint32_t offset, uint32_t size) {
+    RW_InterpreterObject* pObject = (RW_InterpreterObject*)interpreterObjectHandle;
+
+    // checked once here, JSON_TextToBin relies on it
+    const char* fault = JSON_planCheckMember(dataType, offset, size);
+
+    if (fault) {
+        std::cout << "JSON for PLC: member \"" << member << "\" not added, " << fault << "." << std::endl;
+        return false;
+    }
+
+    DropPlan(pObject->pParser);
+
+    (*(pObject->pMembers))[std::string(member)] = {dataType, offset, size};
+
+    return true;
+}
+
+bool JSON_parserCompile(ParserHandle hDoc) {
+
+    assert(hDoc != NULL);
+
+    RW_Parser* pParser = (RW_Parser*)hDoc;
+
+    // compiled when it was frozen
+    if (pParser->pFrozen)
+        return true;
+
+    // overlaps and nested sizes, the members were checked one by one when they were added
+    std::string fault;
+
+    if (!JSON_planCheck(*(pParser->pInterpreter), fault)) {
+        std::cout << "JSON for PLC: " << fault << ", not compiled." << std::endl;
+        return false;
+    }
+
+    JsonPlan* pPlan = JSON_planBuild(*(pParser->pInterpreter));
+
+    if (pPlan == NULL) {
+        std::cout << "JSON for PLC: interpreter has no root object, not compiled." << std::endl;
+        return false;
+    }
+
+    if (pParser->pPlan)
+        JSON_planDelete(pParser->pPlan);
+
+    pParser->pPlan = pPlan;
+
+    // the fingerprints refer to the members of the old plan
+    if (pParser->pIncrementalDecoder)
+        pParser->pIncrementalDecoder->Invalidate();
+
+    // so does the snapshot, the next delta text is a full one
+    pParser->deltaValid = false;
+
+    // a new plan may be at the address of the old one
+    if (pParser->pDecodeCache)
+        pParser->pDecodeCache->Clear();
+
+    return true;
+}
+
+bool JSON_parserSetDecodeMode(ParserHandle hDoc, JsonDecodeMode mode) {
+
+    assert(hDoc != NULL);
+
+    RW_Parser* pParser = (RW_Parser*)hDoc;
+
+    if (mode != JSON_DECODE_DOM) {
+        // the SAX decoder and the single pass follow the compiled plan
+        if (pParser->pPlan == NULL && !JSON_parserCompile(hDoc))
+            return false;
+    }
+
+    if (mode == JSON_DECODE_SAX) {
+        if (pParser->pSaxDecoder == NULL)
+            pParser->pSaxDecoder = new JsonSaxDecoder();
+    }
+
+    // the binary struct may have been written in another mode, the next message is decoded in full
+    if (mode == JSON_DECODE_INCREMENTAL) {
+        if (pParser->pIncrementalDecoder == NULL)
+            pParser->pIncrementalDecoder = new JsonIncrementalDecoder();
+        else
+            pParser->pIncrementalDecoder->Invalidate();
+    }
+
+    pParser->decodeMode = mode;
+
+    return true;
+}
+
+bool JSON_parserSetDecodeCache(ParserHandle hDoc, size_t byteCapacity) {
+
+    assert(hDoc != NULL);
+
+    RW_Parser* pParser = (RW_Parser*)hDoc;
+
+    if (byteCapacity == 0) {
+        if (pParser->pDecodeCache)
+            delete pParser->pDecodeCache;
+
+        pParser->pDecodeCache = NULL;
+        return true;
+    }
+
+    // an image is what the decode wrote for the members of the plan
+    if (pParser->pPlan == NULL && !JSON_parserCompile(hDoc))
+        return false;
+
+    if (pParser->pDecodeCache)
+        pParser->pDecodeCache->SetCapacity(byteCapacity);
+    else
+        pParser->pDecodeCache = new JsonDecodeCache(byteCapacity);
+
+    return true;
+}
+
+bool JSON_parserGetDecodeCacheStats(ParserHandle hDoc, JsonDecodeCacheStats* pStats) {
+
+    assert(hDoc != NULL);
+
+    JsonDecodeCache* pCache = ((RW_Parser*)hDoc)->pDecodeCache;
+
+    if (pCache == NULL || pStats == NULL)
+        return false;
+
+    pCache->GetStats(*pStats);
+
+    return true;
+}
+
+bool JSON_parserSetEncodeMode(ParserHandle hDoc, JsonEncodeMode mode) {
+
+    assert(hDoc != NULL);
+
+    RW_Parser* pParser = (RW_Parser*)hDoc;
+
+    // the template is part of the compiled plan
+    if ((mode == JSON_ENCODE_TEMPLATE || mode == JSON_ENCODE_DELTA) && pParser->pPlan == NULL && !JSON_parserCompile(hDoc))
+        return false;
+
+    // the receiver may have missed the texts of another mode, the next delta text is a full one
+    if (mode == JSON_ENCODE_DELTA)
+        pParser->deltaValid = false;
+
+    pParser->encodeMode = mode;
+
+    return true;
+}
+
+bool JSON_parserSetDeltaInterval(ParserHandle hDoc, uint32_t interval) {
+
+    assert(hDoc != NULL);
+
+    ((RW_Parser*)hDoc)->deltaInterval = interval;
+
+    return true;
+}
+
+void JSON_parserForceFullText(ParserHandle hDoc) {
+
+    assert(hDoc != NULL);
+
+    ((RW_Parser*)hDoc)->deltaValid = false;
+}
+
+// in situ (a local reader does, it never needs its stack) or from a read-only text (parseFlags)
+template<unsigned parseFlags, typename Stream>
+static uint32_t SaxTextToBin(RW_Parser* pParser, Reader& reader, Stream& stream, unsigned char* binBuffer) {
+
+    pParser->pSaxDecoder->Reset(pParser->pPlan, binBuffer, &pParser->errorSink, &stream.src_);
+
+    reader.Parse<parseFlags>(stream, *(pParser->pSaxDecoder));
+
+    if (reader.HasParseError()) {
+        // a decoding error stops the reader, too
+        uint32_t returnCode = pParser->pSaxDecoder->GetReturnCode();
+        if (returnCode != 0 && returnCode != 3)
+            return returnCode;
+
+        pParser->errorSink.Report(10, JSON_ERROR_PARSE, -1, NULL, -1, (uint32_t)reader.GetErrorOffset());
+        return 10;
+    }
+
+    return pParser->pSaxDecoder->GetReturnCode();
+}
+
+
+/*
+	// diagnostic output to check table-to-map-conversion
+	for (auto& object : g_jsonObjectMapping) {
+
+		std::cout << "\tDescription for object: " << object.first << std::endl;
+
+		for (auto& member : object.second) {
+			std::cout << "\tMember: " << member.first << std::endl;
+			std::cout << "\t\tDatatype: " << member.second.jsonDataType << std::endl;
+			std::cout << "\t\tOffset to Struct: " << member.second.offsetInBinaryStruct << std::endl;
+			std::cout << "\t\tSize: " << member.second.sizeInBinaryStruct << std::endl;
+		}
+
+	}
+*/
+
+// 2. the parsed document to binary data
+static uint32_t DomTextToBin(RW_Parser* pParser, unsigned char* binBuffer, uint32_t binBufferSize) {
+
+    MyDocument* pDoc = pParser->pDocument;
+
+    // a compiled interpreter needs neither string hashing nor map lookups
+    if (pParser->pPlan) {
+        const JsonPlan& plan = *(pParser->pPlan);
+        std::vector<uint32_t>& memberPositions = pParser->memberPositions;
+
+        // only guesses, whatever is left from an earlier plan is corrected by the first message
+        if (memberPositions.size() != plan.memberCount)
+            memberPositions.assign(plan.memberCount, JSON_CURSOR_NO_POSITION);
+
+        return PlanInterpret(plan, plan.rootObject, *pDoc, binBuffer, pParser->decodeMode == JSON_DECODE_DOM_SINGLEPASS,
+                             memberPositions.data(), pParser->errorSink);
+    }
+
+    // Do a standard interpretation, pass the GenericDocument as the GenericValue
+    // (1st param, a GenercDocument is derived from GenericValue)
+    return RecurseInterpret(*pDoc,
+                            pParser->pInterpreter,
+                            InterpreterObject(pParser->pInterpreter, ""),
+                            binBuffer,
+                            binBufferSize,
+                            pParser->errorSink);
+}
+
+// the decode cache, if the handle has one and it can be used in its mode
+static JsonDecodeCache* DecodeCache(RW_Parser* pParser) {
+    if (pParser->pDecodeCache == NULL || pParser->pPlan == NULL || pParser->decodeMode == JSON_DECODE_INCREMENTAL)
+        return NULL;
+
+    return pParser->pDecodeCache;
+}
+
+static uint32_t InsituTextToBin(ParserHandle hDoc, char* jsonString, unsigned char* binBuffer, uint32_t binBufferSize) {
+
+    JsonErrorSink& sink = ((RW_Parser*)hDoc)->errorSink;
+
+    MyDocument* pDoc = ((RW_Parser*)hDoc)->pDocument;
+
+    // without a DOM the text is decoded while it is tokenized
+    // (registering an object drops the plan, then there's only the DOM left)
+    if (((RW_Parser*)hDoc)->decodeMode == JSON_DECODE_SAX && ((RW_Parser*)hDoc)->pPlan) {
+        Reader reader;
+        JsonInsituStream stream(jsonString);
+
+        return SaxTextToBin<kParseInsituFlag>((RW_Parser*)hDoc, reader, stream, binBuffer);
+    }
+
+    // only what changed since the last message
+    if (((RW_Parser*)hDoc)->decodeMode == JSON_DECODE_INCREMENTAL && ((RW_Parser*)hDoc)->pPlan)
+        return ((RW_Parser*)hDoc)->pIncrementalDecoder->Decode(((RW_Parser*)hDoc)->pPlan, jsonString, binBuffer, &sink);
+
+    // 1. Parse a JSON string into DOM.
+    bool bResult = JSON_parse(hDoc, jsonString);
+    if (!bResult) {
+        sink.Report(10, JSON_ERROR_PARSE, -1, NULL, -1, (uint32_t)pDoc->GetErrorOffset());
+        return 10;
+    }
+
+    return DomTextToBin((RW_Parser*)hDoc, binBuffer, binBufferSize);
+}
+
+uint32_t JSON_TextToBin(ParserHandle hDoc, char* jsonString, unsigned char* binBuffer, uint32_t binBufferSize, JsonErrorInfo* pError) {
+
+    assert(hDoc != NULL);
+
+    RW_Parser* pParser = (RW_Parser*)hDoc;
+
+    // no I/O from here on, faults are recorded and logged by a background thread
+    JsonErrorSink& sink = pParser->errorSink;
+    sink.Begin(jsonString, pError);
+
+    // a retransmission: what the decode of the same text wrote
+    JsonDecodeCache* pCache = DecodeCache(pParser);
+
+    if (pCache && pCache->Lookup(pParser->pPlan, jsonString, strlen(jsonString), binBuffer, binBufferSize))
+        return 0;
+
+    uint32_t returnCode = InsituTextToBin(hDoc, jsonString, binBuffer, binBufferSize);
+
+    if (pCache && returnCode == 0 && sink.GetFaultCount() == 0)
+        pCache->Insert(pParser->pPlan, binBuffer);
+
+    return returnCode;
+}
+
+static uint32_t SpanTextToBin(RW_Parser* pParser, const char* text, size_t length, unsigned char* binBuffer, uint32_t binBufferSize) {
+
+    JsonErrorSink& sink = pParser->errorSink;
+
+    // reads up to length, never writes (it takes a 0 for the end, too)
+    MemoryStream stream(text, length);
+
+    if ((pParser->decodeMode == JSON_DECODE_SAX || pParser->decodeMode == JSON_DECODE_INCREMENTAL) && pParser->pPlan) {
+        // the incremental decoder needs the text in situ, the message is decoded in full
+        if (pParser->pIncrementalDecoder)
+            pParser->pIncrementalDecoder->Invalidate();
+
+        if (pParser->pSaxDecoder == NULL)
+            pParser->pSaxDecoder = new JsonSaxDecoder();
+
+        if (pParser->pSpanReader == NULL)
+            pParser->pSpanReader = new Reader();
+
+        return SaxTextToBin<kParseDefaultFlags>(pParser, *(pParser->pSpanReader), stream, binBuffer);
+    }
+
+    // the strings of the DOM are copied to the arena
+    if (!ParseDocument<kParseDefaultFlags>(pParser, stream)) {
+        sink.Report(10, JSON_ERROR_PARSE, -1, NULL, -1, (uint32_t)pParser->pDocument->GetErrorOffset());
+        return 10;
+    }
+
+    return DomTextToBin(pParser, binBuffer, binBufferSize);
+}
+
+uint32_t JSON_TextToBinN(ParserHandle hDoc, const char* text, size_t length, unsigned char* binBuffer, uint32_t binBufferSize,
+                         JsonErrorInfo* pError) {
+
+    assert(hDoc != NULL);
+
+    RW_Parser* pParser = (RW_Parser*)hDoc;
+
+    JsonErrorSink& sink = pParser->errorSink;
+    sink.Begin(text, pError, text + length);
+
+    JsonDecodeCache* pCache = DecodeCache(pParser);
+
+    if (pCache && pCache->Lookup(pParser->pPlan, text, length, binBuffer, binBufferSize))
+        return 0;
+
+    uint32_t returnCode = SpanTextToBin(pParser, text, length, binBuffer, binBufferSize);
+
+    if (pCache && returnCode == 0 && sink.GetFaultCount() == 0)
+        pCache->Insert(pParser->pPlan, binBuffer);
+
+    return returnCode;
+}
+
+// JSON_TextToBinFrame: how a message of the frame ended
+enum FrameMessage {FRAME_DECODED, FRAME_CUT_OFF, FRAME_INVALID};
+
+// the message at the position of stream, the stream is left behind it
+static FrameMessage FrameTextToBin(RW_Parser* pParser, MemoryStream& stream, unsigned char* binBuffer, uint32_t binBufferSize,
+                                   uint32_t& returnCode) {
+
+    JsonErrorSink& sink = pParser->errorSink;
+    const char* pMessage = stream.src_;
+
+    if ((pParser->decodeMode == JSON_DECODE_SAX || pParser->decodeMode == JSON_DECODE_INCREMENTAL) && pParser->pPlan) {
+        Reader& reader = *(pParser->pSpanReader);
+
+        pParser->pSaxDecoder->Reset(pParser->pPlan, binBuffer, &sink, &stream.src_);
+
+        reader.Parse<kParseStopWhenDoneFlag>(stream, *(pParser->pSaxDecoder));
+
+        returnCode = pParser->pSaxDecoder->GetReturnCode();
+
+        if (!reader.HasParseError())
+            return FRAME_DECODED;
+
+        // a decoding error stops the reader within the message, its end is found by parsing it once more
+        if (returnCode != 0 && returnCode != 3) {
+            BaseReaderHandler<> skipHandler;
+
+            stream.src_ = pMessage;
+            reader.Parse<kParseStopWhenDoneFlag>(stream, skipHandler);
+
+            if (!reader.HasParseError())
+                return FRAME_DECODED;
+        }
+
+        // the reader ran into the end of the frame, the rest comes with the next one
+        if (stream.src_ == stream.end_ || reader.GetErrorOffset() >= stream.size_)
+            return FRAME_CUT_OFF;
+
+        returnCode = 10;
+        sink.Report(10, JSON_ERROR_PARSE, -1, NULL, -1, (uint32_t)reader.GetErrorOffset());
+        return FRAME_INVALID;
+    }
+
+    if (!ParseDocument<kParseStopWhenDoneFlag>(pParser, stream)) {
+        if (stream.src_ == stream.end_ || pParser->pDocument->GetErrorOffset() >= stream.size_)
+            return FRAME_CUT_OFF;
+
+        returnCode = 10;
+        sink.Report(10, JSON_ERROR_PARSE, -1, NULL, -1, (uint32_t)pParser->pDocument->GetErrorOffset());
+        return FRAME_INVALID;
+    }
+
+    returnCode = DomTextToBin(pParser, binBuffer, binBufferSize);
+    return FRAME_DECODED;
+}
+
+size_t JSON_TextToBinFrame(ParserHandle hDoc, const char* text, size_t length, unsigned char* bins, size_t stride,
+                           size_t capacity, uint32_t* results, size_t* pConsumed) {
+
+    assert(hDoc != NULL);
+    assert(capacity == 0 || (bins != NULL && results != NULL));
+
+    RW_Parser* pParser = (RW_Parser*)hDoc;
+
+    // one stream for the whole frame, offsets are frame offsets
+    MemoryStream stream(text, length);
+    const char* pEnd = text + length;
+    size_t count = 0;
+
+    // the bins of a frame have nothing to compare with, the incremental decoder's fingerprints are stale afterwards
+    if (pParser->pIncrementalDecoder)
+        pParser->pIncrementalDecoder->Invalidate();
+
+    if (pParser->pPlan) {
+        if (pParser->pSaxDecoder == NULL)
+            pParser->pSaxDecoder = new JsonSaxDecoder();
+
+        if (pParser->pSpanReader == NULL)
+            pParser->pSpanReader = new Reader();
+    }
+
+    *pConsumed = 0;
+
+    while (count < capacity) {
+        while (stream.src_ != pEnd && (*stream.src_ == ' ' || *stream.src_ == '\n' || *stream.src_ == '\r' || *stream.src_ == '\t'))
+            stream.src_++;
+
+        // trailing whitespace is taken, too
+        if (stream.src_ == pEnd) {
+            *pConsumed = length;
+            break;
+        }
+
+        pParser->errorSink.Begin(text, NULL, pEnd);
+
+        FrameMessage message = FrameTextToBin(pParser, stream, bins + count * stride, (uint32_t)stride, results[count]);
+
+        if (message == FRAME_CUT_OFF)
+            break;
+
+        count++;
+
+        if (message == FRAME_INVALID) {
+            *pConsumed = length;
+            break;
+        }
+
+        *pConsumed = (size_t)(stream.src_ - text);
+    }
+
+    return count;
+}
+
+size_t JSON_getWrittenRanges(ParserHandle hDoc, JsonBinRange* ranges, size_t rangeCapacity) {
+
+    assert(hDoc != NULL);
+
+    JsonIncrementalDecoder* pIncrementalDecoder = ((RW_Parser*)hDoc)->pIncrementalDecoder;
+
+    if (pIncrementalDecoder == NULL)
+        return 0;
+
+    const std::vector<JsonBinRange>& writtenRanges = pIncrementalDecoder->GetWrittenRanges();
+
+    if (ranges)
+        memcpy(ranges, writtenRanges.data(), std::min(rangeCapacity, writtenRanges.size()) * sizeof(JsonBinRange));
+
+    return writtenRanges.size();
+}
+
+bool JSON_parserSetBatchThreads(ParserHandle hDoc, unsigned int threadCount) {
+
+    assert(hDoc != NULL);
+
+    RW_Parser* pParser = (RW_Parser*)hDoc;
+
+    DeleteBatchThreads(pParser);
+
+    pParser->pThreadPool = new JsonThreadPool(threadCount);
+
+    // the calling thread works with hDoc itself
+    for (unsigned int threadIdx = 1; threadIdx < pParser->pThreadPool->GetThreadCount(); threadIdx++) {
+        RW_Parser* pBatchParser = NewParser();
+
+        pBatchParser->pInterpreter = NULL;
+        pBatchParser->interpreterAllocated = false;
+        pParser->batchParsers.push_back(pBatchParser);
+    }
+
+    return true;
+}
+
+size_t JSON_TextToBinBatch(ParserHandle hDoc, const char* const* texts, const size_t* lengths, unsigned char* bins, size_t stride,
+                           size_t count, uint32_t* results) {
+
+    assert(hDoc != NULL);
+    assert(count == 0 || (texts != NULL && bins != NULL && results != NULL));
+
+    RW_Parser* pParser = (RW_Parser*)hDoc;
+
+    // the threads share the compiled plan, it's read only (the interpreter map is not:
+    // looking up a member with operator[] may insert it)
+    if (pParser->pPlan == NULL && !JSON_parserCompile(hDoc)) {
+        for (size_t idx = 0; idx < count; idx++)
+            results[idx] = 1;
+        return count;
+    }
+
+    if (pParser->pThreadPool == NULL)
+        JSON_parserSetBatchThreads(hDoc, 0);
+
+    // the plan may have been recompiled since the last batch
+    // (the messages of a batch go to bins of their own, there's nothing to compare with: incremental is SAX there)
+    for (RW_Parser* pBatchParser : pParser->batchParsers) {
+        pBatchParser->pInterpreter = pParser->pInterpreter;
+        pBatchParser->pPlan = pParser->pPlan;
+
+        JSON_parserSetDecodeMode(pBatchParser, pParser->decodeMode == JSON_DECODE_INCREMENTAL ? JSON_DECODE_SAX : pParser->decodeMode);
+    }
+
+    // the calling thread decodes in its own mode, a bin it wrote in an earlier batch may have been written by another thread since
+    if (pParser->pIncrementalDecoder)
+        pParser->pIncrementalDecoder->Invalidate();
+
+    // the messages are handed out one by one, a long one doesn't hold up the others
+    std::atomic<size_t> nextMessage(0);
+    std::atomic<size_t> failedMessages(0);
+
+    pParser->pThreadPool->Run([&](unsigned int threadIdx) {
+        RW_Parser* pThreadParser = threadIdx == 0 ? pParser : pParser->batchParsers[threadIdx - 1];
+        size_t failed = 0;
+
+        for (;;) {
+            size_t idx = nextMessage.fetch_add(1, std::memory_order_relaxed);
+            if (idx >= count)
+                break;
+
+            // straight from the caller's text, it is only read
+            size_t length = lengths ? lengths[idx] : strlen(texts[idx]);
+
+            results[idx] = JSON_TextToBinN(pThreadParser, texts[idx], length, bins + idx * stride, (uint32_t)stride);
+
+            if (results[idx] != 0)
+                failed++;
+        }
+
+        failedMessages.fetch_add(failed, std::memory_order_relaxed);
+    });
+
+    return failedMessages.load(std::memory_order_relaxed);
+}
+
+// JSON_ENCODE_DELTA: a merge patch against the last text, or the whole struct when a full text is due
+static uint32_t DeltaBinToText(RW_Parser* pParser, unsigned char* binBuffer, StringBuffer& out, JsonErrorSink& sink) {
+    const JsonPlan& plan = *(pParser->pPlan);
+
+    bool full = !pParser->deltaValid || (pParser->deltaInterval != 0 && pParser->deltaCount + 1 >= pParser->deltaInterval);
+
+    // the bytes the text depends on, arrays up to their element count
+    uint32_t extent = PlanExtent(plan, plan.rootObject, binBuffer);
+
+    // grows with the arrays only, bytes the snapshot didn't hold before aren't compared
+    // (an array whose count changed goes out in full)
+    if (pParser->deltaSnapshot.size() < extent)
+        pParser->deltaSnapshot.resize(extent);
+
+    uint32_t returnCode = full ? PlanWrite(plan, plan.rootObject, binBuffer, out, sink)
+                          : PlanWriteDelta(plan, plan.rootObject, binBuffer, pParser->deltaSnapshot.data(), out, sink);
+
+    // the text is incomplete, nobody knows what the receiver got
+    if (returnCode != 0) {
+        pParser->deltaValid = false;
+        return returnCode;
+    }
+
+    memcpy(pParser->deltaSnapshot.data(), binBuffer, extent);
+
+    pParser->deltaValid = true;
+    pParser->deltaCount = full ? 0 : pParser->deltaCount + 1;
+
+    return 0;
+}
+
+uint32_t JSON_BinToText(ParserHandle hDoc, unsigned char* binBuffer, JsonErrorInfo* pError) {
+
+    assert(hDoc != NULL);
+
+    // there's no JSON text the errors could point into
+    JsonErrorSink& sink = ((RW_Parser*)hDoc)->errorSink;
+    sink.Begin(NULL, pError);
+
+    // an interpreter image has no interpreter to build a DOM with, the template has the same members (in struct order)
+    bool planOnly = ((RW_Parser*)hDoc)->pFrozen && ((RW_Parser*)hDoc)->pFrozen->fromImage;
+
+    // straight into the output buffer, no DOM
+    // (registering an object drops the plan, then there's only the DOM left)
+    if ((((RW_Parser*)hDoc)->encodeMode == JSON_ENCODE_TEMPLATE || ((RW_Parser*)hDoc)->encodeMode == JSON_ENCODE_DELTA || planOnly)
+            && ((RW_Parser*)hDoc)->pPlan) {
+        const JsonPlan& plan = *(((RW_Parser*)hDoc)->pPlan);
+        StringBuffer& out = *(((RW_Parser*)hDoc)->pBuffer);
+
+        out.Clear();
+        ((RW_Parser*)hDoc)->outputRendered = true;
+
+        if (((RW_Parser*)hDoc)->encodeMode == JSON_ENCODE_DELTA)
+            return DeltaBinToText((RW_Parser*)hDoc, binBuffer, out, sink);
+
+        return PlanWrite(plan, plan.rootObject, binBuffer, out, sink);
+    }
+
+    ((RW_Parser*)hDoc)->outputRendered = false;
+
+    // cast to pInterpreter
+    std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >* pInterpreter = (((RW_Parser*)hDoc)->pInterpreter);
+
+    // reuse the same document that may have been used for parsing
+    // in any case the output string is created new from scratch
+    MyDocument* pDoc = ((RW_Parser*)hDoc)->pDocument;
+
+    // so is the memory of the document
+    pDoc->SetNull();
+    ((RW_Parser*)hDoc)->pAllocator->Reset();
+
+    // initially the document is an empty object ...
+    pDoc->SetObject();
 
     // ... that gets filled recursively
 
-    // Do a standard writing, pass the GenericDocument as the GenericValue
-    // (2nd param, a GenercDocument is derived from GenericValue)
-    // (for writing an allocator is needed, too)
-    uint32_t retval = RecurseWrite(
-                          pDoc->GetAllocator(),
-                          *pDoc,
-                          pInterpreter,
-                          (*pInterpreter)[""],
-                          binBuffer);
+    // Do a standard writing, pass the GenericDocument as the GenericValue
+    // (2nd param, a GenercDocument is derived from GenericValue)
+    // (for writing an allocator is needed, too)
+    uint32_t retval = RecurseWrite(
+                          pDoc->GetAllocator(),
+                          *pDoc,
+                          pInterpreter,
+                          InterpreterObject(pInterpreter, ""),
+                          binBuffer,
+                          sink);
+
+    return retval;
+}
+
+uint32_t RecurseInterpret(GenericValue<UTF8<char>, MyAllocator>& jsonObject, const std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >* pInterpreter, const std::unordered_map<std::string, JsonBinaryStructMapInfo>& jsonObjectMapping,
+                          unsigned char* binBuffer, uint32_t, JsonErrorSink& sink) {
+
+
+    uint32_t returnCode = 0;
+
+    JsonMemberCursor<MyValue> cursor(jsonObject);
+
+    // iterate over the member description array
+    for (auto& member : jsonObjectMapping) {
+
+        const char* memberName = member.first.c_str();
+
+        // does the member exist?
+        MyValue::MemberIterator itMember = cursor.Find(memberName, (uint32_t)member.first.size());
+        if (itMember == cursor.End()) {
+            sink.Report(1, JSON_ERROR_NOT_FOUND, member.second.jsonDataType, memberName, -1, JSON_ERROR_NO_OFFSET);
+            return 1;
+        }
+
+        MyValue& value = itMember->value;
+
+        // if it is of the expected type extract it
+        switch (member.second.jsonDataType) {
+        case JSON_STRING:
+            if (!value.IsString()) {
+                sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_STRING, memberName, -1, sink.Offset(itMember->name.GetString() - 1));
+                return 2; // wrong type
+            }
+
+            {
+                const char* string = value.GetString();
+
+                SizeType strLength = value.GetStringLength();
+
+                if (strLength > member.second.sizeInBinaryStruct-1) {
+                    sink.Report(3, JSON_ERROR_STRING_TRUNCATED, JSON_STRING, memberName, -1, sink.Offset(itMember->name.GetString() - 1));
+                    returnCode = 3; // string truncated
+
+                    // truncate stringLength
+                    strLength = member.second.sizeInBinaryStruct-1;
+                }
+
+                char* destStr = (char*)binBuffer + member.second.offsetInBinaryStruct;
+                strncpy(destStr, string, strLength);
+                //set terminating 0
+                destStr[strLength] = (char)0;
+
+            }
+            break;
+
+        case JSON_INT:
+            if (!value.IsInt()) {
+                sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_INT, memberName, -1, sink.Offset(itMember->name.GetString() - 1));
+                return 2; // wrong type
+            }
+
+            {
+                int32_t* pInt = (int32_t*)(binBuffer + member.second.offsetInBinaryStruct);
+
+                *pInt = value.GetInt();
+            }
+            break;
+
+        case JSON_UINT:
+            if (!value.IsUint()) {
+                sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_UINT, memberName, -1, sink.Offset(itMember->name.GetString() - 1));
+                return 2; // wrong type
+            }
+
+            {
+                uint32_t* pUint = (uint32_t*)(binBuffer + member.second.offsetInBinaryStruct);
+
+                *pUint = value.GetUint();
+            }
+            break;
+
+        case JSON_DOUBLE:
+            if (!value.IsDouble()) {
+                sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_DOUBLE, memberName, -1, sink.Offset(itMember->name.GetString() - 1));
+                return 2; // wrong type
+            }
+
+            {
+                double* pDouble = (double*)(binBuffer + member.second.offsetInBinaryStruct);
+
+                *pDouble = value.GetDouble();
+            }
+            break;
+
+        case JSON_BOOL:
+            if (!value.IsBool()) {
+                sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_BOOL, memberName, -1, sink.Offset(itMember->name.GetString() - 1));
+                return 2; // wrong type
+            }
+
+            {
+                char* pIecBool = (char*)(binBuffer + member.second.offsetInBinaryStruct);
+
+                if (value.GetBool())
+                    *pIecBool = 1;
+                else
+                    *pIecBool = 0;
+            }
+            break;
+
+        case JSON_OBJECT:
+            if (!value.IsObject()) {
+                sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_OBJECT, memberName, -1, sink.Offset(itMember->name.GetString() - 1));
+                return 2; // wrong type
+            }
+
+            // no size check for an object, this is done for each object member
+
+            sink.Push(memberName);
+            returnCode = RecurseInterpret(value,
+                                          pInterpreter,
+                                          InterpreterObject(pInterpreter, memberName),
+                                          binBuffer + member.second.offsetInBinaryStruct,
+                                          member.second.sizeInBinaryStruct,
+                                          sink);
+            sink.Pop();
+
+            if (returnCode != 0)
+                return returnCode;
+
+            break;
+
+        case JSON_STRINGARRAY:
+        case JSON_INTARRAY:
+        case JSON_UINTARRAY:
+        case JSON_DOUBLEARRAY:
+        case JSON_BOOLARRAY:
+        case JSON_OBJECTARRAY:
+            if (!value.IsArray()) {
+                sink.Report(2, JSON_ERROR_WRONG_TYPE, member.second.jsonDataType, memberName, -1, sink.Offset(itMember->name.GetString() - 1));
+                return 2; // wrong type
+            }
+
+
+            {
+                SizeType jsonArraySize = value.Size();
+                // write UsedArraySize to a required 'int' just before the array
+
+                int32_t* pInt = (int32_t*)(binBuffer + member.second.offsetInBinaryStruct - sizeof(int));
+
+                SizeType maxArraySize = *pInt;
+
+                // limit the arraysize to the maximum
+                if (maxArraySize < jsonArraySize) {
+                    sink.Report(0, JSON_ERROR_ARRAY_CLIPPED, member.second.jsonDataType, memberName, -1, sink.Offset(itMember->name.GetString() - 1), maxArraySize, jsonArraySize);
+                    jsonArraySize = maxArraySize;
+                }
+
+                *pInt = jsonArraySize;
+
+                switch (member.second.jsonDataType) {
+
+                case JSON_STRINGARRAY:
+                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+
+                        if (!(value[arrayIdx]).IsString()) {
+                            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_STRING, memberName, arrayIdx, sink.Offset(itMember->name.GetString() - 1));
+                            return 2; // wrong type
+                        }
+
+                        {
+                            const char* string = (value[arrayIdx]).GetString();
+
+                            SizeType strLength = (value[arrayIdx]).GetStringLength();
+
+                            if (strLength > member.second.sizeInBinaryStruct-1) {
+                                sink.Report(3, JSON_ERROR_STRING_TRUNCATED, JSON_STRING, memberName, arrayIdx, sink.Offset(itMember->name.GetString() - 1));
+                                returnCode = 3; // string truncated
+
+                                // truncate stringLength
+                                strLength = member.second.sizeInBinaryStruct-1;
+                            }
+
+                            char* destStr = (char*)binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct;
+                            strncpy(destStr, string, strLength);
+                            //set terminating 0
+                            destStr[strLength] = (char)0;
+                        }
+
+                    }
+                    break;
+
+                case JSON_INTARRAY:
+                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+                        if (!(value[arrayIdx]).IsInt()) {
+                            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_INT, memberName, arrayIdx, sink.Offset(itMember->name.GetString() - 1));
+                            return 2; // wrong type
+                        }
+
+                        int32_t* pInt = (int32_t*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
+                        *pInt = (value[arrayIdx]).GetInt();
+                    }
+                    break;
+
+                case JSON_UINTARRAY:
+                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+                        if (!(value[arrayIdx]).IsUint()) {
+                            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_UINT, memberName, arrayIdx, sink.Offset(itMember->name.GetString() - 1));
+                            return 2; // wrong type
+                        }
+
+                        uint32_t* pUint = (uint32_t*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
+                        *pUint = (value[arrayIdx]).GetUint();
+                    }
+                    break;
+
+                case JSON_DOUBLEARRAY:
+                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+                        if (!(value[arrayIdx]).IsDouble()) {
+                            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_DOUBLE, memberName, arrayIdx, sink.Offset(itMember->name.GetString() - 1));
+                            return 2; // wrong type
+                        }
+
+                        double* pDouble = (double*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
+                        *pDouble = (value[arrayIdx]).GetDouble();
+                    }
+                    break;
+
+                case JSON_BOOLARRAY:
+                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+                        if (!(value[arrayIdx]).IsBool()) {
+                            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_BOOL, memberName, arrayIdx, sink.Offset(itMember->name.GetString() - 1));
+                            return 2; // wrong type
+                        }
+
+                        char* pIecBool = (char*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
+
+                        if ((value[arrayIdx]).GetBool())
+                            *pIecBool = 1;
+                        else
+                            *pIecBool = 0;
+                    }
+                    break;
+
+                case JSON_OBJECTARRAY:
+                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+                        if (!(value[arrayIdx]).IsObject()) {
+                            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_OBJECT, memberName, arrayIdx, sink.Offset(itMember->name.GetString() - 1));
+                            return 2; // wrong type
+                        }
+
+                        sink.Push(memberName);
+                        sink.PushIndex(arrayIdx);
+                        returnCode = RecurseInterpret(value[arrayIdx],
+                                                      pInterpreter,
+                                                      InterpreterObject(pInterpreter, memberName),
+                                                      binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct,
+                                                      member.second.sizeInBinaryStruct,
+                                                      sink);
+                        sink.Pop();
+                        sink.Pop();
+
+                        if (returnCode != 0)
+                            return returnCode;
+                    }
+                    break;
+
+                default:
+                    break;	// only to avoid the not-handled-in-switch warning
+                }
+            }
+
+            break;
+
+        default:
+            sink.Report(5, JSON_ERROR_UNKNOWN_TYPE, member.second.jsonDataType, memberName, -1, JSON_ERROR_NO_OFFSET);
+            return 5; // unknown object - TODO: for all error returns check if continuation is possible / makes sense
+            break;
+        }
+    }
+
+    return returnCode;
+}
+
+uint32_t RecurseWrite(MyAllocator& myAlloc, GenericValue<UTF8<char>, MyAllocator>& jsonObject, const std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >* pInterpreter, const std::unordered_map<std::string, JsonBinaryStructMapInfo>& jsonObjectMapping,
+                      unsigned char* binBuffer, JsonErrorSink& sink) {
+
+    uint32_t returnCode = 0;
+
+    // iterate over the member description array
+    for (auto& member : jsonObjectMapping) {
+
+        const char* memberName = member.first.c_str();
+
+        MyValue newJsonValue;
+
+        // if it is of the expected type extract it
+        switch (member.second.jsonDataType) {
+        case JSON_STRING: {
+            const char* string = (char*)binBuffer + member.second.offsetInBinaryStruct;
+
+            newJsonValue.SetString((char*)string, strlen(string));
+        }
+        break;
+
+        case JSON_INT: {
+            int32_t* pInt = (int32_t*)(binBuffer + member.second.offsetInBinaryStruct);
+
+            newJsonValue.SetInt(*pInt);
+        }
+        break;
+
+        case JSON_UINT: {
+            uint32_t* pUint = (uint32_t*)(binBuffer + member.second.offsetInBinaryStruct);
+
+            newJsonValue.SetUint(*pUint);
+        }
+        break;
+
+        case JSON_DOUBLE: {
+            double* pDouble = (double*)(binBuffer + member.second.offsetInBinaryStruct);
+
+            newJsonValue.SetDouble(*pDouble);
+        }
+        break;
+
+        case JSON_BOOL: {
+            char* pIecBool = (char*)(binBuffer + member.second.offsetInBinaryStruct);
+
+            if (*pIecBool)
+                newJsonValue.SetBool(true);
+            else
+                newJsonValue.SetBool(false);
+        }
+        break;
+
+        case JSON_OBJECT:
+            newJsonValue.SetObject();
+            sink.Push(memberName);
+            returnCode = RecurseWrite(
+                             myAlloc,
+                             newJsonValue,
+                             pInterpreter,
+                             InterpreterObject(pInterpreter, memberName),
+                             binBuffer + member.second.offsetInBinaryStruct,
+                             sink);
+            sink.Pop();
+
+            if (returnCode != 0)
+                return returnCode;
+
+            break;
+
+        case JSON_STRINGARRAY:
+        case JSON_INTARRAY:
+        case JSON_UINTARRAY:
+        case JSON_DOUBLEARRAY:
+        case JSON_BOOLARRAY:
+        case JSON_OBJECTARRAY:
+
+            newJsonValue.SetArray();
+
+            // get UsedArraySize from the 'int' (required) just before the array
+            {
+                int32_t* pInt = (int32_t*)(binBuffer + member.second.offsetInBinaryStruct - sizeof(int32_t));
+                SizeType jsonArraySize = *pInt;
+
+                switch (member.second.jsonDataType) {
+
+                case JSON_STRINGARRAY:
+                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+                        // the given size is the the size of a single array element
+                        const char* string = (char*)binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct;
+                        newJsonValue.PushBack(MyValue().SetString((char*)string, strlen(string)), myAlloc);
+                    }
+                    break;
+
+                case JSON_INTARRAY:
+                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+                        int32_t* pInt = (int32_t*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
+                        newJsonValue.PushBack(MyValue().SetInt(*pInt), myAlloc);
+                    }
+                    break;
+
+                case JSON_UINTARRAY:
+                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+                        uint32_t* pUint = (uint32_t*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
+                        newJsonValue.PushBack(MyValue().SetUint(*pUint), myAlloc);
+                    }
+                    break;
+
+                case JSON_DOUBLEARRAY:
+                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+                        double* pDouble = (double*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
+                        newJsonValue.PushBack(MyValue().SetDouble(*pDouble), myAlloc);
+                    }
+                    break;
+
+                case JSON_BOOLARRAY:
+                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+                        char* pIecBool = (char*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
+
+                        if (*pIecBool == 1)
+                            newJsonValue.PushBack(MyValue().SetBool(true), myAlloc);
+                        else
+                            newJsonValue.PushBack(MyValue().SetBool(false), myAlloc);
+                    }
+                    break;
+
+                case JSON_OBJECTARRAY:
+                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+                        MyValue myVal;
+                        myVal.SetObject();
 
-    return retval;
+                        sink.Push(memberName);
+                        sink.PushIndex(arrayIdx);
+                        returnCode = RecurseWrite(
+                                         myAlloc,
+                                         myVal,
+                                         pInterpreter,
+                                         InterpreterObject(pInterpreter, memberName),
+                                         binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct,
+                                         sink);
+                        sink.Pop();
+                        sink.Pop();
+
+                        newJsonValue.PushBack(myVal, myAlloc);
+
+                        if (returnCode != 0)
+                            return returnCode;
+                    }
+                    break;
+
+                default:
+                    break;	// only to avoid the not-handled-in-switch warning
+
+                }
+            }
+
+            break;
+
+        default:
+            sink.Report(5, JSON_ERROR_UNKNOWN_TYPE, member.second.jsonDataType, memberName, -1, JSON_ERROR_NO_OFFSET);
+            return 5; // unknown object - TODO: for all error returns check if continuation is possible / makes sense
+            break;
+        }
+
+        // add the member
+        MyValue& myVal = jsonObject.AddMember(GenericStringRef<char>(memberName), newJsonValue, myAlloc);
+        if (myVal.IsNull()) {
+            sink.Report(1, JSON_ERROR_NOT_ADDED, member.second.jsonDataType, memberName, -1, JSON_ERROR_NO_OFFSET);
+            return 1;
+        }
+
+    }
+
+    return returnCode;
+}
+
+// store a single scalar (or string) value at pDest, used for members and array elements alike
+static uint32_t PlanStoreValue(uint32_t dataType, uint32_t size, MyValue& value, unsigned char* pDest, const char* memberName, int arrayIdx,
+                               uint32_t offset, JsonErrorSink& sink) {
+    bool typeOk;
+
+    switch (dataType) {
+    case JSON_STRING:
+        typeOk = value.IsString();
+        break;
+    case JSON_INT:
+        typeOk = value.IsInt();
+        break;
+    case JSON_UINT:
+        typeOk = value.IsUint();
+        break;
+    case JSON_DOUBLE:
+        typeOk = value.IsDouble();
+        break;
+    case JSON_BOOL:
+        typeOk = value.IsBool();
+        break;
+    default:
+        typeOk = false;
+        break;
+    }
+
+    if (!typeOk) {
+        sink.Report(2, JSON_ERROR_WRONG_TYPE, dataType, memberName, arrayIdx, offset);
+        return 2; // wrong type
+    }
+
+    switch (dataType) {
+    case JSON_STRING: {
+        SizeType strLength = value.GetStringLength();
+        uint32_t returnCode = 0;
+
+        if (strLength > size-1) {
+            sink.Report(3, JSON_ERROR_STRING_TRUNCATED, JSON_STRING, memberName, arrayIdx, offset);
+            returnCode = 3; // string truncated
+
+            // truncate stringLength
+            strLength = size-1;
+        }
+
+        memcpy(pDest, value.GetString(), strLength);
+        //set terminating 0
+        pDest[strLength] = 0;
+
+        return returnCode;
+    }
+
+    case JSON_INT:
+        *(int32_t*)pDest = value.GetInt();
+        break;
+
+    case JSON_UINT:
+        *(uint32_t*)pDest = value.GetUint();
+        break;
+
+    case JSON_DOUBLE:
+        *(double*)pDest = value.GetDouble();
+        break;
+
+    case JSON_BOOL:
+        // in IEC the size of a CODESYS-BOOL is one byte
+        *(char*)pDest = value.GetBool() ? 1 : 0;
+        break;
+
+    default:
+        break;
+    }
+
+    return 0;
 }
 
-uint32_t RecurseInterpret(GenericValue<UTF8<char>, MyAllocator>& jsonObject, std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >* pInterpreter, std::unordered_map<std::string, JsonBinaryStructMapInfo>& jsonObjectMapping,
-                          unsigned char* binBuffer, uint32_t) {
+// interpret the value of a single member into the binary struct of its object
+// (offset is the position of the member's key in the JSON text)
+static uint32_t PlanInterpretMember(const JsonPlan& plan, const JsonPlanMember& member, MyValue& value, unsigned char* binBuffer, bool singlePass,
+                                    uint32_t* pPositions, uint32_t offset, JsonErrorSink& sink) {
 
+    const char* memberName = plan.name(member);
+    unsigned char* pDest = binBuffer + member.offsetInBinaryStruct;
 
     uint32_t returnCode = 0;
 
-    // iterate over the member description array
-    for (auto& member : jsonObjectMapping) {
+    switch (member.jsonDataType) {
+    // the sizes were checked with the interpreter (JSON_planCheck)
+    case JSON_INT:
+    case JSON_UINT:
+    case JSON_DOUBLE:
+    case JSON_BOOL:
+    case JSON_STRING: {
+        uint32_t storeCode = PlanStoreValue(member.jsonDataType, member.sizeInBinaryStruct, value, pDest, memberName, -1, offset, sink);
+
+        if (storeCode == 3)
+            returnCode = 3; // string truncated, go on with the next member
+        else if (storeCode != 0)
+            return storeCode;
+    }
+    break;
 
-        const char* memberName = member.first.c_str();
+    case JSON_OBJECT:
+        if (!value.IsObject()) {
+            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_OBJECT, memberName, -1, offset);
+            return 2; // wrong type
+        }
 
-        // does the member exist?
-        if (!jsonObject.HasMember(memberName)) {
-            // indicate error to console & logfile
-            std::cout << R"(JSON for PLC: ")" << memberName << R"(" not found.)" << std::endl;
-#if defined(OL91)
-            el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ not found.\n", memberName);
-#endif
-            return 1;
+        {
+            sink.Push(memberName);
+            uint32_t objectCode = PlanInterpret(plan, member.childObject, value, pDest, singlePass, pPositions, sink);
+            sink.Pop();
+
+            if (objectCode == 3)
+                returnCode = 3; // string truncated somewhere below, go on
+            else if (objectCode != 0)
+                return objectCode;
         }
+        break;
 
-        // if it is of the expected type extract it
-        switch (member.second.jsonDataType) {
-        case JSON_STRING:
-            if (!(jsonObject[memberName]).IsString()) {
-                // indicate error to console & logfile
-                std::cout << R"(JSON for PLC: ")" << memberName << R"(" is not a string.)" << std::endl;
-#if defined(OL91)
-                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ is not a string.\n", memberName);
-#endif
-                return 2; // wrong type
-            }
+    case JSON_STRINGARRAY:
+    case JSON_INTARRAY:
+    case JSON_UINTARRAY:
+    case JSON_DOUBLEARRAY:
+    case JSON_BOOLARRAY:
+    case JSON_OBJECTARRAY: {
+        if (!value.IsArray()) {
+            sink.Report(2, JSON_ERROR_WRONG_TYPE, member.jsonDataType, memberName, -1, offset);
+            return 2; // wrong type
+        }
 
-            {
-                const char* string = (jsonObject[memberName]).GetString();
+        SizeType jsonArraySize = value.Size();
 
-                SizeType strLength = (jsonObject[memberName]).GetStringLength();
+        // write UsedArraySize to a required 'int' just before the array
+        int32_t* pInt = (int32_t*)(pDest - sizeof(int32_t));
 
-                if (strLength > member.second.sizeInBinaryStruct-1) {
-                    // indicate error to console & logfile
-                    std::cout << R"(JSON for PLC: ")" << memberName << R"(" insufficient binSize for string -> truncated.)" << std::endl;
-#if defined(OL91)
-                    el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ insufficient binSize for string -> truncated.\n", memberName);
-#endif
-                    returnCode = 3; // string truncated
+        SizeType maxArraySize = *pInt;
 
-                    // truncate stringLength
-                    strLength = member.second.sizeInBinaryStruct-1;
-                }
+        // limit the arraysize to the maximum
+        if (maxArraySize < jsonArraySize) {
+            sink.Report(0, JSON_ERROR_ARRAY_CLIPPED, member.jsonDataType, memberName, -1, offset, maxArraySize, jsonArraySize);
+            jsonArraySize = maxArraySize;
+        }
 
-                char* destStr = (char*)binBuffer + member.second.offsetInBinaryStruct;
-                strncpy(destStr, string, strLength);
-                //set terminating 0
-                destStr[strLength] = (char)0;
+        *pInt = jsonArraySize;
 
-            }
-            break;
+        // the element type is the scalar type of the same order in JsonDataType
+        uint32_t elementType = member.jsonDataType - JSON_STRINGARRAY + JSON_STRING;
 
-        case JSON_INT:
-            if (!(jsonObject[memberName]).IsInt()) {
-                // indicate error to console & logfile
-                std::cout << R"(JSON for PLC: ")" << memberName << R"(" is not an int.)" << std::endl;
-#if defined(OL91)
-                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ is not an int.\n", memberName);
-#endif
-                return 2; // wrong type
-            }
+        for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+            MyValue& element = value[arrayIdx];
+            unsigned char* pElement = pDest + arrayIdx * member.sizeInBinaryStruct;
 
-            if (member.second.sizeInBinaryStruct < sizeof(int32_t)) {
-                // indicate error to console & logfile
-                std::cout << R"(JSON for PLC: ")" << memberName << R"(" insufficient binSize for dataType.)" << std::endl;
-#if defined(OL91)
-                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ insufficient binSize for dataType.\n", memberName);
-#endif
-                return 4; // insufficient binSize for dataType
-            }
+            if (elementType == JSON_OBJECT) {
+                if (!element.IsObject()) {
+                    sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_OBJECT, memberName, arrayIdx, offset);
+                    return 2; // wrong type
+                }
 
-            if (member.second.sizeInBinaryStruct > sizeof(int32_t)) {
-                // indicate error to console & logfile
-                std::cout << R"(JSON for PLC: ")" << memberName << R"(" too large binSize for dataType.)" << std::endl;
-#if defined(OL91)
-                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ too large binSize for dataType.\n", memberName);
-#endif
-                return 5; // too large binSize for dataType
+                sink.Push(memberName);
+                sink.PushIndex(arrayIdx);
+                uint32_t objectCode = PlanInterpret(plan, member.childObject, element, pElement, singlePass, pPositions, sink);
+                sink.Pop();
+                sink.Pop();
+
+                if (objectCode == 3)
+                    returnCode = 3; // string truncated somewhere below, go on
+                else if (objectCode != 0)
+                    return objectCode;
+            } else {
+                uint32_t storeCode = PlanStoreValue(elementType, member.sizeInBinaryStruct, element, pElement, memberName, arrayIdx, offset, sink);
+
+                if (storeCode == 3)
+                    returnCode = 3; // string truncated, go on with the next element
+                else if (storeCode != 0)
+                    return storeCode;
             }
+        }
+    }
+    break;
 
-            {
-                int32_t* pInt = (int32_t*)(binBuffer + member.second.offsetInBinaryStruct);
+    default:
+        sink.Report(5, JSON_ERROR_UNKNOWN_TYPE, member.jsonDataType, memberName, -1, JSON_ERROR_NO_OFFSET);
+        return 5; // unknown object
+    }
 
-                *pInt = (jsonObject[memberName]).GetInt();
-            }
-            break;
+    return returnCode;
+}
 
-        case JSON_UINT:
-            if (!(jsonObject[memberName]).IsUint()) {
-                // indicate error to console & logfile
-                std::cout << R"(JSON for PLC: ")" << memberName << R"(" is not a uint.)" << std::endl;
-#if defined(OL91)
-                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ is not a uint.\n", memberName);
-#endif
-                return 2; // wrong type
-            }
+// walk the JSON members once, resolving each key by the perfect hash of the plan
+// (unknown members are skipped, repeated ones are interpreted on their first occurrence only)
+static uint32_t PlanInterpretSinglePass(const JsonPlan& plan, uint32_t objectIdx, GenericValue<UTF8<char>, MyAllocator>& jsonObject, unsigned char* binBuffer,
+                                        uint32_t* pPositions, JsonErrorSink& sink) {
 
-            if (member.second.sizeInBinaryStruct < sizeof(uint32_t)) {
-                // indicate error to console & logfile
-                std::cout << R"(JSON for PLC: ")" << memberName << R"(" insufficient binSize for dataType.)" << std::endl;
-#if defined(OL91)
-                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ insufficient binSize for dataType.\n", memberName);
-#endif
-                return 4; // insufficient binSize for dataType
-            }
+    const JsonPlanObject& object = plan.object(objectIdx);
 
-            if (member.second.sizeInBinaryStruct > sizeof(uint32_t)) {
-                // indicate error to console & logfile
-                std::cout << R"(JSON for PLC: ")" << memberName << R"(" too large binSize for dataType.)" << std::endl;
-#if defined(OL91)
-                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ too large binSize for dataType.\n", memberName);
-#endif
-                return 5; // too large binSize for dataType
-            }
+    // one bit per member of the object, on the stack for all but huge objects
+    uint64_t seenWords[4];
+    std::vector<uint64_t> seenHeap;
 
-            {
-                uint32_t* pUint = (uint32_t*)(binBuffer + member.second.offsetInBinaryStruct);
+    uint32_t words = (object.memberCount + 63) / 64;
+    uint64_t* pSeen = seenWords;
 
-                *pUint = (jsonObject[memberName]).GetUint();
-            }
-            break;
+    if (words > sizeof(seenWords) / sizeof(seenWords[0])) {
+        seenHeap.resize(words);
+        pSeen = seenHeap.data();
+    }
 
-        case JSON_DOUBLE:
-            if (!(jsonObject[memberName]).IsDouble()) {
-                // indicate error to console & logfile
-                std::cout << R"(JSON for PLC: ")" << memberName << R"(" is not a double.)" << std::endl;
-#if defined(OL91)
-                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ is not a double.\n", memberName);
-#endif
-                return 2; // wrong type
-            }
+    memset(pSeen, 0, words * sizeof(uint64_t));
 
-            if (member.second.sizeInBinaryStruct < sizeof(double)) {
-                // indicate error to console & logfile
-                std::cout << R"(JSON for PLC: ")" << memberName << R"(" insufficient binSize for dataType.)" << std::endl;
-#if defined(OL91)
-                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ insufficient binSize for dataType.\n", memberName);
-#endif
-                return 4; // insufficient binSize for dataType
-            }
+    uint32_t returnCode = 0;
 
-            if (member.second.sizeInBinaryStruct > sizeof(double)) {
-                // indicate error to console & logfile
-                std::cout << R"(JSON for PLC: ")" << memberName << R"(" too large binSize for dataType.)" << std::endl;
-#if defined(OL91)
-                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ too large binSize for dataType.\n", memberName);
-#endif
-                return 5; // too large binSize for dataType
-            }
+    for (MyValue::MemberIterator it = jsonObject.MemberBegin(); it != jsonObject.MemberEnd(); ++it) {
 
-            {
-                double* pDouble = (double*)(binBuffer + member.second.offsetInBinaryStruct);
+        uint32_t idx = plan.findMember(objectIdx, it->name.GetString(), it->name.GetStringLength());
 
-                *pDouble = (jsonObject[memberName]).GetDouble();
-            }
-            break;
+        if (idx == JSON_PLAN_NO_MEMBER || (pSeen[idx / 64] & (1ull << (idx % 64))))
+            continue;
 
-        case JSON_BOOL:
-            if (!(jsonObject[memberName]).IsBool()) {
-                // indicate error to console & logfile
-                std::cout << R"(JSON for PLC: ")" << memberName << R"(" is not a bool.)" << std::endl;
-#if defined(OL91)
-                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ is not a bool.\n", memberName);
-#endif
-                return 2; // wrong type
-            }
+        pSeen[idx / 64] |= 1ull << (idx % 64);
 
-            // in IEC the size of a CODESYS-BOOL is one byte
-            if (member.second.sizeInBinaryStruct < sizeof(char)) {
-                // indicate error to console & logfile
-                std::cout << R"(JSON for PLC: ")" << memberName << R"(" insufficient binSize for dataType.)" << std::endl;
-#if defined(OL91)
-                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ insufficient binSize for dataType.\n", memberName);
-#endif
-                return 4; // insufficient binSize for dataType
-            }
+        uint32_t memberCode = PlanInterpretMember(plan, plan.member(object.firstMember + idx), it->value, binBuffer, true, pPositions,
+                                                  sink.Offset(it->name.GetString() - 1), sink);
 
-            if (member.second.sizeInBinaryStruct > sizeof(char)) {
-                // indicate error to console & logfile
-                std::cout << R"(JSON for PLC: ")" << memberName << R"(" too large binSize for dataType.)" << std::endl;
-#if defined(OL91)
-                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ too large binSize for dataType.\n", memberName);
-#endif
-                return 5; // too large binSize for dataType
-            }
+        if (memberCode == 3)
+            returnCode = 3; // string truncated, go on with the next member
+        else if (memberCode != 0)
+            return memberCode;
+    }
 
-            {
-                char* pIecBool = (char*)(binBuffer + member.second.offsetInBinaryStruct);
+    // every member of the interpreter has to be there
+    for (uint32_t idx = 0; idx < object.memberCount; idx++) {
+        if (!(pSeen[idx / 64] & (1ull << (idx % 64)))) {
+            const JsonPlanMember& member = plan.member(object.firstMember + idx);
 
-                if ((jsonObject[memberName]).GetBool())
-                    *pIecBool = 1;
-                else
-                    *pIecBool = 0;
-            }
-            break;
+            sink.Report(1, JSON_ERROR_NOT_FOUND, member.jsonDataType, plan.name(member), -1, JSON_ERROR_NO_OFFSET);
+            return 1;
+        }
+    }
 
-        case JSON_OBJECT:
-            if (!(jsonObject[memberName]).IsObject()) {
-                // indicate error to console & logfile
-                std::cout << R"(JSON for PLC: ")" << memberName << R"(" is not an object.)" << std::endl;
-#if defined(OL91)
-                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ is not an object.\n", memberName);
-#endif
-                return 2; // wrong type
-            }
+    return returnCode;
+}
 
-            // no size check for an object, this is done for each object member
+// pPositions: where each member of the plan was found in the last message (a guess
+// for the next one, see JsonMemberCursor), NULL to go by the order of the plan only
+uint32_t PlanInterpret(const JsonPlan& plan, uint32_t objectIdx, GenericValue<UTF8<char>, MyAllocator>& jsonObject, unsigned char* binBuffer, bool singlePass,
+                       uint32_t* pPositions, JsonErrorSink& sink) {
 
-            returnCode = RecurseInterpret(jsonObject[memberName],
-                                          pInterpreter,
-                                          (*pInterpreter)[memberName],
-                                          binBuffer + member.second.offsetInBinaryStruct,
-                                          member.second.sizeInBinaryStruct);
+    // an object without description in the interpreter has nothing to interpret
+    if (objectIdx == JSON_PLAN_NO_OBJECT)
+        return 0;
 
-            if (returnCode != 0)
-                return returnCode;
+    if (singlePass)
+        return PlanInterpretSinglePass(plan, objectIdx, jsonObject, binBuffer, pPositions, sink);
+
+    const JsonPlanObject& object = plan.object(objectIdx);
+
+    JsonMemberCursor<MyValue> cursor(jsonObject);
+
+    uint32_t returnCode = 0;
+
+    for (uint32_t memberIdx = object.firstMember; memberIdx < object.firstMember + object.memberCount; memberIdx++) {
+
+        const JsonPlanMember& member = plan.member(memberIdx);
+        const char* memberName = plan.name(member);
+
+        // does the member exist?
+        uint32_t noPosition = JSON_CURSOR_NO_POSITION;
+        uint32_t& position = pPositions ? pPositions[memberIdx] : noPosition;
+        MyValue::MemberIterator itMember = cursor.Find(memberName, member.nameLength, position);
+        if (itMember == cursor.End()) {
+            sink.Report(1, JSON_ERROR_NOT_FOUND, member.jsonDataType, memberName, -1, JSON_ERROR_NO_OFFSET);
+            return 1;
+        }
+
+        uint32_t memberCode = PlanInterpretMember(plan, member, itMember->value, binBuffer, false, pPositions,
+                                                  sink.Offset(itMember->name.GetString() - 1), sink);
+
+        if (memberCode == 3)
+            returnCode = 3; // string truncated, go on with the next member
+        else if (memberCode != 0)
+            return memberCode;
+    }
+
+    return returnCode;
+}
+
+// a string of the binary struct as JSON string, escaped the way rapidjson's Writer does
+// (the string ends at its terminating 0 or at the end of its field)
+static void PlanWriteString(const char* string, uint32_t size, StringBuffer& out) {
+    static const char hexDigits[] = "0123456789ABCDEF";
+
+    size_t length = strnlen(string, size);
+
+    // worst case every character is escaped as \u00XX, quotes included
+    out.Reserve(length * 6 + 2);
+
+    out.PutUnsafe('"');
+
+    for (size_t idx = 0; idx < length; idx++) {
+        unsigned char c = (unsigned char)string[idx];
+
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            out.PutUnsafe((char)c);
+            continue;
+        }
+
+        out.PutUnsafe('\\');
 
+        switch (c) {
+        case '"':  out.PutUnsafe('"');  break;
+        case '\\': out.PutUnsafe('\\'); break;
+        case '\b': out.PutUnsafe('b');  break;
+        case '\f': out.PutUnsafe('f');  break;
+        case '\n': out.PutUnsafe('n');  break;
+        case '\r': out.PutUnsafe('r');  break;
+        case '\t': out.PutUnsafe('t');  break;
+        default:
+            out.PutUnsafe('u');
+            out.PutUnsafe('0');
+            out.PutUnsafe('0');
+            out.PutUnsafe(hexDigits[c >> 4]);
+            out.PutUnsafe(hexDigits[c & 0xF]);
             break;
+        }
+    }
 
-        case JSON_STRINGARRAY:
-        case JSON_INTARRAY:
-        case JSON_UINTARRAY:
-        case JSON_DOUBLEARRAY:
-        case JSON_BOOLARRAY:
-        case JSON_OBJECTARRAY:
-            if (!(jsonObject[memberName]).IsArray()) {
-                // indicate error to console & logfile
-                std::cout << R"(JSON for PLC: ")" << memberName << R"(" is not an array.)" << std::endl;
-#if defined(OL91)
-                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ is not an array.\n", memberName);
-#endif
-                return 2; // wrong type
-            }
+    out.PutUnsafe('"');
+}
 
+// a single scalar (or string) value, used for members and array elements alike
+static uint32_t PlanWriteValue(uint32_t dataType, uint32_t size, unsigned char* pSource, StringBuffer& out,
+                               const char* memberName, int arrayIdx, JsonErrorSink& sink) {
+    switch (dataType) {
+    case JSON_STRING:
+        PlanWriteString((const char*)pSource, size, out);
+        break;
 
-            {
-                SizeType jsonArraySize = jsonObject[memberName].Size();
-                // write UsedArraySize to a required 'int' just before the array
+    case JSON_INT: {
+        char* pBegin = out.Push(11);
+        char* pEnd = internal::i32toa(*(int32_t*)pSource, pBegin);
+        out.Pop(11 - (pEnd - pBegin));
+    }
+    break;
 
-                int32_t* pInt = (int32_t*)(binBuffer + member.second.offsetInBinaryStruct - sizeof(int));
+    case JSON_UINT: {
+        char* pBegin = out.Push(10);
+        char* pEnd = internal::u32toa(*(uint32_t*)pSource, pBegin);
+        out.Pop(10 - (pEnd - pBegin));
+    }
+    break;
 
-                SizeType maxArraySize = *pInt;
+    case JSON_DOUBLE: {
+        double value = *(double*)pSource;
 
-                // limit the arraysize to the maximum
-                if (maxArraySize < jsonArraySize) {
-                    // indicate error to console & logfile
-                    std::cout << R"(JSON for PLC - WARNING: binary arraySize ()" << maxArraySize << R"() for ")" << memberName << R"(" is less than JSON no of array elements ()" << jsonArraySize << ")" << std::endl;
-#if defined(OL91)
-                    el_logff(LOG_NOTICE, "JSON for PLC - WARNING: binary arraySize (%d) for \"%s\" is less than JSON no of array elements (%d)\n", maxArraySize, memberName, jsonArraySize);
-#endif
-                    jsonArraySize = maxArraySize;
-                }
+        // like the Writer: JSON has no NaN and no Infinity
+        if (!std::isfinite(value)) {
+            sink.Report(2, JSON_ERROR_WRONG_TYPE, JSON_DOUBLE, memberName, arrayIdx, JSON_ERROR_NO_OFFSET);
+            return 2; // wrong type
+        }
+
+        char* pBegin = out.Push(25);
+        char* pEnd = internal::dtoa(value, pBegin);
+        out.Pop(25 - (pEnd - pBegin));
+    }
+    break;
+
+    case JSON_BOOL:
+        // a CODESYS-BOOL member is true for any value but 0, an array element only for 1 (as RecurseWrite does)
+        if (arrayIdx < 0 ? *(char*)pSource != 0 : *(char*)pSource == 1) {
+            memcpy(out.Push(4), "true", 4);
+        } else {
+            memcpy(out.Push(5), "false", 5);
+        }
+        break;
 
-                *pInt = jsonArraySize;
+    default:
+        break;
+    }
 
-                switch (member.second.jsonDataType) {
+    return 0;
+}
 
-                case JSON_STRINGARRAY:
-                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+// the elements of an array member (pSource at the first one) as JSON array
+static uint32_t PlanWriteArray(const JsonPlan& plan, const JsonPlanMember& member, unsigned char* pSource, StringBuffer& out,
+                               JsonErrorSink& sink) {
+    const char* memberName = plan.name(member);
 
-                        if (!(jsonObject[memberName][arrayIdx]).IsString()) {
-                            // indicate error to console & logfile
-                            std::cout << R"(JSON for PLC: ")" << memberName << R"([)" << arrayIdx << R"(])" << R"(" is not a string.)" << std::endl;
-#if defined(OL91)
-                            el_logff(LOG_NOTICE, "JSON for PLC: \"%s\[%d] is not a string.\n", memberName, arrayIdx);
-#endif
-                            return 2; // wrong type
-                        }
+    // get UsedArraySize from the 'int' (required) just before the array
+    int32_t jsonArraySize = *(int32_t*)(pSource - sizeof(int32_t));
 
-                        {
-                            const char* string = (jsonObject[memberName][arrayIdx]).GetString();
+    // the element type is the scalar type of the same order in JsonDataType
+    uint32_t elementType = member.jsonDataType - JSON_STRINGARRAY + JSON_STRING;
 
-                            SizeType strLength = (jsonObject[memberName][arrayIdx]).GetStringLength();
+    out.Put('[');
 
-                            if (strLength > member.second.sizeInBinaryStruct-1) {
-                                // indicate error to console & logfile
-                                std::cout << R"(JSON for PLC: ")" << memberName << R"([)" << arrayIdx << R"(])" << R"(" insufficient binSize for string -> truncated.)" << std::endl;
-#if defined(OL91)
-                                el_logff(LOG_NOTICE, "JSON for PLC: \"%s\[%d] insufficient binSize for string -> truncated.\n", memberName, arrayIdx);
-#endif
-                                returnCode = 3; // string truncated
+    for (int32_t arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+        unsigned char* pElement = pSource + arrayIdx * member.sizeInBinaryStruct;
+        uint32_t elementCode;
 
-                                // truncate stringLength
-                                strLength = member.second.sizeInBinaryStruct-1;
-                            }
+        if (arrayIdx > 0)
+            out.Put(',');
 
-                            char* destStr = (char*)binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct;
-                            strncpy(destStr, string, strLength);
-                            //set terminating 0
-                            destStr[strLength] = (char)0;
-                        }
+        if (elementType == JSON_OBJECT) {
+            sink.Push(memberName);
+            sink.PushIndex(arrayIdx);
+            elementCode = PlanWrite(plan, member.childObject, pElement, out, sink);
+            sink.Pop();
+            sink.Pop();
+        } else
+            elementCode = PlanWriteValue(elementType, member.sizeInBinaryStruct, pElement, out, memberName, arrayIdx, sink);
 
-                    }
-                    break;
+        if (elementCode != 0)
+            return elementCode;
+    }
 
-                case JSON_INTARRAY:
-                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
-                        if (!(jsonObject[memberName][arrayIdx]).IsInt()) {
-                            // indicate error to console & logfile
-                            std::cout << R"(JSON for PLC: ")" << memberName << R"([)" << arrayIdx << R"(])" << R"(" is not an int.)" << std::endl;
-#if defined(OL91)
-                            el_logff(LOG_NOTICE, "JSON for PLC: \"%s\[%d] is not an int.\n", memberName, arrayIdx);
-#endif
-                        }
+    out.Put(']');
 
-                        int32_t* pInt = (int32_t*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
-                        *pInt = (jsonObject[memberName][arrayIdx]).GetInt();
-                    }
-                    break;
+    return 0;
+}
 
-                case JSON_UINTARRAY:
-                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
-                        if (!(jsonObject[memberName][arrayIdx]).IsUint()) {
-                            // indicate error to console & logfile
-                            std::cout << R"(JSON for PLC: ")" << memberName << R"([)" << arrayIdx << R"(])" << R"(" is not a uint.)" << std::endl;
-#if defined(OL91)
-                            el_logff(LOG_NOTICE, "JSON for PLC: \"%s\[%d] is not a uint.\n", memberName, arrayIdx);
-#endif
-                            return 2; // wrong type
-                        }
+uint32_t PlanWrite(const JsonPlan& plan, uint32_t objectIdx, unsigned char* binBuffer, StringBuffer& out, JsonErrorSink& sink) {
 
-                        uint32_t* pUint = (uint32_t*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
-                        *pUint = (jsonObject[memberName][arrayIdx]).GetUint();
-                    }
-                    break;
+    // an object without description (or members) is written empty
+    if (objectIdx == JSON_PLAN_NO_OBJECT || plan.object(objectIdx).memberCount == 0) {
+        memcpy(out.Push(2), "{}", 2);
+        return 0;
+    }
 
-                case JSON_DOUBLEARRAY:
-                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
-                        if (!(jsonObject[memberName][arrayIdx]).IsDouble()) {
-                            // indicate error to console & logfile
-                            std::cout << R"(JSON for PLC: ")" << memberName << R"([)" << arrayIdx << R"(])" << R"(" is not a double.)" << std::endl;
-#if defined(OL91)
-                            el_logff(LOG_NOTICE, "JSON for PLC: \"%s\[%d] is not a double.\n", memberName, arrayIdx);
-#endif
-                            return 2; // wrong type
-                        }
+    const JsonPlanObject& object = plan.object(objectIdx);
 
-                        double* pDouble = (double*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
-                        *pDouble = (jsonObject[memberName][arrayIdx]).GetDouble();
-                    }
-                    break;
+    for (uint32_t memberIdx = object.firstMember; memberIdx < object.firstMember + object.memberCount; memberIdx++) {
 
-                case JSON_BOOLARRAY:
-                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
-                        if (!(jsonObject[memberName][arrayIdx]).IsBool()) {
-                            // indicate error to console & logfile
-                            std::cout << R"(JSON for PLC: ")" << memberName << R"([)" << arrayIdx << R"(])" << R"(" is not a bool.)" << std::endl;
-#if defined(OL91)
-                            el_logff(LOG_NOTICE, "JSON for PLC: \"%s\[%d] is not a bool.\n", memberName, arrayIdx);
-#endif
-                            return 2; // wrong type
-                        }
+        const JsonPlanMember& member = plan.member(memberIdx);
+        const char* memberName = plan.name(member);
+        unsigned char* pSource = binBuffer + member.offsetInBinaryStruct;
 
-                        char* pIecBool = (char*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
+        // {"name": or ,"name":
+        memcpy(out.Push(member.prefixLength), plan.prefix(member), member.prefixLength);
 
-                        if ((jsonObject[memberName][arrayIdx]).GetBool())
-                            *pIecBool = 1;
-                        else
-                            *pIecBool = 0;
-                    }
-                    break;
+        switch (member.jsonDataType) {
+        case JSON_STRING:
+        case JSON_INT:
+        case JSON_UINT:
+        case JSON_DOUBLE:
+        case JSON_BOOL: {
+            uint32_t valueCode = PlanWriteValue(member.jsonDataType, member.sizeInBinaryStruct, pSource, out, memberName, -1, sink);
 
-                case JSON_OBJECTARRAY:
-                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
-                        if (!(jsonObject[memberName][arrayIdx]).IsObject()) {
-                            // indicate error to console & logfile
-                            std::cout << R"(JSON for PLC: ")" << memberName << R"([)" << arrayIdx << R"(])" << R"(" is not an object.)" << std::endl;
-#if defined(OL91)
-                            el_logff(LOG_NOTICE, "JSON for PLC: \"%s\[%d] is not an object.\n", memberName, arrayIdx);
-#endif
-                            return 2; // wrong type
-                        }
+            if (valueCode != 0)
+                return valueCode;
+        }
+        break;
 
-                        returnCode = RecurseInterpret(jsonObject[memberName][arrayIdx],
-                                                      pInterpreter,
-                                                      (*pInterpreter)[memberName],
-                                                      binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct,
-                                                      member.second.sizeInBinaryStruct);
+        case JSON_OBJECT: {
+            sink.Push(memberName);
+            uint32_t objectCode = PlanWrite(plan, member.childObject, pSource, out, sink);
+            sink.Pop();
 
-                        if (returnCode != 0)
-                            return returnCode;
-                    }
-                    break;
+            if (objectCode != 0)
+                return objectCode;
+        }
+        break;
 
-                default:
-                    break;	// only to avoid the not-handled-in-switch warning
-                }
-            }
+        case JSON_STRINGARRAY:
+        case JSON_INTARRAY:
+        case JSON_UINTARRAY:
+        case JSON_DOUBLEARRAY:
+        case JSON_BOOLARRAY:
+        case JSON_OBJECTARRAY: {
+            uint32_t arrayCode = PlanWriteArray(plan, member, pSource, out, sink);
 
-            break;
+            if (arrayCode != 0)
+                return arrayCode;
+        }
+        break;
 
         default:
-            std::cout << "unknown JSON Type " << member.second.jsonDataType << ". I don't know how to interpret it" << std::endl;
-            return 5; // unknown object - TODO: for all error returns check if continuation is possible / makes sense
-            break;
+            sink.Report(5, JSON_ERROR_UNKNOWN_TYPE, member.jsonDataType, memberName, -1, JSON_ERROR_NO_OFFSET);
+            return 5; // unknown object
         }
     }
 
-    return returnCode;
+    out.Put('}');
+
+    return 0;
 }
 
-uint32_t RecurseWrite(MyAllocator& myAlloc, GenericValue<UTF8<char>, MyAllocator>& jsonObject, std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >* pInterpreter, std::unordered_map<std::string, JsonBinaryStructMapInfo>& jsonObjectMapping,
-                      unsigned char* binBuffer) {
+// the bytes of the binary struct the text of an object depends on, arrays up to their element count
+uint32_t PlanExtent(const JsonPlan& plan, uint32_t objectIdx, const unsigned char* binBuffer) {
 
-    uint32_t returnCode = 0;
+    if (objectIdx == JSON_PLAN_NO_OBJECT)
+        return 0;
 
-    // iterate over the member description array
-    for (auto& member : jsonObjectMapping) {
+    const JsonPlanObject& object = plan.object(objectIdx);
+    uint32_t extent = 0;
 
-        const char* memberName = member.first.c_str();
+    for (uint32_t memberIdx = object.firstMember; memberIdx < object.firstMember + object.memberCount; memberIdx++) {
 
-        MyValue newJsonValue;
+        const JsonPlanMember& member = plan.member(memberIdx);
+        const unsigned char* pSource = binBuffer + member.offsetInBinaryStruct;
+        uint32_t end;
 
-        // if it is of the expected type extract it
-        switch (member.second.jsonDataType) {
-        case JSON_STRING: {
-            const char* string = (char*)binBuffer + member.second.offsetInBinaryStruct;
+        if (member.jsonDataType == JSON_OBJECT)
+            end = member.offsetInBinaryStruct + PlanExtent(plan, member.childObject, pSource);
+        else if (member.jsonDataType >= JSON_STRINGARRAY && member.jsonDataType <= JSON_OBJECTARRAY) {
+            // the elements of an object array lie within their element size
+            int32_t jsonArraySize = *(const int32_t*)(pSource - sizeof(int32_t));
 
-            newJsonValue.SetString((char*)string, strlen(string));
-        }
-        break;
+            end = member.offsetInBinaryStruct + (jsonArraySize > 0 ? (uint32_t)jsonArraySize * member.sizeInBinaryStruct : 0);
+        } else
+            end = member.offsetInBinaryStruct + member.sizeInBinaryStruct;
 
-        case JSON_INT: {
-            int32_t* pInt = (int32_t*)(binBuffer + member.second.offsetInBinaryStruct);
+        if (end > extent)
+            extent = end;
+    }
 
-            newJsonValue.SetInt(*pInt);
-        }
-        break;
+    return extent;
+}
 
-        case JSON_UINT: {
-            uint32_t* pUint = (uint32_t*)(binBuffer + member.second.offsetInBinaryStruct);
+// do two scalar (or string) values give the same text? The bytes after the end of a string
+// don't count, nor does the value of a BOOL beyond what PlanWriteValue makes of it
+static bool PlanValueEqual(uint32_t dataType, uint32_t size, const unsigned char* pValue, const unsigned char* pSent, int arrayIdx) {
+    switch (dataType) {
+    case JSON_STRING: {
+        size_t length = strnlen((const char*)pValue, size);
 
-            newJsonValue.SetUint(*pUint);
-        }
-        break;
+        return length == strnlen((const char*)pSent, size) && memcmp(pValue, pSent, length) == 0;
+    }
 
-        case JSON_DOUBLE: {
-            double* pDouble = (double*)(binBuffer + member.second.offsetInBinaryStruct);
+    case JSON_INT:
+    case JSON_UINT:
+        return memcmp(pValue, pSent, sizeof(int32_t)) == 0;
 
-            newJsonValue.SetDouble(*pDouble);
-        }
-        break;
+    case JSON_DOUBLE:
+        return memcmp(pValue, pSent, sizeof(double)) == 0;
 
-        case JSON_BOOL: {
-            char* pIecBool = (char*)(binBuffer + member.second.offsetInBinaryStruct);
+    case JSON_BOOL:
+        if (arrayIdx < 0)
+            return (*(const char*)pValue != 0) == (*(const char*)pSent != 0);
 
-            if (*pIecBool)
-                newJsonValue.SetBool(true);
-            else
-                newJsonValue.SetBool(false);
-        }
-        break;
+        return (*(const char*)pValue == 1) == (*(const char*)pSent == 1);
 
-        case JSON_OBJECT:
-            newJsonValue.SetObject();
-            returnCode = RecurseWrite(
-                             myAlloc,
-                             newJsonValue,
-                             pInterpreter,
-                             (*pInterpreter)[memberName],
-                             binBuffer + member.second.offsetInBinaryStruct);
+    default:
+        return false;
+    }
+}
 
-            if (returnCode != 0)
-                return returnCode;
+static bool PlanMemberEqual(const JsonPlan& plan, const JsonPlanMember& member, const unsigned char* pValue, const unsigned char* pSent);
 
-            break;
+static bool PlanObjectEqual(const JsonPlan& plan, uint32_t objectIdx, const unsigned char* binBuffer, const unsigned char* pSent) {
 
-        case JSON_STRINGARRAY:
-        case JSON_INTARRAY:
-        case JSON_UINTARRAY:
-        case JSON_DOUBLEARRAY:
-        case JSON_BOOLARRAY:
-        case JSON_OBJECTARRAY:
+    if (objectIdx == JSON_PLAN_NO_OBJECT)
+        return true;
 
-            newJsonValue.SetArray();
+    const JsonPlanObject& object = plan.object(objectIdx);
 
-            // get UsedArraySize from the 'int' (required) just before the array
-            {
-                int32_t* pInt = (int32_t*)(binBuffer + member.second.offsetInBinaryStruct - sizeof(int32_t));
-                SizeType jsonArraySize = *pInt;
+    for (uint32_t memberIdx = object.firstMember; memberIdx < object.firstMember + object.memberCount; memberIdx++) {
+        const JsonPlanMember& member = plan.member(memberIdx);
 
-                switch (member.second.jsonDataType) {
+        if (!PlanMemberEqual(plan, member, binBuffer + member.offsetInBinaryStruct, pSent + member.offsetInBinaryStruct))
+            return false;
+    }
 
-                case JSON_STRINGARRAY:
-                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
-                        // the given size is the the size of a single array element
-                        const char* string = (char*)binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct;
-                        newJsonValue.PushBack(MyValue().SetString((char*)string, strlen(string)), myAlloc);
-                    }
-                    break;
+    return true;
+}
 
-                case JSON_INTARRAY:
-                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
-                        int32_t* pInt = (int32_t*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
-                        newJsonValue.PushBack(MyValue().SetInt(*pInt), myAlloc);
-                    }
-                    break;
+// arrays element by element, up to their element count
+static bool PlanMemberEqual(const JsonPlan& plan, const JsonPlanMember& member, const unsigned char* pValue, const unsigned char* pSent) {
+    switch (member.jsonDataType) {
+    case JSON_STRING:
+    case JSON_INT:
+    case JSON_UINT:
+    case JSON_DOUBLE:
+    case JSON_BOOL:
+        return PlanValueEqual(member.jsonDataType, member.sizeInBinaryStruct, pValue, pSent, -1);
+
+    case JSON_OBJECT:
+        return PlanObjectEqual(plan, member.childObject, pValue, pSent);
+
+    case JSON_STRINGARRAY:
+    case JSON_INTARRAY:
+    case JSON_UINTARRAY:
+    case JSON_DOUBLEARRAY:
+    case JSON_BOOLARRAY:
+    case JSON_OBJECTARRAY: {
+        int32_t jsonArraySize = *(const int32_t*)(pValue - sizeof(int32_t));
+
+        if (jsonArraySize != *(const int32_t*)(pSent - sizeof(int32_t)))
+            return false;
+
+        uint32_t elementType = member.jsonDataType - JSON_STRINGARRAY + JSON_STRING;
+
+        for (int32_t arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
+            uint32_t elementOffset = arrayIdx * member.sizeInBinaryStruct;
+            bool equal;
+
+            if (elementType == JSON_OBJECT)
+                equal = PlanObjectEqual(plan, member.childObject, pValue + elementOffset, pSent + elementOffset);
+            else
+                equal = PlanValueEqual(elementType, member.sizeInBinaryStruct, pValue + elementOffset, pSent + elementOffset, arrayIdx);
 
-                case JSON_UINTARRAY:
-                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
-                        uint32_t* pUint = (uint32_t*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
-                        newJsonValue.PushBack(MyValue().SetUint(*pUint), myAlloc);
-                    }
-                    break;
+            if (!equal)
+                return false;
+        }
 
-                case JSON_DOUBLEARRAY:
-                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
-                        double* pDouble = (double*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
-                        newJsonValue.PushBack(MyValue().SetDouble(*pDouble), myAlloc);
-                    }
-                    break;
+        return true;
+    }
 
-                case JSON_BOOLARRAY:
-                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
-                        char* pIecBool = (char*)(binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
+    default:
+        return false; // PlanWriteDelta reports it
+    }
+}
 
-                        if (*pIecBool == 1)
-                            newJsonValue.PushBack(MyValue().SetBool(true), myAlloc);
-                        else
-                            newJsonValue.PushBack(MyValue().SetBool(false), myAlloc);
-                    }
-                    break;
+// Like PlanWrite, but only with the members whose text differs from the one of pSent (the binary
+// struct of the last text), as JSON merge patch (RFC 7386): a nested object with its changed members
+// only, an array in full (a merge patch replaces arrays as a whole), {} if nothing changed.
+uint32_t PlanWriteDelta(const JsonPlan& plan, uint32_t objectIdx, unsigned char* binBuffer, const unsigned char* pSent,
+                        StringBuffer& out, JsonErrorSink& sink) {
 
-                case JSON_OBJECTARRAY:
-                    for (SizeType arrayIdx = 0; arrayIdx < jsonArraySize; arrayIdx++) {
-                        MyValue myVal;
-                        myVal.SetObject();
+    out.Put('{');
 
-                        returnCode = RecurseWrite(
-                                         myAlloc,
-                                         myVal,
-                                         pInterpreter,
-                                         (*pInterpreter)[memberName],
-                                         binBuffer + member.second.offsetInBinaryStruct + arrayIdx * member.second.sizeInBinaryStruct);
+    if (objectIdx == JSON_PLAN_NO_OBJECT) {
+        out.Put('}');
+        return 0;
+    }
 
-                        newJsonValue.PushBack(myVal, myAlloc);
+    const JsonPlanObject& object = plan.object(objectIdx);
+    bool first = true;
 
-                        if (returnCode != 0)
-                            return returnCode;
-                    }
-                    break;
+    for (uint32_t memberIdx = object.firstMember; memberIdx < object.firstMember + object.memberCount; memberIdx++) {
 
-                default:
-                    break;	// only to avoid the not-handled-in-switch warning
+        const JsonPlanMember& member = plan.member(memberIdx);
+        const char* memberName = plan.name(member);
+        unsigned char* pSource = binBuffer + member.offsetInBinaryStruct;
+        const unsigned char* pPrevious = pSent + member.offsetInBinaryStruct;
 
-                }
-            }
+        if (PlanMemberEqual(plan, member, pSource, pPrevious))
+            continue;
+
+        // "name": from the template, without its { or ,
+        if (!first)
+            out.Put(',');
+
+        memcpy(out.Push(member.prefixLength - 1), plan.prefix(member) + 1, member.prefixLength - 1);
+        first = false;
 
+        uint32_t memberCode;
+
+        switch (member.jsonDataType) {
+        case JSON_STRING:
+        case JSON_INT:
+        case JSON_UINT:
+        case JSON_DOUBLE:
+        case JSON_BOOL:
+            memberCode = PlanWriteValue(member.jsonDataType, member.sizeInBinaryStruct, pSource, out, memberName, -1, sink);
             break;
 
-        default:
-            std::cout << "unknown JSON Type " << member.second.jsonDataType << ". I don't know how to write it" << std::endl;
-            return 5; // unknown object - TODO: for all error returns check if continuation is possible / makes sense
+        case JSON_OBJECT:
+            sink.Push(memberName);
+            memberCode = PlanWriteDelta(plan, member.childObject, pSource, pPrevious, out, sink);
+            sink.Pop();
             break;
-        }
 
-        // add the member
-        MyValue& myVal = jsonObject.AddMember(GenericStringRef<char>(memberName), newJsonValue, myAlloc);
-        if (myVal.IsNull()) {
-            // indicate error to console & logfile
-            std::cout << R"(JSON for PLC: ")" << memberName << R"(" not added.)" << std::endl;
-#if defined(OL91)
-            el_logff(LOG_NOTICE, "JSON for PLC: \"%s\ not added.\n", memberName);
-#endif
-            return 1;
+        case JSON_STRINGARRAY:
+        case JSON_INTARRAY:
+        case JSON_UINTARRAY:
+        case JSON_DOUBLEARRAY:
+        case JSON_BOOLARRAY:
+        case JSON_OBJECTARRAY:
+            memberCode = PlanWriteArray(plan, member, pSource, out, sink);
+            break;
+
+        default:
+            sink.Report(5, JSON_ERROR_UNKNOWN_TYPE, member.jsonDataType, memberName, -1, JSON_ERROR_NO_OFFSET);
+            return 5; // unknown object
         }
 
+        if (memberCode != 0)
+            return memberCode;
     }
 
-    return returnCode;
-}
+    out.Put('}');
 
+    return 0;
+}
@@ -12,6 +12,9 @@
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <initializer_list>
+
+#include "jsonKey.h"
 
 enum JsonDataType {JSON_STRING, JSON_INT, JSON_UINT, JSON_DOUBLE, JSON_BOOL, JSON_OBJECT,
                    JSON_STRINGARRAY, JSON_INTARRAY, JSON_UINTARRAY, JSON_DOUBLEARRAY, JSON_BOOLARRAY, JSON_OBJECTARRAY
@@ -23,21 +26,165 @@ struct JsonBinaryStructMapInfo {
     uint32_t		sizeInBinaryStruct;
 };
 
+// how JSON_TextToBin gets from the text to the binary struct
+enum JsonDecodeMode {JSON_DECODE_DOM,				// parse into a DOM, then walk the interpreter (default)
+                     JSON_DECODE_SAX,				// no DOM, values are written while the text is tokenized (needs a compiled interpreter)
+                     JSON_DECODE_DOM_SINGLEPASS,	// parse into a DOM, then walk every JSON member once (needs a compiled interpreter)
+                     JSON_DECODE_INCREMENTAL		// like JSON_DECODE_SAX, but values whose text didn't change since the last message
+                                                // are skipped (the same binBuffer every time, see JSON_getWrittenRanges)
+                    };
+
+// how JSON_BinToText gets from the binary struct to the text
+enum JsonEncodeMode {JSON_ENCODE_DOM,		// build a DOM, JSON_getOutString serializes it (default)
+                     JSON_ENCODE_TEMPLATE,	// render the text straight from the compiled interpreter's template, no DOM
+                     JSON_ENCODE_DELTA		// like JSON_ENCODE_TEMPLATE, but only the members that changed since the last
+                                            // text, as JSON merge patch (RFC 7386), see JSON_parserSetDeltaInterval
+                    };
+
+// memory statistics of a parser handle (see JSON_parserGetStats)
+struct JsonParserStats {
+    size_t			arenaHighWater;		// most arena bytes a single message needed
+    size_t			arenaCapacity;		// arena bytes held by the handle
+    size_t			arenaChunks;
+    size_t			heapAllocations;	// arena chunks allocated from the heap so far
+    size_t			reallocCopies;		// arena blocks moved to grow (the DOM's member and element arrays)
+};
+
+// the decode cache of a parser handle (see JSON_parserSetDecodeCache)
+struct JsonDecodeCacheStats {
+    uint64_t		hits;
+    uint64_t		misses;				// texts decoded, stored if the decode had no fault
+    uint64_t		evictions;			// entries dropped to stay within the capacity
+    size_t			entries;
+    size_t			bytes;				// held by the entries
+    size_t			capacity;
+};
+
+// a part of the binary struct written by JSON_TextToBin (see JSON_getWrittenRanges)
+struct JsonBinRange {
+    uint32_t		offset;
+    uint32_t		size;		// an array: its element count in front and the elements written
+};
+
+// why JSON_TextToBin/JSON_BinToText failed, the return code is given in brackets
+enum JsonErrorReason {JSON_ERROR_NONE,
+                      JSON_ERROR_PARSE,				// (10) the text is no valid JSON
+                      JSON_ERROR_NOT_FOUND,			// (1) a member of the interpreter is missing
+                      JSON_ERROR_NOT_ADDED,			// (1) a member could not be added to the output
+                      JSON_ERROR_WRONG_TYPE,		// (2)
+                      JSON_ERROR_STRING_TRUNCATED,	// (3) decoding went on
+                      JSON_ERROR_BINSIZE_TOO_SMALL,	// (4) not any more: JSON_parserObjectAddMember rejects such a member
+                      JSON_ERROR_BINSIZE_TOO_LARGE,	// (5) not any more, likewise
+                      JSON_ERROR_UNKNOWN_TYPE,		// (5) the interpreter has a type that isn't a JsonDataType
+                      JSON_ERROR_ARRAY_CLIPPED		// (0) warning only: more JSON elements than the binary array holds
+                     };
+
+constexpr uint32_t JSON_ERROR_NO_OFFSET = 0xFFFFFFFFu;
+constexpr size_t JSON_ERROR_PATH_SIZE = 128;
+
+// filled by JSON_TextToBin/JSON_BinToText, describes the most severe fault of the message
+struct JsonErrorInfo {
+    uint32_t			code;				// return code
+    JsonErrorReason		reason;
+    int32_t				expectedType;		// JsonDataType the value should have had, -1 if none
+    uint32_t			offset;				// byte offset into the JSON text (at the member's key for the DOM modes, none
+                                            // there with JSON_TextToBinN, where the reader stood for JSON_DECODE_SAX),
+                                            // JSON_ERROR_NO_OFFSET if none
+    uint32_t			binaryArraySize;	// JSON_ERROR_ARRAY_CLIPPED: elements the binary array holds
+    uint32_t			jsonArraySize;		// JSON_ERROR_ARRAY_CLIPPED: elements in the JSON text
+    char				path[JSON_ERROR_PATH_SIZE];	// e.g. ip[3].mask, truncated if longer
+};
+
 typedef void* ParserHandle;
 typedef void* ValueHandle;
 typedef void* InterpreterObjectHandle;
+typedef void* FrozenInterpreterHandle;
+typedef void* ParserPoolHandle;
+typedef void* LinesHandle;
 
 
 ParserHandle JSON_parserNew();
 
+// NULL if the layout of the interpreter is faulty (see JSON_parserObjectAddMember and JSON_parserCompile)
 ParserHandle JSON_parserNew(std::unordered_map<std::string, std::unordered_map<std::string, JsonBinaryStructMapInfo> >*	pInterpreter);
 
+// freeze the interpreter registered with a handle: a compiled copy that never changes and can be
+// shared by any number of handles on any number of threads (NULL if there's no root object or the layout is faulty)
+FrozenInterpreterHandle JSON_interpreterFreeze(ParserHandle hDoc);
+
+// drop the reference of JSON_interpreterFreeze, the interpreter goes with the last handle using it
+void JSON_interpreterRelease(FrozenInterpreterHandle hFrozen);
+
+// use this to work with a frozen interpreter, JSON_parserNewObject fails on such a handle
+ParserHandle JSON_parserNewFrozen(FrozenInterpreterHandle hFrozen);
+
+// The compiled interpreter of a handle as a binary image, e.g. for a file that is loaded at the next start instead of
+// registering every object and member again. The image has no pointers: it's the plan behind a header with a version,
+// layoutKey and a checksum. layoutKey stands for the layout of the binary structs the application was built with
+// (see JSON_layoutKey), an image saved with another one isn't loaded. Copies the image to image if imageCapacity
+// holds it, returns its size (0 if the interpreter can't be compiled).
+size_t JSON_interpreterSaveImage(ParserHandle hDoc, uint64_t layoutKey, void* image, size_t imageCapacity);
+// the same into a file
+bool JSON_interpreterWriteImage(ParserHandle hDoc, uint64_t layoutKey, const char* path);
+// a frozen interpreter from an image file, mapped into memory and used in place: nothing is allocated per object or
+// member. NULL if it can't be read, is of another version, was saved with another layoutKey or is damaged. Handles of
+// it decode in every mode, JSON_ENCODE_DOM renders the text like JSON_ENCODE_TEMPLATE, the members in struct order
+// (there's no interpreter to build a DOM with).
+FrozenInterpreterHandle JSON_interpreterLoadImage(const char* path, uint64_t layoutKey);
+// the same for an image in memory (8 byte aligned), it has to stay until the interpreter is released
+FrozenInterpreterHandle JSON_interpreterUseImage(const void* image, size_t size, uint64_t layoutKey);
+
+// a layoutKey from the sizes and offsets of the binary structs, e.g.
+// JSON_layoutKey({sizeof(IpCfg), offsetof(IpCfg, dhcp), offsetof(IpCfg, ip), sizeof(Numbers), ...})
+constexpr uint64_t JSON_layoutKey(std::initializer_list<size_t> values) {
+    uint64_t key = 14695981039346656037ull;
+
+    for (size_t value : values) {
+        key ^= (uint64_t)value;
+        key *= 1099511628211ull;
+    }
+
+    return key;
+}
+
+// handleCount handles of a frozen interpreter, built up front for threads to acquire and release without a lock
+ParserPoolHandle JSON_parserPoolNew(FrozenInterpreterHandle hFrozen, size_t handleCount);
+
+// NULL if all handles are in use
+ParserHandle JSON_parserPoolAcquire(ParserPoolHandle hPool);
+
+void JSON_parserPoolRelease(ParserPoolHandle hPool, ParserHandle hDoc);
+
+// all handles have to be released
+void JSON_parserPoolDelete(ParserPoolHandle hPool);
+
 bool JSON_parse(ParserHandle docHandle, char* jsonString);
 
+// back the arena of the handle with a static buffer first (heap chunks are only added if it overflows),
+// false if buffer isn't 8 byte aligned or too small for the arena's chunk header
+bool JSON_parserSetArenaBuffer(ParserHandle hDoc, void* buffer, size_t size);
+
+bool JSON_parserGetStats(ParserHandle hDoc, JsonParserStats* pStats);
+
+// the blocks all handles' allocators moved to grow on the calling thread since it started (the reallocCopies of
+// JsonParserStats summed up), such a copy stays within the allocator and never reaches realloc
+uint64_t JSON_getThreadReallocCopies();
+
+// JSON_TextToBin and JSON_TextToBinN look the text up in a cache of up to byteCapacity bytes first: a text decoded
+// before without a fault, byte by byte the same, is one hash and a copy of what the decode wrote to binBuffer
+// (the DOM isn't built then). Needs a compiled interpreter, not used with JSON_DECODE_INCREMENTAL. 0 turns it off.
+bool JSON_parserSetDecodeCache(ParserHandle hDoc, size_t byteCapacity);
+// false if the handle has no decode cache
+bool JSON_parserGetDecodeCacheStats(ParserHandle hDoc, JsonDecodeCacheStats* pStats);
+
 void JSON_parserDelete(ParserHandle hDoc);
 
+// NULL if the document has no such member (strlen and hash of the name on every call, see below)
 ValueHandle 		JSON_getMemberValue(ParserHandle hDoc, const char* jsonMemberName);
 
+// the same without strlen, e.g. with JSON_KEY("name") whose hash is computed at compile time
+ValueHandle 		JSON_getMemberValue(ParserHandle hDoc, const JsonKey& jsonMemberName);
+
 const char*			JSON_getOutString(ParserHandle hDoc);
 
 
@@ -100,13 +247,111 @@ bool				JSON_isObject(ValueHandle hVal);
 // create a new object-interpreter for objects of a given name (in the JSON tree)
 InterpreterObjectHandle JSON_parserNewObject(ParserHandle hDoc, const char* jsonObjectName);
 
-// add a member to an object
+// add a member to an object, false (and not added) if type, offset and size don't fit together:
+// a scalar's size is that of its type, an array's size is that of one element with the 'int'
+// element count just before the array, strings have room for their terminating 0
 bool JSON_parserObjectAddMember(InterpreterObjectHandle interpreterObjectHandle, const char* member, JsonDataType dataType, uint32_t offset, uint32_t size);
 
+// compile the registered objects into a flat, immutable plan used by JSON_TextToBin
+// (call again after registering further objects or members, JSON_parserNewObject and
+// JSON_parserObjectAddMember drop the plan),
+// fails if members overlap or the members of an object don't fit into the size of its struct
+bool JSON_parserCompile(ParserHandle hDoc);
+
+// select how JSON_TextToBin decodes, JSON_DECODE_SAX and JSON_DECODE_DOM_SINGLEPASS compile the interpreter if necessary
+bool JSON_parserSetDecodeMode(ParserHandle hDoc, JsonDecodeMode mode);
+
+// select how JSON_BinToText encodes, JSON_ENCODE_TEMPLATE compiles the interpreter if necessary
+// (members come in the order of their offsets then, JSON_getOutString returns the rendered text)
+bool JSON_parserSetEncodeMode(ParserHandle hDoc, JsonEncodeMode mode);
+
+// JSON_ENCODE_DELTA: every interval-th text of JSON_BinToText has all members (default 100, 0: only the first one
+// after JSON_parserSetEncodeMode or JSON_parserCompile, or after a text that failed). The texts in between hold the
+// members whose text would differ from the last one, a nested object with its changed members, an array in full
+// (merge patches replace arrays), {} if nothing changed.
+bool JSON_parserSetDeltaInterval(ParserHandle hDoc, uint32_t interval);
+// JSON_ENCODE_DELTA: the next text has all members, e.g. after the receiver reconnected
+void JSON_parserForceFullText(ParserHandle hDoc);
+
 // apply an interpreter to a parsed document to produce binary data
-uint32_t JSON_TextToBin(ParserHandle hDoc, char* jsonString, unsigned char* binBuffer, uint32_t binBufferSize);
+// (faults are described in *pError if given, they are logged by a background thread in any case)
+uint32_t JSON_TextToBin(ParserHandle hDoc, char* jsonString, unsigned char* binBuffer, uint32_t binBufferSize, JsonErrorInfo* pError = NULL);
+// the same for length bytes of a read-only text, e.g. a receive buffer: no terminating 0 needed, the text is left
+// untouched and no copy of it is made (JSON_DECODE_INCREMENTAL decodes it in full, like JSON_DECODE_SAX)
+uint32_t JSON_TextToBinN(ParserHandle hDoc, const char* text, size_t length, unsigned char* binBuffer, uint32_t binBufferSize,
+                         JsonErrorInfo* pError = NULL);
+// decode the JSON texts that follow each other in a frame of length bytes (whitespace in between), e.g. several
+// messages received at once: message idx goes to bins + idx * stride (prepared like for JSON_TextToBin), its return
+// code to results[idx]. At most capacity messages are decoded. *pConsumed is where the next frame has to go on: after
+// the last message decoded (one cut off at the end of the frame is left for the next frame), or at the end of the
+// frame after a message that isn't valid JSON (its result is 10, where the next one starts is unknown).
+// Returns the number of messages with a result. JSON_DECODE_INCREMENTAL decodes in full, like JSON_DECODE_SAX.
+size_t JSON_TextToBinFrame(ParserHandle hDoc, const char* text, size_t length, unsigned char* bins, size_t stride,
+                           size_t capacity, uint32_t* results, size_t* pConsumed);
+// decode count messages on the batch threads of the handle (started with one thread per core unless
+// JSON_parserSetBatchThreads was called): texts[idx] (lengths[idx] bytes, zero terminated if lengths is NULL)
+// goes to bins + idx * stride, its return code to results[idx]. The texts are left untouched, the interpreter
+// is compiled if necessary. Returns the number of messages with a return code other than 0.
+size_t JSON_TextToBinBatch(ParserHandle hDoc, const char* const* texts, const size_t* lengths, unsigned char* bins, size_t stride,
+                           size_t count, uint32_t* results);
+
+// JSON_DECODE_INCREMENTAL: the parts of binBuffer the last JSON_TextToBin wrote, in the order of the text (values
+// whose text is the one of the message before are not written). Copies at most rangeCapacity of them to ranges,
+// returns how many there are.
+size_t JSON_getWrittenRanges(ParserHandle hDoc, JsonBinRange* ranges, size_t rangeCapacity);
+
+// threads of JSON_TextToBinBatch, the calling thread included (0: one per core)
+bool JSON_parserSetBatchThreads(ParserHandle hDoc, unsigned int threadCount);
+
+// JSON Lines, e.g. a device log: one message per line, blank lines are skipped. The file is mapped into memory read
+// only, large ones are split into lines on one thread per core. NULL if it can't be opened.
+LinesHandle JSON_linesOpen(const char* path);
+// the same for length bytes in memory, they must stay as they are until JSON_linesClose
+LinesHandle JSON_linesOpenText(const char* text, size_t length);
+void JSON_linesClose(LinesHandle hLines);
+// the number of messages
+size_t JSON_linesCount(LinesHandle hLines);
+// message idx, without the line end (*pLength bytes, not zero terminated)
+const char* JSON_linesGet(LinesHandle hLines, size_t idx, size_t* pLength);
+// decode the messages first to first + count - 1 straight from the lines with JSON_TextToBinBatch: message
+// first + idx goes to bins + idx * stride, its return code to results[idx]. Returns the number of messages with
+// a return code other than 0.
+size_t JSON_TextToBinLines(ParserHandle hDoc, LinesHandle hLines, size_t first, size_t count, unsigned char* bins,
+                           size_t stride, uint32_t* results);
+
 // reverse
-uint32_t JSON_BinToText(ParserHandle hDoc, unsigned char* binBuffer);
+uint32_t JSON_BinToText(ParserHandle hDoc, unsigned char* binBuffer, JsonErrorInfo* pError = NULL);
+
+// the instruction set the parse entry points (JSON_parse, JSON_TextToBin) scan the text with, the best one the
+// CPU has is picked at startup
+enum JsonSimdPath {
+    JSON_SIMD_SCALAR,
+    JSON_SIMD_SSE2,
+    JSON_SIMD_SSE42,
+    JSON_SIMD_AVX2,
+    JSON_SIMD_PATH_COUNT
+};
+
+JsonSimdPath JSON_simdGetPath();
+
+JsonSimdPath JSON_simdBestPath();
+
+bool JSON_simdPathSupported(JsonSimdPath path);
+
+// e.g. "SSE4.2"
+const char* JSON_simdPathName(JsonSimdPath path);
+
+// for all handles, not while any of them parses; false if the CPU doesn't have it
+bool JSON_simdSetPath(JsonSimdPath path);
+
+// format an error record the way it is logged, returns text
+const char* JSON_errorText(const JsonErrorInfo* pError, char* text, size_t size);
+
+// log at most messagesPerSecond messages of all handles (0: none), the rest is counted as suppressed
+void JSON_logSetRateLimit(uint32_t messagesPerSecond);
+
+// wait until the background thread has written all messages logged so far
+void JSON_logFlush();
 
 
 #endif /* JSONWRAPPER_H_ */
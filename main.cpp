@@ -5,8 +5,14 @@
 #include <algorithm>
 #include <array>
 #include <cstddef>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <cstring>
 
-#include <boost/timer/timer.hpp>
+#include "benchmarkHarness.h"
+#include "benchmarkWorkload.h"
 
 /*
  * Changes assertion behaviour of json.
@@ -43,7 +49,6 @@ class exception {
 
 #include "nlohmann/json.hpp"
 
-constexpr int LOOP_CNT = 1000000;
 constexpr int MAX_IP = 4;
 
 struct __attribute__((packed, aligned(4))) Dhcp {
@@ -71,12 +76,33 @@ const char json_ipcfg_extended[] = "{\"schemaVersion\":1,\"dynamicHostControlPro
 
 #include "getmember.h"
 #include "getvalue.h"
+#include "jsonBind.h"
 
-void parseIPCfgWithOriginal() {
+// IpCfg described once, JsonBinder<IpCfg> is generated from it
+template<> struct JsonBinding<Numbers> {
+    static constexpr auto fields = std::make_tuple(
+                                       JSON_bindField("addr", &Numbers::addr),
+                                       JSON_bindField("mask", &Numbers::mask));
+};
+
+template<> struct JsonBinding<Dhcp> {
+    static constexpr auto fields = std::make_tuple(
+                                       JSON_bindField("active",    &Dhcp::active),
+                                       JSON_bindField("interface", &Dhcp::interface));
+};
+
+template<> struct JsonBinding<IpCfg> {
+    static constexpr auto fields = std::make_tuple(
+                                       JSON_bindField("schemaVersion", &IpCfg::schemaVersion),
+                                       JSON_bindField("dhcp",          &IpCfg::dhcp),
+                                       JSON_bindArray("ip",            &IpCfg::ip, &IpCfg::n));
+};
+
+void parseIPCfgWithOriginal(size_t count) {
     //char abuffer[0x10000];
     char pbuffer[1000];
 
-    for(int i = 0; i < LOOP_CNT; i++) {
+    for(size_t i = 0; i < count; i++) {
         //rapidjson::MemoryPoolAllocator<> mpa(&abuffer[0], sizeof(abuffer));
         rapidjson::Document document; //(&mpa);
 
@@ -111,11 +137,11 @@ void parseIPCfgWithOriginal() {
     }
 }
 
-void parseIPCfgWithTemplate() {
+void parseIPCfgWithTemplate(size_t count) {
     char abuffer[0x10000];
     char pbuffer[1000];
 
-    for(int i = 0; i < LOOP_CNT; i++) {
+    for(size_t i = 0; i < count; i++) {
         rapidjson::MemoryPoolAllocator<> mpa(&abuffer[0], sizeof(abuffer));
         rapidjson::Document document(&mpa);
 
@@ -124,31 +150,30 @@ void parseIPCfgWithTemplate() {
         if(document.ParseInsitu(pbuffer).HasParseError()) {
             std::cout << "Error parsing" << std::endl;
         } else {
-            rapidjson::Value obj;
+            JsonObjectView obj;
 
-            GetMember(document, "schemaVersion", &myipcfg.schemaVersion);
-            if(GetMember(document, "dhcp", obj)) {
-                GetMember(obj, "active", &myipcfg.dhcp.active);
-                GetMember(obj, "interface", &myipcfg.dhcp.interface);
+            GetMember(document, JSON_KEY("schemaVersion"), &myipcfg.schemaVersion);
+            if(GetMember(document, JSON_KEY("dhcp"), obj)) {
+                GetMember(obj, JSON_KEY("active"), &myipcfg.dhcp.active);
+                GetMember(obj, JSON_KEY("interface"), &myipcfg.dhcp.interface);
             }
 
-            rapidjson::SizeType n;
-            rapidjson::Value array[MAX_IP];
-            if(GetMember(document, "ip", &array[0], MAX_IP, n)) {
-                for(rapidjson::SizeType i = 0; i < n; ++i) {
-                    GetMember(array[i], "addr", &myipcfg.ip[i].addr);
-                    GetMember(array[i], "mask", &myipcfg.ip[i].mask);
+            JsonArrayView<rapidjson::Value> array;
+            if(GetMember(document, JSON_KEY("ip"), array, MAX_IP)) {
+                for(rapidjson::SizeType i = 0; i < array.Size(); ++i) {
+                    GetMember(array[i], JSON_KEY("addr"), &myipcfg.ip[i].addr);
+                    GetMember(array[i], JSON_KEY("mask"), &myipcfg.ip[i].mask);
                 }
             }
         }
     }
 }
 
-void parseIPCfgWithOverload() {
+void parseIPCfgWithOverload(size_t count) {
     char abuffer[0x10000];
     char pbuffer[1000];
 
-    for(int i = 0; i < LOOP_CNT; i++) {
+    for(size_t i = 0; i < count; i++) {
         rapidjson::MemoryPoolAllocator<> mpa(&abuffer[0], sizeof(abuffer));
         rapidjson::Document document(&mpa);
 
@@ -157,31 +182,36 @@ void parseIPCfgWithOverload() {
         if(document.ParseInsitu(pbuffer).HasParseError()) {
             std::cout << "Error parsing" << std::endl;
         } else {
-            rapidjson::Value obj;
+            // the members are read in the order they are sent
+            JsonValueCursor cursor(document);
+            JsonObjectView obj;
 
-            GetValue(document, "schemaVersion", &myipcfg.schemaVersion);
-            if(GetValue(document, "dhcp", obj)) {
-                GetValue(obj, "active", &myipcfg.dhcp.active);
-                GetValue(obj, "interface", &myipcfg.dhcp.interface);
+            GetValue(cursor, JSON_KEY("schemaVersion"), &myipcfg.schemaVersion);
+            if(GetValue(cursor, JSON_KEY("dhcp"), obj)) {
+                JsonValueCursor objCursor(obj);
+
+                GetValue(objCursor, JSON_KEY("active"), &myipcfg.dhcp.active);
+                GetValue(objCursor, JSON_KEY("interface"), &myipcfg.dhcp.interface);
             }
 
-            rapidjson::SizeType n;
-            rapidjson::Value array[MAX_IP];
-            if(GetValue(document, "ip", &array[0], MAX_IP, n)) {
-                for(rapidjson::SizeType i = 0; i < n; ++i) {
-                    GetValue(array[i], "addr", &myipcfg.ip[i].addr);
-                    GetValue(array[i], "mask", &myipcfg.ip[i].mask);
+            JsonArrayView<rapidjson::Value> array;
+            if(GetValue(cursor, JSON_KEY("ip"), array, MAX_IP)) {
+                for(rapidjson::SizeType i = 0; i < array.Size(); ++i) {
+                    JsonValueCursor ipCursor(array[i]);
+
+                    GetValue(ipCursor, JSON_KEY("addr"), &myipcfg.ip[i].addr);
+                    GetValue(ipCursor, JSON_KEY("mask"), &myipcfg.ip[i].mask);
                 }
             }
         }
     }
 }
 
-void parseIPCfgWithOverloadExt() {
+void parseIPCfgWithOverloadExt(size_t count) {
     char abuffer[0x10000];
     char pbuffer[1000];
 
-    for(int i = 0; i < LOOP_CNT; i++) {
+    for(size_t i = 0; i < count; i++) {
         rapidjson::MemoryPoolAllocator<> mpa(&abuffer[0], sizeof(abuffer));
         rapidjson::Document document(&mpa);
 
@@ -190,31 +220,30 @@ void parseIPCfgWithOverloadExt() {
         if(document.ParseInsitu(pbuffer).HasParseError()) {
             std::cout << "Error parsing" << std::endl;
         } else {
-            rapidjson::Value obj;
+            JsonObjectView obj;
 
-            GetValue(document, "schemaVersion", &myipcfg.schemaVersion);
-            if(GetValue(document, "dynamicHostControlProtocol", obj)) {
-                GetValue(obj, "active", &myipcfg.dhcp.active);
-                GetValue(obj, "interface", &myipcfg.dhcp.interface);
+            GetValue(document, JSON_KEY("schemaVersion"), &myipcfg.schemaVersion);
+            if(GetValue(document, JSON_KEY("dynamicHostControlProtocol"), obj)) {
+                GetValue(obj, JSON_KEY("active"), &myipcfg.dhcp.active);
+                GetValue(obj, JSON_KEY("interface"), &myipcfg.dhcp.interface);
             }
 
-            rapidjson::SizeType n;
-            rapidjson::Value array[MAX_IP];
-            if(GetValue(document, "ipV4", &array[0], MAX_IP, n)) {
-                for(rapidjson::SizeType i = 0; i < n; ++i) {
-                    GetValue(array[i], "address", &myipcfg.ip[i].addr);
-                    GetValue(array[i], "netmask", &myipcfg.ip[i].mask);
+            JsonArrayView<rapidjson::Value> array;
+            if(GetValue(document, JSON_KEY("ipV4"), array, MAX_IP)) {
+                for(rapidjson::SizeType i = 0; i < array.Size(); ++i) {
+                    GetValue(array[i], JSON_KEY("address"), &myipcfg.ip[i].addr);
+                    GetValue(array[i], JSON_KEY("netmask"), &myipcfg.ip[i].mask);
                 }
             }
         }
     }
 }
 
-void parseIPCfgWithOverloadShort() {
+void parseIPCfgWithOverloadShort(size_t count) {
     char abuffer[0x10000];
     char pbuffer[1000];
 
-    for(int i = 0; i < LOOP_CNT; i++) {
+    for(size_t i = 0; i < count; i++) {
         rapidjson::MemoryPoolAllocator<> mpa(&abuffer[0], sizeof(abuffer));
         rapidjson::Document document(&mpa);
 
@@ -223,31 +252,30 @@ void parseIPCfgWithOverloadShort() {
         if(document.ParseInsitu(pbuffer).HasParseError()) {
             std::cout << "Error parsing" << std::endl;
         } else {
-            rapidjson::Value obj;
+            JsonObjectView obj;
 
-            GetValue(document, "v", &myipcfg.schemaVersion);
-            if(GetValue(document, "dhcp", obj)) {
-                GetValue(obj, "a", &myipcfg.dhcp.active);
-                GetValue(obj, "i", &myipcfg.dhcp.interface);
+            GetValue(document, JSON_KEY("v"), &myipcfg.schemaVersion);
+            if(GetValue(document, JSON_KEY("dhcp"), obj)) {
+                GetValue(obj, JSON_KEY("a"), &myipcfg.dhcp.active);
+                GetValue(obj, JSON_KEY("i"), &myipcfg.dhcp.interface);
             }
 
-            rapidjson::SizeType n;
-            rapidjson::Value array[MAX_IP];
-            if(GetValue(document, "ipV4", &array[0], MAX_IP, n)) {
-                for(rapidjson::SizeType i = 0; i < n; ++i) {
-                    GetValue(array[i], "a", &myipcfg.ip[i].addr);
-                    GetValue(array[i], "n", &myipcfg.ip[i].mask);
+            JsonArrayView<rapidjson::Value> array;
+            if(GetValue(document, JSON_KEY("ipV4"), array, MAX_IP)) {
+                for(rapidjson::SizeType i = 0; i < array.Size(); ++i) {
+                    GetValue(array[i], JSON_KEY("a"), &myipcfg.ip[i].addr);
+                    GetValue(array[i], JSON_KEY("n"), &myipcfg.ip[i].mask);
                 }
             }
         }
     }
 }
 
-void parseIPCfgWithIndexException() {
+void parseIPCfgWithIndexException(size_t count) {
     char abuffer[0x10000];
     char pbuffer[1000];
 
-    for(int i = 0; i < LOOP_CNT; i++) {
+    for(size_t i = 0; i < count; i++) {
         rapidjson::MemoryPoolAllocator<> mpa(&abuffer[0], sizeof(abuffer));
         rapidjson::Document document(&mpa);
 
@@ -275,11 +303,11 @@ void parseIPCfgWithIndexException() {
     }
 }
 
-void parseIPCfgWithFindException() {
+void parseIPCfgWithFindException(size_t count) {
     char abuffer[0x10000];
     char pbuffer[1000];
 
-    for(int i = 0; i < LOOP_CNT; i++) {
+    for(size_t i = 0; i < count; i++) {
         rapidjson::MemoryPoolAllocator<> mpa(&abuffer[0], sizeof(abuffer));
         rapidjson::Document document(&mpa);
 
@@ -306,14 +334,13 @@ void parseIPCfgWithFindException() {
     }
 }
 
-void parseIPCfgWithTable() {
-    char pbuffer[1000];
-
+// register the interpreter of IpCfg
+ParserHandle newIPCfgParser() {
     ParserHandle jsonParserHandle = JSON_parserNew();
 
     if (jsonParserHandle == NULL) {
         std::cout << "JSON_documentNew failed\n";
-        return;
+        return NULL;
     }
 
     InterpreterObjectHandle objHandleIp = JSON_parserNewObject(jsonParserHandle, "ip");
@@ -332,21 +359,466 @@ void parseIPCfgWithTable() {
     JSON_parserObjectAddMember(objHandleRoot, "dhcp",          JSON_OBJECT,      offsetof(IpCfg, dhcp),          sizeof(IpCfg::dhcp));
     JSON_parserObjectAddMember(objHandleRoot, "ip",            JSON_OBJECTARRAY, offsetof(IpCfg, ip),            sizeof(IpCfg::ip[0]));
 
-    myipcfg.n = MAX_IP;  // Set usable element count
+    return jsonParserHandle;
+}
+
+// a compiled parser decoding in mode, NULL on failure
+ParserHandle newIPCfgTableParser(JsonDecodeMode mode) {
+    ParserHandle jsonParserHandle = newIPCfgParser();
+
+    if (jsonParserHandle == NULL)
+        return NULL;
+
+    if (!JSON_parserCompile(jsonParserHandle) || !JSON_parserSetDecodeMode(jsonParserHandle, mode)) {
+        std::cout << "JSON_parserCompile failed\n";
+        JSON_parserDelete(jsonParserHandle);
+        return NULL;
+    }
+
+    return jsonParserHandle;
+}
+
+void parseIPCfgWithTable(ParserHandle jsonParserHandle, size_t count) {
+    char pbuffer[1000];
+
+    if (jsonParserHandle == NULL)
+        return;
+
+    for(size_t i = 0; i < count; i++) {
+        myipcfg.n = MAX_IP;  // Set usable element count
 
-    for(auto i = 0; i < LOOP_CNT; i++) {
         memcpy(pbuffer, json_ipcfg, sizeof(json_ipcfg));
 
         JSON_TextToBin(jsonParserHandle, pbuffer, (unsigned char*)&myipcfg, sizeof(myipcfg));
     }
+}
+
+// straight from the read-only text, as it comes from a receive buffer: no copy, no terminating 0
+void parseIPCfgWithTableN(ParserHandle jsonParserHandle, size_t count) {
+    if (jsonParserHandle == NULL)
+        return;
+
+    for(size_t i = 0; i < count; i++) {
+        myipcfg.n = MAX_IP;  // Set usable element count
+
+        JSON_TextToBinN(jsonParserHandle, json_ipcfg, sizeof(json_ipcfg) - 1, (unsigned char*)&myipcfg, sizeof(myipcfg));
+    }
+}
+
+// the same config, but dhcp.interface flips between 1 and 2 from message to message
+void parseIPCfgWithChange(ParserHandle jsonParserHandle, size_t count) {
+    char pbuffer[1000];
+    static const size_t interfacePos = strstr(json_ipcfg, "\"interface\":1") - json_ipcfg + strlen("\"interface\":");
+
+    if (jsonParserHandle == NULL)
+        return;
+
+    for(size_t i = 0; i < count; i++) {
+        myipcfg.n = MAX_IP;  // Set usable element count
+
+        memcpy(pbuffer, json_ipcfg, sizeof(json_ipcfg));
+        pbuffer[interfacePos] = i % 2 ? '2' : '1';
+
+        JSON_TextToBin(jsonParserHandle, pbuffer, (unsigned char*)&myipcfg, sizeof(myipcfg));
+    }
+}
+
+// a compiled parser whose decodes of a text are cached, NULL on failure
+ParserHandle newIPCfgCacheParser(JsonDecodeMode mode) {
+    ParserHandle jsonParserHandle = newIPCfgTableParser(mode);
+
+    if (jsonParserHandle != NULL && !JSON_parserSetDecodeCache(jsonParserHandle, 64 * 1024)) {
+        JSON_parserDelete(jsonParserHandle);
+        return NULL;
+    }
+
+    return jsonParserHandle;
+}
+
+// the DOM in a buffer of the application, as a PLC would set a static area aside for it
+alignas(8) static unsigned char arenaBuffer[32 * 1024];
+
+ParserHandle newIPCfgArenaParser(std::ostream& log) {
+    ParserHandle jsonParserHandle = newIPCfgTableParser(JSON_DECODE_DOM);
+
+    if (jsonParserHandle == NULL)
+        return NULL;
+
+    // a buffer that isn't 8 byte aligned or can't hold the chunk header is refused
+    if (JSON_parserSetArenaBuffer(jsonParserHandle, arenaBuffer + 4, sizeof(arenaBuffer) - 4)
+            || JSON_parserSetArenaBuffer(jsonParserHandle, arenaBuffer, 8))
+        log << "arena buffer: a misaligned or too small buffer was accepted" << std::endl;
+
+    // an odd size is cut down to whole blocks
+    if (!JSON_parserSetArenaBuffer(jsonParserHandle, arenaBuffer, sizeof(arenaBuffer) - 3)) {
+        std::cout << "JSON_parserSetArenaBuffer failed\n";
+        JSON_parserDelete(jsonParserHandle);
+        return NULL;
+    }
+
+    return jsonParserHandle;
+}
+
+void deleteIPCfgTableParser(ParserHandle jsonParserHandle, std::ostream& log) {
+    if (jsonParserHandle == NULL)
+        return;
+
+    JsonDecodeCacheStats cacheStats;
+    if (JSON_parserGetDecodeCacheStats(jsonParserHandle, &cacheStats))
+        log << "decode cache hits: " << cacheStats.hits << ", misses: " << cacheStats.misses << ", evictions: " << cacheStats.evictions
+            << ", entries: " << cacheStats.entries << ", " << cacheStats.bytes << " of " << cacheStats.capacity << " bytes" << std::endl;
+
+    JsonParserStats stats;
+    if (JSON_parserGetStats(jsonParserHandle, &stats))
+        log << "arena high-water: " << stats.arenaHighWater << " bytes, capacity: " << stats.arenaCapacity
+            << " bytes, heap allocations: " << stats.heapAllocations << ", realloc copies: " << stats.reallocCopies << std::endl;
 
     JSON_parserDelete(jsonParserHandle);
 }
 
-void parsen_nl_json() {
+// the layout of IpCfg an interpreter image is bound to
+constexpr uint64_t kIpCfgLayout = JSON_layoutKey({sizeof(IpCfg), offsetof(IpCfg, schemaVersion), offsetof(IpCfg, dhcp),
+                                                  offsetof(IpCfg, n), offsetof(IpCfg, ip), sizeof(Dhcp), offsetof(Dhcp, active),
+                                                  offsetof(Dhcp, interface), sizeof(Numbers), offsetof(Numbers, addr),
+                                                  offsetof(Numbers, mask)});
+
+// the interpreter saved as an image, as it would be read from flash at the next start
+struct IPCfgImage {
+    std::vector<uint64_t>		image;			// 8 byte aligned
+    FrozenInterpreterHandle		hFrozen;
+    ParserHandle				jsonParserHandle;
+    double						buildMicros;	// registering and compiling the interpreter
+    double						loadMicros;		// checking the image and using it
+};
+
+bool newIPCfgImage(IPCfgImage& image) {
+    auto buildStart = std::chrono::steady_clock::now();
+    ParserHandle builder = newIPCfgTableParser(JSON_DECODE_DOM);
+    auto buildEnd = std::chrono::steady_clock::now();
+
+    if (builder == NULL)
+        return false;
+
+    size_t imageSize = JSON_interpreterSaveImage(builder, kIpCfgLayout, NULL, 0);
+
+    image.image.assign((imageSize + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+    JSON_interpreterSaveImage(builder, kIpCfgLayout, image.image.data(), imageSize);
+    JSON_parserDelete(builder);
+
+    auto loadStart = std::chrono::steady_clock::now();
+    image.hFrozen = JSON_interpreterUseImage(image.image.data(), imageSize, kIpCfgLayout);
+    auto loadEnd = std::chrono::steady_clock::now();
+
+    image.buildMicros = std::chrono::duration<double, std::micro>(buildEnd - buildStart).count();
+    image.loadMicros = std::chrono::duration<double, std::micro>(loadEnd - loadStart).count();
+
+    if (image.hFrozen == NULL)
+        return false;
+
+    image.jsonParserHandle = JSON_parserNewFrozen(image.hFrozen);
+    JSON_parserSetDecodeMode(image.jsonParserHandle, JSON_DECODE_SAX);
+
+    return true;
+}
+
+void deleteIPCfgImage(IPCfgImage& image, std::ostream& log) {
+    if (image.hFrozen == NULL)
+        return;
+
+    log << "interpreter image: " << image.image.size() * sizeof(uint64_t) << " bytes, registered and compiled in "
+        << image.buildMicros << " us, loaded in " << image.loadMicros << " us" << std::endl;
+
+    deleteIPCfgTableParser(image.jsonParserHandle, log);
+    JSON_interpreterRelease(image.hFrozen);
+    image.jsonParserHandle = NULL;
+    image.hFrozen = NULL;
+}
+
+// stored device configs replayed at startup, decoded in batches on threadCount threads
+constexpr size_t BATCH_SIZE = 10000;
+
+struct IPCfgBatch {
+    ParserHandle				jsonParserHandle;
+    std::vector<const char*>	texts;
+    std::vector<size_t>			lengths;
+    std::vector<IpCfg>			cfgs;
+    std::vector<uint32_t>		results;
+    size_t						failed;
+};
+
+bool newIPCfgBatch(IPCfgBatch& batch, unsigned int threadCount) {
+    batch.jsonParserHandle = newIPCfgParser();
+
+    if (batch.jsonParserHandle == NULL)
+        return false;
+
+    if (!JSON_parserCompile(batch.jsonParserHandle) || !JSON_parserSetBatchThreads(batch.jsonParserHandle, threadCount)) {
+        std::cout << "JSON_parserCompile failed\n";
+        JSON_parserDelete(batch.jsonParserHandle);
+        batch.jsonParserHandle = NULL;
+        return false;
+    }
+
+    batch.texts.assign(BATCH_SIZE, json_ipcfg);
+    batch.lengths.assign(BATCH_SIZE, sizeof(json_ipcfg) - 1);
+    batch.cfgs.resize(BATCH_SIZE);
+    batch.results.resize(BATCH_SIZE);
+    batch.failed = 0;
+
+    return true;
+}
+
+void parseIPCfgBatch(IPCfgBatch& batch, size_t count) {
+    if (batch.jsonParserHandle == NULL)
+        return;
+
+    for(size_t done = 0; done < count; done += BATCH_SIZE) {
+        size_t messages = std::min(BATCH_SIZE, count - done);
+
+        for (size_t i = 0; i < messages; i++)
+            batch.cfgs[i].n = MAX_IP;  // Set usable element count
+
+        batch.failed += JSON_TextToBinBatch(batch.jsonParserHandle, batch.texts.data(), batch.lengths.data(),
+                                            (unsigned char*)batch.cfgs.data(), sizeof(IpCfg), messages, batch.results.data());
+    }
+
+    myipcfg = batch.cfgs.front();
+}
+
+void deleteIPCfgBatch(IPCfgBatch& batch, std::ostream& log) {
+    if (batch.jsonParserHandle == NULL)
+        return;
+
+    if (batch.failed != 0)
+        log << batch.failed << " messages failed" << std::endl;
+
+    JSON_parserDelete(batch.jsonParserHandle);
+    batch.jsonParserHandle = NULL;
+}
+
+// a receive buffer of a gateway: FRAME_SIZE configs back to back, decoded with one call
+constexpr size_t FRAME_SIZE = 16;
+
+struct IPCfgFrame {
+    ParserHandle			jsonParserHandle;
+    std::string				text;
+    std::vector<IpCfg>		cfgs;
+    std::vector<uint32_t>	results;
+    size_t					failed;
+};
+
+bool newIPCfgFrame(IPCfgFrame& frame) {
+    frame.jsonParserHandle = newIPCfgTableParser(JSON_DECODE_SAX);
+
+    if (frame.jsonParserHandle == NULL)
+        return false;
+
+    frame.text.clear();
+
+    for (size_t i = 0; i < FRAME_SIZE; i++)
+        frame.text.append(json_ipcfg).append("\n");
+
+    frame.cfgs.resize(FRAME_SIZE);
+    frame.results.resize(FRAME_SIZE);
+    frame.failed = 0;
+
+    return true;
+}
+
+void parseIPCfgFrame(IPCfgFrame& frame, size_t count) {
+    if (frame.jsonParserHandle == NULL)
+        return;
+
+    for(size_t done = 0; done < count; done += FRAME_SIZE) {
+        size_t messages = std::min(FRAME_SIZE, count - done);
+        size_t consumed;
+
+        for (size_t i = 0; i < messages; i++)
+            frame.cfgs[i].n = MAX_IP;  // Set usable element count
+
+        // each message is the config and its newline
+        size_t decoded = JSON_TextToBinFrame(frame.jsonParserHandle, frame.text.data(), messages * sizeof(json_ipcfg),
+                                             (unsigned char*)frame.cfgs.data(), sizeof(IpCfg), messages, frame.results.data(), &consumed);
+
+        frame.failed += messages - decoded;
+
+        for (size_t i = 0; i < decoded; i++)
+            if (frame.results[i] != 0)
+                frame.failed++;
+    }
+
+    myipcfg = frame.cfgs.front();
+}
+
+void deleteIPCfgFrame(IPCfgFrame& frame, std::ostream& log) {
+    if (frame.jsonParserHandle == NULL)
+        return;
+
+    if (frame.failed != 0)
+        log << frame.failed << " messages failed" << std::endl;
+
+    deleteIPCfgTableParser(frame.jsonParserHandle, log);
+    frame.jsonParserHandle = NULL;
+}
+
+// a device log replayed: the lines of --lines FILE, BATCH_SIZE configs of json_ipcfg without it
+struct IPCfgLines {
+    ParserHandle			jsonParserHandle;
+    LinesHandle				linesHandle;
+    std::string				text;
+    std::vector<IpCfg>		cfgs;
+    std::vector<uint32_t>	results;
+    size_t					next;		// the first line of the next run, wraps around
+    size_t					failed;
+};
+
+bool newIPCfgLines(IPCfgLines& lines, const std::string& path) {
+    lines.jsonParserHandle = newIPCfgTableParser(JSON_DECODE_SAX);
+
+    if (lines.jsonParserHandle == NULL)
+        return false;
+
+    if (path.empty()) {
+        lines.text.clear();
+
+        for (size_t i = 0; i < BATCH_SIZE; i++)
+            lines.text.append(json_ipcfg).append("\n");
+
+        lines.linesHandle = JSON_linesOpenText(lines.text.data(), lines.text.size());
+    }
+    else
+        lines.linesHandle = JSON_linesOpen(path.c_str());
+
+    if (lines.linesHandle == NULL || JSON_linesCount(lines.linesHandle) == 0) {
+        JSON_linesClose(lines.linesHandle);
+        JSON_parserDelete(lines.jsonParserHandle);
+        lines.linesHandle = NULL;
+        lines.jsonParserHandle = NULL;
+        return false;
+    }
+
+    lines.cfgs.resize(BATCH_SIZE);
+    lines.results.resize(BATCH_SIZE);
+    lines.next = 0;
+    lines.failed = 0;
+
+    return true;
+}
+
+void parseIPCfgLines(IPCfgLines& lines, size_t count) {
+    if (lines.jsonParserHandle == NULL)
+        return;
+
+    size_t lineCount = JSON_linesCount(lines.linesHandle);
+
+    for(size_t done = 0; done < count;) {
+        size_t messages = std::min(std::min(BATCH_SIZE, count - done), lineCount - lines.next);
+
+        for (size_t i = 0; i < messages; i++)
+            lines.cfgs[i].n = MAX_IP;  // Set usable element count
+
+        lines.failed += JSON_TextToBinLines(lines.jsonParserHandle, lines.linesHandle, lines.next, messages,
+                                            (unsigned char*)lines.cfgs.data(), sizeof(IpCfg), lines.results.data());
+
+        lines.next = (lines.next + messages) % lineCount;
+        done += messages;
+    }
+
+    myipcfg = lines.cfgs.front();
+}
+
+void deleteIPCfgLines(IPCfgLines& lines, std::ostream& log) {
+    if (lines.jsonParserHandle == NULL)
+        return;
+
+    log << JSON_linesCount(lines.linesHandle) << " lines";
+
+    if (lines.failed != 0)
+        log << ", " << lines.failed << " messages failed";
+
+    log << std::endl;
+
+    JSON_linesClose(lines.linesHandle);
+    JSON_parserDelete(lines.jsonParserHandle);
+    lines.linesHandle = NULL;
+    lines.jsonParserHandle = NULL;
+}
+
+std::string jsonOut;
+
+// one binder for all messages, as the parser handles of the Table variants
+JsonBinder<IpCfg> ipcfgBinder;
+
+void parseIPCfgWithBinding(size_t count) {
+    char pbuffer[1000];
+
+    for(size_t i = 0; i < count; i++) {
+        memcpy(pbuffer, json_ipcfg, sizeof(json_ipcfg));
+
+        ipcfgBinder.TextToBin(pbuffer, myipcfg);
+    }
+}
+
+void writeIPCfgWithBinding(size_t count) {
+    for(size_t i = 0; i < count; i++)
+        ipcfgBinder.BinToText(myipcfg);
+
+    jsonOut = ipcfgBinder.GetString();
+}
+
+// a parser encoding in mode, NULL on failure
+ParserHandle newIPCfgWriter(JsonEncodeMode mode) {
+    ParserHandle jsonParserHandle = newIPCfgParser();
+
+    if (jsonParserHandle == NULL)
+        return NULL;
+
+    if (!JSON_parserSetEncodeMode(jsonParserHandle, mode)) {
+        std::cout << "JSON_parserSetEncodeMode failed\n";
+        JSON_parserDelete(jsonParserHandle);
+        return NULL;
+    }
+
+    return jsonParserHandle;
+}
+
+void writeIPCfgWithTable(ParserHandle jsonParserHandle, size_t count) {
+    if (jsonParserHandle == NULL)
+        return;
+
+    const char* pOut = NULL;
+
+    for(size_t i = 0; i < count; i++) {
+        JSON_BinToText(jsonParserHandle, (unsigned char*)&myipcfg);
+
+        pOut = JSON_getOutString(jsonParserHandle);
+    }
+
+    jsonOut = pOut;
+}
+
+// like a PLC that changed a single value since the last cycle
+void writeIPCfgWithChange(ParserHandle jsonParserHandle, size_t count) {
+    if (jsonParserHandle == NULL)
+        return;
+
+    const char* pOut = NULL;
+
+    for(size_t i = 0; i < count; i++) {
+        myipcfg.dhcp.interface = i % 2 ? 2 : 1;
+
+        JSON_BinToText(jsonParserHandle, (unsigned char*)&myipcfg);
+
+        pOut = JSON_getOutString(jsonParserHandle);
+    }
+
+    jsonOut = pOut;
+}
+
+void parsen_nl_json(size_t count) {
     char pbuffer[1000];
 
-    for(auto i = 0; i < LOOP_CNT; i++) {
+    for(size_t i = 0; i < count; i++) {
         memcpy(pbuffer, json_ipcfg, sizeof(json_ipcfg));
 
         try {
@@ -365,111 +837,655 @@ void parsen_nl_json() {
     }
 }
 
-void output(const char *title) {
-    std::cout << title << "schemaVersion:" << myipcfg.schemaVersion
-              << " dhcp.active:" << myipcfg.dhcp.active << " dhcp.interface:" << myipcfg.dhcp.interface
-              << " ip[0].addr:" << myipcfg.ip[0].addr << " ip[0].mask:" << myipcfg.ip[0].mask
-              << " ip[1].addr:" << myipcfg.ip[1].addr << " ip[1].mask:" << myipcfg.ip[1].mask
-              << std::endl << "+++" << std::endl;
+// a generated document decoded over and over, by a parser (or by rapidjson alone if there's none)
+struct WorkloadRun {
+    const Workload*				pWorkload;
+    bool						withParser;
+    ParserHandle				jsonParserHandle;
+    std::vector<char>			text;
+    std::vector<unsigned char>	bin;
+    size_t						failed;
+};
+
+void newWorkloadRun(WorkloadRun& run, const Workload& workload, bool withParser, JsonDecodeMode mode) {
+    run.pWorkload = &workload;
+    run.withParser = withParser;
+    run.jsonParserHandle = NULL;
+    run.text.resize(workload.text.size() + 1);
+    run.bin.assign(workload.binSize, 0);
+    run.failed = 0;
+
+    if (!withParser)
+        return;
+
+    run.jsonParserHandle = WorkloadNewParser(workload);
+
+    if (run.jsonParserHandle == NULL)
+        return;
+
+    if (!JSON_parserCompile(run.jsonParserHandle) || !JSON_parserSetDecodeMode(run.jsonParserHandle, mode)) {
+        std::cout << "JSON_parserCompile failed\n";
+        JSON_parserDelete(run.jsonParserHandle);
+        run.jsonParserHandle = NULL;
+    }
 }
 
-int main(int, char**) {
-    std::cout << "JSON string to parse: " << &json_ipcfg[0]
-              << std::endl << "+++" << std::endl;
+void parseWorkload(WorkloadRun& run, size_t count) {
+    const Workload& workload = *run.pWorkload;
 
-    {
-        memset(&myipcfg, 0, sizeof(myipcfg));
+    if (run.withParser && run.jsonParserHandle == NULL) {
+        run.failed += count;
+        return;
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        memcpy(run.text.data(), workload.text.c_str(), workload.text.size() + 1);
 
-        boost::timer::auto_cpu_timer act;
+        if (!run.withParser) {
+            rapidjson::Document document;
 
-        parseIPCfgWithOriginal();
+            if(document.ParseInsitu(run.text.data()).HasParseError())
+                run.failed++;
+
+            continue;
+        }
+
+        WorkloadResetBin(workload, run.bin.data());
+
+        if (JSON_TextToBin(run.jsonParserHandle, run.text.data(), run.bin.data(), workload.binSize) != 0)
+            run.failed++;
     }
+}
 
-    output("Original - ");
+void deleteWorkloadRun(WorkloadRun& run, std::ostream& log, const std::string& name) {
+    log << name << " - " << run.pWorkload->text.size() << " bytes, " << run.failed << " failed";
 
-    {
-        memset(&myipcfg, 0, sizeof(myipcfg));
+    if (run.jsonParserHandle)
+        log << ", entries: " << ((WorkloadRoot*)run.bin.data())->entryCount;
+
+    log << std::endl << "+++" << std::endl;
+
+    if (run.jsonParserHandle)
+        JSON_parserDelete(run.jsonParserHandle);
+
+    run.jsonParserHandle = NULL;
+    run.text = std::vector<char>();
+    run.bin = std::vector<unsigned char>();
+}
+
+// "2,100,10000" (each at least min)
+bool parseCountList(const char* text, std::vector<uint32_t>& counts, uint32_t min) {
+    counts.clear();
 
-        boost::timer::auto_cpu_timer act;
+    while (*text) {
+        char* pEnd;
+        unsigned long value = strtoul(text, &pEnd, 10);
 
-        parseIPCfgWithTemplate();
+        if (pEnd == text || value < min || value > 100000000ul || (*pEnd != ',' && *pEnd != 0))
+            return false;
+
+        counts.push_back((uint32_t)value);
+        text = *pEnd ? pEnd + 1 : pEnd;
     }
 
-    output("Template - ");
+    return !counts.empty();
+}
 
-    {
-        memset(&myipcfg, 0, sizeof(myipcfg));
+// per document and mode, the median of each scan path against the scalar one
+void logSimdSpeedups(std::ostream& log, const std::vector<BenchmarkResult>& results, const std::vector<std::string>& runs) {
+    auto find = [&results](const std::string& name) -> const BenchmarkResult* {
+        for (auto& result : results)
+            if (result.name == name)
+                return &result;
+        return NULL;
+    };
+
+    for (auto& run : runs) {
+        const BenchmarkResult* pScalar = find(std::string("SIMD-") + JSON_simdPathName(JSON_SIMD_SCALAR) + "/" + run);
+
+        if (pScalar == NULL)
+            continue;
 
-        boost::timer::auto_cpu_timer act;
+        log << "SIMD speedup " << run << ":";
 
-        parseIPCfgWithOverload();
+        for (int path = JSON_SIMD_SCALAR + 1; path < JSON_SIMD_PATH_COUNT; path++) {
+            const BenchmarkResult* pResult = find(std::string("SIMD-") + JSON_simdPathName((JsonSimdPath)path) + "/" + run);
+
+            if (pResult) {
+                char speedup[32];
+
+                snprintf(speedup, sizeof(speedup), "%.2fx", pScalar->medianNs / pResult->medianNs);
+                log << " " << JSON_simdPathName((JsonSimdPath)path) << " " << speedup;
+            }
+        }
+
+        log << std::endl;
     }
+}
+
+void output(std::ostream& log, const char *title) {
+    log << title << "schemaVersion:" << myipcfg.schemaVersion
+        << " dhcp.active:" << myipcfg.dhcp.active << " dhcp.interface:" << myipcfg.dhcp.interface
+        << " ip[0].addr:" << myipcfg.ip[0].addr << " ip[0].mask:" << myipcfg.ip[0].mask
+        << " ip[1].addr:" << myipcfg.ip[1].addr << " ip[1].mask:" << myipcfg.ip[1].mask
+        << std::endl << "+++" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    BenchmarkHarness harness;
+
+    // the grid of generated documents, only run if --entries is given
+    std::vector<uint32_t> entryCounts;
+    std::vector<uint32_t> widths = {4};
+    std::vector<uint32_t> depths = {0};
+    std::vector<WorkloadKeys> keyProfiles = {WORKLOAD_KEYS_NORMAL};
+    uint32_t unknownPercent = 0;
+    uint32_t stringPercent = 0;
+    uint32_t doublePercent = 0;
+    // a JSON Lines file of IpCfg messages for Table-Lines
+    std::string linesPath;
+
+    auto workloadOption = [&](const char* option, const char* value) {
+        std::vector<uint32_t> percent;
+
+        if (strcmp(option, "--entries") == 0)
+            return parseCountList(value, entryCounts, 1);
+        if (strcmp(option, "--width") == 0)
+            return parseCountList(value, widths, 1);
+        if (strcmp(option, "--depth") == 0)
+            return parseCountList(value, depths, 0);
+        if (strcmp(option, "--lines") == 0) {
+            linesPath = value;
+            return true;
+        }
+
+        if (strcmp(option, "--keys") == 0) {
+            std::string list(value);
+            size_t start = 0;
 
-    output("Overload - ");
+            keyProfiles.clear();
 
-    {
+            for (;;) {
+                size_t end = list.find(',', start);
+                WorkloadKeys keys;
+
+                if (!WorkloadParseKeys(list.substr(start, end - start).c_str(), keys))
+                    return false;
+
+                keyProfiles.push_back(keys);
+
+                if (end == std::string::npos)
+                    return true;
+
+                start = end + 1;
+            }
+        }
+
+        if (!parseCountList(value, percent, 0) || percent.size() != 1 || percent[0] > 100)
+            return false;
+
+        if (strcmp(option, "--unknown") == 0)
+            unknownPercent = percent[0];
+        else if (strcmp(option, "--strings") == 0)
+            stringPercent = percent[0];
+        else if (strcmp(option, "--doubles") == 0)
+            doublePercent = percent[0];
+        else
+            return false;
+
+        return stringPercent + doublePercent <= 100;
+    };
+
+    const char* workloadUsage =
+        "       [--entries N,N,... [--width N,N,...] [--depth N,N,...] [--keys short|normal|extended,...]\n"
+        "        [--unknown PERCENT] [--strings PERCENT] [--doubles PERCENT]]  generated documents\n"
+        "       [--lines FILE]  a JSON Lines file of configs for Table-Lines";
+
+    if (!harness.ParseOptions(argc, argv, workloadOption, workloadUsage))
+        return 2;
+
+    std::ostream& log = harness.Log();
+
+    log << "JSON string to parse: " << &json_ipcfg[0] << std::endl
+        << "JSON long string to parse: " << &json_ipcfg_extended[0] << std::endl
+        << "JSON short string to parse: " << &json_ipcfg_short[0] << std::endl
+        << "SIMD path: " << JSON_simdPathName(JSON_simdGetPath()) << std::endl
+        << "+++" << std::endl;
+
+    // every decoder starts from zero, its result is printed once it's done
+    auto clear = []() {
         memset(&myipcfg, 0, sizeof(myipcfg));
+    };
+
+    auto check = [&log](const char* title) {
+        return [&log, title]() {
+            output(log, title);
+        };
+    };
+
+    // the encoders need a decoded config
+    auto load = []() {
+        parseIPCfgWithBinding(1);
+    };
+
+    auto checkText = [&log](const char* title) {
+        return [&log, title]() {
+            log << title << jsonOut << std::endl << "+++" << std::endl;
+        };
+    };
+
+    const size_t textSize = sizeof(json_ipcfg) - 1;
 
-        boost::timer::auto_cpu_timer act;
+    // the production path (JSON_TextToBin/JSON_BinToText on a warmed-up handle) must not touch the heap
+    const double noAllocations = 0;
 
-        parseIPCfgWithIndexException();
+    harness.Register({"Original", textSize, clear, parseIPCfgWithOriginal, check("Original - ")});
+    harness.Register({"Template", textSize, clear, parseIPCfgWithTemplate, check("Template - ")});
+    harness.Register({"Overload", textSize, clear, parseIPCfgWithOverload, check("Overload - ")});
+    harness.Register({"IndexException", textSize, clear, parseIPCfgWithIndexException, check("IndexException - ")});
+    harness.Register({"FindException", textSize, clear, parseIPCfgWithFindException, check("FindException - ")});
+
+    // the parser handles are set up and deleted outside the samples
+    const std::pair<const char*, JsonDecodeMode> tableModes[] = {
+        {"Table", JSON_DECODE_DOM},
+        {"Table-SAX", JSON_DECODE_SAX},
+        {"Table-SinglePass", JSON_DECODE_DOM_SINGLEPASS},
+        {"Table-Incremental", JSON_DECODE_INCREMENTAL}
+    };
+
+    ParserHandle tableParsers[4] = {NULL, NULL, NULL, NULL};
+
+    for (unsigned int modeIdx = 0; modeIdx < 4; modeIdx++) {
+        const char* name = tableModes[modeIdx].first;
+        JsonDecodeMode mode = tableModes[modeIdx].second;
+        ParserHandle& tableParser = tableParsers[modeIdx];
+
+        auto setUp = [clear, &tableParser, mode]() {
+            clear();
+            tableParser = newIPCfgTableParser(mode);
+        };
+
+        auto run = [&tableParser](size_t count) {
+            parseIPCfgWithTable(tableParser, count);
+        };
+
+        auto tearDown = [&log, &tableParser, name]() {
+            output(log, (std::string(name) + " - ").c_str());
+            deleteIPCfgTableParser(tableParser, log);
+            tableParser = NULL;
+        };
+
+        harness.Register({name, textSize, setUp, run, tearDown, 0, noAllocations});
     }
 
-    output("IndexException - ");
+    // the DOM in the application's buffer, the heap is never used
+    ParserHandle arenaParser = NULL;
 
-    {
-        memset(&myipcfg, 0, sizeof(myipcfg));
+    auto arenaSetUp = [clear, &log, &arenaParser]() {
+        clear();
+        arenaParser = newIPCfgArenaParser(log);
+    };
+
+    auto arenaRun = [&arenaParser](size_t count) {
+        parseIPCfgWithTable(arenaParser, count);
+    };
+
+    auto arenaTearDown = [&log, &arenaParser]() {
+        JsonParserStats stats;
+
+        output(log, "Table-ArenaBuffer - ");
+
+        if (arenaParser != NULL && JSON_parserGetStats(arenaParser, &stats) && stats.heapAllocations != 0)
+            log << "arena buffer: " << stats.heapAllocations << " chunks from the heap" << std::endl;
+
+        deleteIPCfgTableParser(arenaParser, log);
+        arenaParser = NULL;
+    };
+
+    harness.Register({"Table-ArenaBuffer", textSize, arenaSetUp, arenaRun, arenaTearDown, 0, noAllocations});
+
+    // the same without the copy of the text
+    const std::pair<const char*, JsonDecodeMode> spanModes[] = {
+        {"Table-N", JSON_DECODE_DOM},
+        {"Table-SAX-N", JSON_DECODE_SAX}
+    };
+
+    ParserHandle spanParsers[2] = {NULL, NULL};
+
+    for (unsigned int modeIdx = 0; modeIdx < 2; modeIdx++) {
+        const char* name = spanModes[modeIdx].first;
+        JsonDecodeMode mode = spanModes[modeIdx].second;
+        ParserHandle& spanParser = spanParsers[modeIdx];
 
-        boost::timer::auto_cpu_timer act;
+        auto setUp = [clear, &spanParser, mode]() {
+            clear();
+            spanParser = newIPCfgTableParser(mode);
+        };
 
-        parseIPCfgWithFindException();
+        auto run = [&spanParser](size_t count) {
+            parseIPCfgWithTableN(spanParser, count);
+        };
+
+        auto tearDown = [&log, &spanParser, name]() {
+            output(log, (std::string(name) + " - ").c_str());
+            deleteIPCfgTableParser(spanParser, log);
+            spanParser = NULL;
+        };
+
+        harness.Register({name, textSize, setUp, run, tearDown, 0, noAllocations});
     }
 
-    output("FindException - ");
+    // the config is resent byte by byte, every message but the first is a hit of the decode cache
+    ParserHandle cacheParser = NULL;
 
-    {
-        memset(&myipcfg, 0, sizeof(myipcfg));
+    auto cacheSetUp = [clear, &cacheParser]() {
+        clear();
+        cacheParser = newIPCfgCacheParser(JSON_DECODE_SAX);
+    };
+
+    auto cacheRun = [&cacheParser](size_t count) {
+        parseIPCfgWithTable(cacheParser, count);
+    };
+
+    auto cacheTearDown = [&log, &cacheParser]() {
+        output(log, "Table-Cache - ");
+        deleteIPCfgTableParser(cacheParser, log);
+        cacheParser = NULL;
+    };
+
+    harness.Register({"Table-Cache", textSize, cacheSetUp, cacheRun, cacheTearDown, 0, noAllocations});
+
+    // decoding with the interpreter of an image
+    IPCfgImage image = {};
+
+    auto imageSetUp = [clear, &image]() {
+        clear();
+        newIPCfgImage(image);
+    };
+
+    auto imageRun = [&image](size_t count) {
+        parseIPCfgWithTable(image.jsonParserHandle, count);
+    };
+
+    auto imageTearDown = [&log, &image]() {
+        output(log, "Table-Image - ");
+        deleteIPCfgImage(image, log);
+    };
+
+    harness.Register({"Table-Image", textSize, imageSetUp, imageRun, imageTearDown, 0, noAllocations});
+
+    // the config is resent unchanged above, here one value changes with every message
+    ParserHandle changeParser = NULL;
+
+    auto changeSetUp = [clear, &changeParser]() {
+        clear();
+        changeParser = newIPCfgTableParser(JSON_DECODE_INCREMENTAL);
+    };
+
+    auto changeRun = [&changeParser](size_t count) {
+        parseIPCfgWithChange(changeParser, count);
+    };
+
+    auto changeTearDown = [&log, &changeParser]() {
+        output(log, "Table-Incremental-Change - ");
+        deleteIPCfgTableParser(changeParser, log);
+        changeParser = NULL;
+    };
+
+    harness.Register({"Table-Incremental-Change", textSize, changeSetUp, changeRun, changeTearDown, 0, noAllocations});
+
+    // several configs in one buffer
+    IPCfgFrame frame = {};
+
+    auto frameSetUp = [clear, &frame]() {
+        clear();
+        newIPCfgFrame(frame);
+    };
+
+    auto frameRun = [&frame](size_t count) {
+        parseIPCfgFrame(frame, count);
+    };
+
+    auto frameTearDown = [&log, &frame]() {
+        output(log, "Table-Frame - ");
+        deleteIPCfgFrame(frame, log);
+    };
+
+    harness.Register({"Table-Frame", textSize, frameSetUp, frameRun, frameTearDown, 0, noAllocations});
+
+    // a log of configs, decoded with one thread per core
+    IPCfgLines lines = {};
+
+    auto linesSetUp = [clear, &lines, &linesPath]() {
+        clear();
+        newIPCfgLines(lines, linesPath);
+    };
+
+    auto linesRun = [&lines](size_t count) {
+        parseIPCfgLines(lines, count);
+    };
+
+    auto linesTearDown = [&log, &lines]() {
+        output(log, "Table-Lines - ");
+        deleteIPCfgLines(lines, log);
+    };
+
+    harness.Register({"Table-Lines", textSize, linesSetUp, linesRun, linesTearDown});
+
+    // 1, 2, 4 ... threads up to the number of cores
+    std::vector<unsigned int> threadCounts;
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned int threadCount = 1; threadCount < cores; threadCount *= 2)
+        threadCounts.push_back(threadCount);
+
+    threadCounts.push_back(cores);
+
+    std::vector<IPCfgBatch> batches(threadCounts.size());
+    std::vector<std::string> batchNames;
+
+    for (unsigned int threadCount : threadCounts)
+        batchNames.push_back("Table-Batch-" + std::to_string(threadCount));
 
-        boost::timer::auto_cpu_timer act;
+    for (size_t batchIdx = 0; batchIdx < threadCounts.size(); batchIdx++) {
+        IPCfgBatch& batch = batches[batchIdx];
+        const std::string& name = batchNames[batchIdx];
+        unsigned int threadCount = threadCounts[batchIdx];
 
-        parseIPCfgWithTable();
+        auto setUp = [clear, &batch, threadCount]() {
+            clear();
+            newIPCfgBatch(batch, threadCount);
+        };
+
+        auto run = [&batch](size_t count) {
+            parseIPCfgBatch(batch, count);
+        };
+
+        auto tearDown = [&log, &batch, &name]() {
+            output(log, (name + " - ").c_str());
+            deleteIPCfgBatch(batch, log);
+        };
+
+        harness.Register({name, textSize, setUp, run, tearDown});
     }
 
-    output("Table - ");
+    const std::pair<const char*, JsonEncodeMode> writeModes[] = {
+        {"Table-BinToText", JSON_ENCODE_DOM},
+        {"Table-Template", JSON_ENCODE_TEMPLATE},
+        {"Table-Delta", JSON_ENCODE_DELTA}
+    };
 
-    {
-        memset(&myipcfg, 0, sizeof(myipcfg));
+    ParserHandle writers[3] = {NULL, NULL, NULL};
+
+    for (unsigned int modeIdx = 0; modeIdx < 3; modeIdx++) {
+        const char* name = writeModes[modeIdx].first;
+        JsonEncodeMode mode = writeModes[modeIdx].second;
+        ParserHandle& writer = writers[modeIdx];
 
-        boost::timer::auto_cpu_timer act;
+        auto setUp = [load, &writer, mode]() {
+            load();
+            writer = newIPCfgWriter(mode);
+        };
 
-        parsen_nl_json();
+        auto run = [&writer](size_t count) {
+            writeIPCfgWithTable(writer, count);
+        };
+
+        auto tearDown = [&log, &writer, name]() {
+            log << name << " - " << jsonOut << std::endl << "+++" << std::endl;
+
+            if (writer)
+                JSON_parserDelete(writer);
+
+            writer = NULL;
+        };
+
+        harness.Register({name, textSize, setUp, run, tearDown, 0, noAllocations});
     }
 
-    output("NL-Json - ");
+    // one value changes from text to text, the delta holds it only
+    ParserHandle deltaWriter = NULL;
 
-    std::cout << "JSON long string to parse: " << &json_ipcfg_extended[0] << std::endl;
+    auto deltaSetUp = [load, &deltaWriter]() {
+        load();
+        deltaWriter = newIPCfgWriter(JSON_ENCODE_DELTA);
+    };
 
-    {
-        memset(&myipcfg, 0, sizeof(myipcfg));
+    auto deltaRun = [&deltaWriter](size_t count) {
+        writeIPCfgWithChange(deltaWriter, count);
+    };
+
+    auto deltaTearDown = [&log, &deltaWriter]() {
+        log << "Table-Delta-Change - " << jsonOut << std::endl << "+++" << std::endl;
+
+        if (deltaWriter)
+            JSON_parserDelete(deltaWriter);
+
+        deltaWriter = NULL;
+    };
+
+    harness.Register({"Table-Delta-Change", textSize, deltaSetUp, deltaRun, deltaTearDown, 0, noAllocations});
 
-        boost::timer::auto_cpu_timer act;
+    // the binder keeps its memory from message to message, it must not touch the heap either
+    harness.Register({"Binding", textSize, clear, parseIPCfgWithBinding, check("Binding - "), 0, noAllocations});
+    harness.Register({"Binding-BinToText", textSize, load, writeIPCfgWithBinding, checkText("Binding-BinToText - "), 0, noAllocations});
+    harness.Register({"NL-Json", textSize, clear, parsen_nl_json, check("NL-Json - ")});
+    harness.Register({"Overload-Ext", sizeof(json_ipcfg_extended) - 1, clear, parseIPCfgWithOverloadExt, check("Overload-Ext - ")});
+    harness.Register({"Overload-Short", sizeof(json_ipcfg_short) - 1, clear, parseIPCfgWithOverloadShort, check("Overload-Short - ")});
 
-        parseIPCfgWithOverloadExt();
+    // every point of the grid is decoded by rapidjson alone and by the interpreter in each mode,
+    // with as many messages per sample as make up about the JSON text of the fixed variants
+    std::vector<std::unique_ptr<Workload> > workloads;
+
+    for (uint32_t entryCount : entryCounts)
+        for (uint32_t width : widths)
+            for (uint32_t depth : depths)
+                for (WorkloadKeys keys : keyProfiles) {
+                    WorkloadProfile profile = {entryCount, width, depth, keys, unknownPercent, stringPercent, doublePercent, false};
+
+                    workloads.emplace_back(new Workload());
+                    WorkloadGenerate(profile, *workloads.back());
+                }
+
+    const std::pair<const char*, int> workloadModes[] = {
+        {"Parse", -1},
+        {"Table", JSON_DECODE_DOM},
+        {"Table-SAX", JSON_DECODE_SAX},
+        {"Table-SinglePass", JSON_DECODE_DOM_SINGLEPASS}
+    };
+
+    std::vector<WorkloadRun> workloadRuns(workloads.size() * 4);
+    std::vector<std::string> workloadNames;
+
+    for (size_t workloadIdx = 0; workloadIdx < workloads.size(); workloadIdx++)
+        for (unsigned int modeIdx = 0; modeIdx < 4; modeIdx++)
+            workloadNames.push_back(std::string(workloadModes[modeIdx].first) + "/" + WorkloadLabel(workloads[workloadIdx]->profile));
+
+    for (size_t workloadIdx = 0; workloadIdx < workloads.size(); workloadIdx++) {
+        const Workload& workload = *workloads[workloadIdx];
+        size_t messages = std::max<size_t>(1, harness.MessagesPerSample() * textSize / workload.text.size());
+
+        for (unsigned int modeIdx = 0; modeIdx < 4; modeIdx++) {
+            WorkloadRun& run = workloadRuns[workloadIdx * 4 + modeIdx];
+            const std::string& name = workloadNames[workloadIdx * 4 + modeIdx];
+            int mode = workloadModes[modeIdx].second;
+
+            auto setUp = [&run, &workload, mode]() {
+                newWorkloadRun(run, workload, mode >= 0, (JsonDecodeMode)mode);
+            };
+
+            auto runMessages = [&run](size_t count) {
+                parseWorkload(run, count);
+            };
+
+            auto tearDown = [&log, &run, &name]() {
+                deleteWorkloadRun(run, log, name);
+            };
+
+            // rapidjson alone allocates its DOM
+            harness.Register({name, workload.text.size(), setUp, runMessages, tearDown, messages, mode >= 0 ? noAllocations : -1});
+        }
     }
 
-    output("Overload - ");
+    // the parse entry points on every scan path the CPU has, with a large document, compact and pretty-printed
+    const JsonSimdPath bestPath = JSON_simdBestPath();
+    const std::pair<const char*, JsonDecodeMode> simdModes[] = {
+        {"Table", JSON_DECODE_DOM},
+        {"Table-SAX", JSON_DECODE_SAX}
+    };
+    const char* const simdDocuments[] = {"large", "pretty"};
 
-    std::cout << "JSON short string to parse: " << &json_ipcfg_short[0] << std::endl;
+    Workload simdWorkloads[2];
 
-    {
-        memset(&myipcfg, 0, sizeof(myipcfg));
+    for (unsigned int documentIdx = 0; documentIdx < 2; documentIdx++) {
+        WorkloadProfile profile = {1000, 8, 1, WORKLOAD_KEYS_NORMAL, 0, 50, 10, documentIdx == 1};
 
-        boost::timer::auto_cpu_timer act;
+        WorkloadGenerate(profile, simdWorkloads[documentIdx]);
+    }
+
+    std::vector<WorkloadRun> simdRuns(JSON_SIMD_PATH_COUNT * 2 * 2);
+    std::vector<std::string> simdNames(simdRuns.size());
+    std::vector<std::string> simdRunNames;
+
+    for (unsigned int modeIdx = 0; modeIdx < 2; modeIdx++)
+        for (unsigned int documentIdx = 0; documentIdx < 2; documentIdx++)
+            simdRunNames.push_back(std::string(simdModes[modeIdx].first) + "/" + simdDocuments[documentIdx]);
+
+    for (int path = JSON_SIMD_SCALAR; path < JSON_SIMD_PATH_COUNT; path++) {
+        if (!JSON_simdPathSupported((JsonSimdPath)path))
+            continue;
+
+        for (unsigned int runIdx = 0; runIdx < 4; runIdx++) {
+            const Workload& workload = simdWorkloads[runIdx % 2];
+            JsonDecodeMode mode = simdModes[runIdx / 2].second;
+            WorkloadRun& run = simdRuns[path * 4 + runIdx];
+            std::string& name = simdNames[path * 4 + runIdx];
+            size_t messages = std::max<size_t>(1, harness.MessagesPerSample() * textSize / workload.text.size());
+
+            name = std::string("SIMD-") + JSON_simdPathName((JsonSimdPath)path) + "/" + simdRunNames[runIdx];
 
-        parseIPCfgWithOverloadShort();
+            auto setUp = [&run, &workload, mode, path]() {
+                JSON_simdSetPath((JsonSimdPath)path);
+                newWorkloadRun(run, workload, true, mode);
+            };
+
+            auto runMessages = [&run](size_t count) {
+                parseWorkload(run, count);
+            };
+
+            auto tearDown = [&log, &run, &name, bestPath]() {
+                deleteWorkloadRun(run, log, name);
+                JSON_simdSetPath(bestPath);
+            };
+
+            harness.Register({name, workload.text.size(), setUp, runMessages, tearDown, messages, noAllocations});
+        }
     }
 
-    output("Overload - ");
+    // a regression against the baseline fails the run
+    size_t failures = harness.Run();
+
+    logSimdSpeedups(log, harness.Results(), simdRunNames);
 
-    return 0;
+    return failures == 0 ? 0 : 1;
 }